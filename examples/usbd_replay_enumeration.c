@@ -0,0 +1,351 @@
+/*
+ * usbd_replay_enumeration.c
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: Ludo
+ */
+
+// Sample trace of the enumeration of a CDC device by a Linux host, replayed on the simulated controller.
+// The expected descriptors match the default CDC settings of usb_lib_flags_template.txt at high speed (default of the simulated controller): build on Linux with gcc -std=gnu11 -fshort-enums and a usb_lib_flags.h copied from the template where USBD_SIM and USBD_REPLAY are defined.
+// Usage: usbd_replay_enumeration [<capture_file_path> [<device_time_max_ns>]]
+// A pcap file exported by USBD_CAPTURE_export_pcap() is replayed after the sample trace when given. The process exits with 0 when all transactions match.
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_class.h"
+#include "common/usb_configuration.h"
+#include "common/usb_descriptor.h"
+#include "common/usb_device.h"
+#include "common/usb_request.h"
+#include "common/usb_types.h"
+#include "device/class/usbd_cdc.h"
+#include "device/sim/usbd_replay.h"
+#include "device/sim/usbd_sim.h"
+#include "device/standard/usbd_control.h"
+#include "device/usbd.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if ((defined USB_LIB_DISABLE) || !(defined USBD_SIM) || !(defined USBD_REPLAY) || !(defined USBD_CDC))
+#error "USB library: the replay example requires USBD_SIM, USBD_REPLAY and USBD_CDC"
+#endif
+
+// The expected descriptors are only produced when the enumeration fields are single bytes.
+_Static_assert(sizeof(USB_device_descriptor_t) == 18, "the replay example requires -fshort-enums");
+_Static_assert(sizeof(USB_configuration_descriptor_t) == 9, "the replay example requires -fshort-enums");
+
+/*** REPLAY ENUMERATION local macros ***/
+
+#define REPLAY_ENUMERATION_BUS_RESET \
+    { .token = USBD_REPLAY_TOKEN_BUS_EVENT, .endpoint_number = 0, .bus_event = USB_BUS_EVENT_RESET, .data = NULL, .data_size_bytes = 0, .packet_size_bytes = 0, .handshake = USBD_SIM_HANDSHAKE_NONE, .device_time_max_ns = 0 }
+
+#define REPLAY_ENUMERATION_SETUP(setup) \
+    { .token = USBD_REPLAY_TOKEN_SETUP, .endpoint_number = 0, .bus_event = USB_BUS_EVENT_LAST, .data = setup, .data_size_bytes = USB_SETUP_PACKET_SIZE_BYTES, .packet_size_bytes = USB_SETUP_PACKET_SIZE_BYTES, .handshake = USBD_SIM_HANDSHAKE_ACK, .device_time_max_ns = 0 }
+
+#define REPLAY_ENUMERATION_IN(data_in) \
+    { .token = USBD_REPLAY_TOKEN_IN, .endpoint_number = 0, .bus_event = USB_BUS_EVENT_LAST, .data = data_in, .data_size_bytes = sizeof(data_in), .packet_size_bytes = sizeof(data_in), .handshake = USBD_SIM_HANDSHAKE_ACK, .device_time_max_ns = 0 }
+
+#define REPLAY_ENUMERATION_STATUS_IN \
+    { .token = USBD_REPLAY_TOKEN_IN, .endpoint_number = 0, .bus_event = USB_BUS_EVENT_LAST, .data = NULL, .data_size_bytes = 0, .packet_size_bytes = 0, .handshake = USBD_SIM_HANDSHAKE_ACK, .device_time_max_ns = 0 }
+
+#define REPLAY_ENUMERATION_STATUS_OUT \
+    { .token = USBD_REPLAY_TOKEN_OUT, .endpoint_number = 0, .bus_event = USB_BUS_EVENT_LAST, .data = NULL, .data_size_bytes = 0, .packet_size_bytes = 0, .handshake = USBD_SIM_HANDSHAKE_ACK, .device_time_max_ns = 0 }
+
+/*** REPLAY ENUMERATION local global variables ***/
+
+USB_STRING_DESCRIPTOR(REPLAY_ENUMERATION_CDC_COMM, u"CDC control");
+USB_STRING_DESCRIPTOR(REPLAY_ENUMERATION_CDC_DATA, u"CDC data");
+USB_STRING_DESCRIPTOR(REPLAY_ENUMERATION_MANUFACTURER, u"usb-lib");
+USB_STRING_DESCRIPTOR(REPLAY_ENUMERATION_PRODUCT, u"Replay example");
+
+static const USB_string_descriptor_t* REPLAY_ENUMERATION_STRING_LIST[] = {
+    NULL,
+    (const USB_string_descriptor_t*) &REPLAY_ENUMERATION_CDC_COMM,
+    (const USB_string_descriptor_t*) &REPLAY_ENUMERATION_CDC_DATA,
+    (const USB_string_descriptor_t*) &REPLAY_ENUMERATION_MANUFACTURER,
+    (const USB_string_descriptor_t*) &REPLAY_ENUMERATION_PRODUCT
+};
+
+static const USB_string_descriptor_language_t REPLAY_ENUMERATION_LANGUAGE = {
+    .langid = 0x0409,
+    .string_descriptor_list = REPLAY_ENUMERATION_STRING_LIST,
+    .number_of_string_descriptors = (sizeof(REPLAY_ENUMERATION_STRING_LIST) / sizeof(USB_string_descriptor_t*))
+};
+
+static const USB_string_descriptor_language_t* REPLAY_ENUMERATION_LANGUAGE_LIST[] = {
+    &REPLAY_ENUMERATION_LANGUAGE
+};
+
+static const USB_device_descriptor_t REPLAY_ENUMERATION_DEVICE_DESCRIPTOR = {
+    .bLength = sizeof(USB_device_descriptor_t),
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_DEVICE,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = USB_CLASS_CODE_CDC_CONTROL,
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = 64,
+    .idVendor = 0x1209,
+    .idProduct = 0x0001,
+    .bcdDevice = 0x0100,
+    .iManufacturer = 3,
+    .iProduct = 4,
+    .iSerialNumber = 0,
+    .bNumConfigurations = 1
+};
+
+static const USB_device_qualifier_descriptor_t REPLAY_ENUMERATION_DEVICE_QUALIFIER_DESCRIPTOR = {
+    .bLength = sizeof(USB_device_qualifier_descriptor_t),
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_DEVICE_QUALIFIER,
+    .bcdUSB = 0x0200,
+    .bDeviceClass = USB_CLASS_CODE_USE_INTERFACE,
+    .bDeviceSubClass = 0x00,
+    .bDeviceProtocol = 0x00,
+    .bMaxPacketSize0 = 64,
+    .bNumConfigurations = 1,
+    .bReserved = 0x00
+};
+
+static const USB_configuration_descriptor_t REPLAY_ENUMERATION_CONFIGURATION_DESCRIPTOR = {
+    .bLength = sizeof(USB_configuration_descriptor_t),
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_CONFIGURATION,
+    .wTotalLength = 0,
+    .bNumInterfaces = 0,
+    .bConfigurationValue = 1,
+    .iConfiguration = 0,
+    .bmAttributes.value = 0x80,
+    .bMaxPower = 50
+};
+
+static const USB_interface_t* REPLAY_ENUMERATION_INTERFACE_LIST[] = {
+    &USBD_CONTROL_INTERFACE,
+    &USBD_CDC_COMM_INTERFACE,
+    &USBD_CDC_DATA_INTERFACE
+};
+
+static const USB_configuration_t REPLAY_ENUMERATION_CONFIGURATION = {
+    .descriptor = &REPLAY_ENUMERATION_CONFIGURATION_DESCRIPTOR,
+    .interface_list = REPLAY_ENUMERATION_INTERFACE_LIST,
+    .number_of_interfaces = (sizeof(REPLAY_ENUMERATION_INTERFACE_LIST) / sizeof(USB_interface_t*)),
+    .interface_association_list = NULL,
+    .number_of_interfaces_associations = 0,
+    .max_power_ma = 100,
+    .static_descriptor = NULL,
+    .static_hs_descriptor = NULL
+};
+
+static const USB_configuration_t* REPLAY_ENUMERATION_CONFIGURATION_LIST[] = {
+    &REPLAY_ENUMERATION_CONFIGURATION
+};
+
+static const USB_device_t REPLAY_ENUMERATION_DEVICE = {
+    .descriptor = &REPLAY_ENUMERATION_DEVICE_DESCRIPTOR,
+    .qualifier_descriptor = &REPLAY_ENUMERATION_DEVICE_QUALIFIER_DESCRIPTOR,
+    .configuration_list = REPLAY_ENUMERATION_CONFIGURATION_LIST,
+    .number_of_configurations = (sizeof(REPLAY_ENUMERATION_CONFIGURATION_LIST) / sizeof(USB_configuration_t*)),
+    .language_list = REPLAY_ENUMERATION_LANGUAGE_LIST,
+    .number_of_languages = (sizeof(REPLAY_ENUMERATION_LANGUAGE_LIST) / sizeof(USB_string_descriptor_language_t*))
+};
+
+// Host requests.
+
+static const uint8_t REPLAY_ENUMERATION_GET_DEVICE_DESCRIPTOR_64_SETUP[] = {
+    0x80, 0x06, 0x00, 0x01, 0x00, 0x00, 0x40, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_SET_ADDRESS_SETUP[] = {
+    0x00, 0x05, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_GET_DEVICE_DESCRIPTOR_SETUP[] = {
+    0x80, 0x06, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_GET_DEVICE_QUALIFIER_DESCRIPTOR_SETUP[] = {
+    0x80, 0x06, 0x00, 0x06, 0x00, 0x00, 0x0A, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_GET_CONFIGURATION_DESCRIPTOR_HEADER_SETUP[] = {
+    0x80, 0x06, 0x00, 0x02, 0x00, 0x00, 0x09, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_GET_CONFIGURATION_DESCRIPTOR_SETUP[] = {
+    0x80, 0x06, 0x00, 0x02, 0x00, 0x00, 0xFF, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_GET_LANGID_DESCRIPTOR_SETUP[] = {
+    0x80, 0x06, 0x00, 0x03, 0x00, 0x00, 0xFF, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_GET_PRODUCT_STRING_DESCRIPTOR_SETUP[] = {
+    0x80, 0x06, 0x04, 0x03, 0x09, 0x04, 0xFF, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_GET_MANUFACTURER_STRING_DESCRIPTOR_SETUP[] = {
+    0x80, 0x06, 0x03, 0x03, 0x09, 0x04, 0xFF, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_SET_CONFIGURATION_SETUP[] = {
+    0x00, 0x09, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+// Expected device responses (descriptors longer than the control endpoint packet size are split).
+
+static const uint8_t REPLAY_ENUMERATION_EXPECTED_DEVICE_DESCRIPTOR[] = {
+    0x12, 0x01, 0x00, 0x02, 0x02, 0x00, 0x00, 0x40, 0x09, 0x12, 0x01, 0x00, 0x00, 0x01, 0x03, 0x04,
+    0x00, 0x01
+};
+
+static const uint8_t REPLAY_ENUMERATION_EXPECTED_DEVICE_QUALIFIER_DESCRIPTOR[] = {
+    0x0A, 0x06, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x01, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_EXPECTED_CONFIGURATION_DESCRIPTOR_HEADER[] = {
+    0x09, 0x02, 0x43, 0x00, 0x00, 0x01, 0x00, 0x80, 0x32
+};
+
+static const uint8_t REPLAY_ENUMERATION_EXPECTED_CONFIGURATION_DESCRIPTOR_1[] = {
+    0x09, 0x02, 0x43, 0x00, 0x00, 0x01, 0x00, 0x80, 0x32, 0x09, 0x04, 0x01, 0x00, 0x01, 0x02, 0x02,
+    0x00, 0x01, 0x05, 0x24, 0x00, 0x20, 0x01, 0x05, 0x24, 0x01, 0x01, 0x02, 0x04, 0x24, 0x02, 0x06,
+    0x05, 0x24, 0x06, 0x01, 0x02, 0x07, 0x05, 0x81, 0x03, 0x10, 0x00, 0x0C, 0x09, 0x04, 0x02, 0x00,
+    0x02, 0x0A, 0x00, 0x00, 0x02, 0x07, 0x05, 0x02, 0x02, 0x00, 0x02, 0x01, 0x07, 0x05, 0x82, 0x02
+};
+
+static const uint8_t REPLAY_ENUMERATION_EXPECTED_CONFIGURATION_DESCRIPTOR_2[] = {
+    0x00, 0x02, 0x01
+};
+
+static const uint8_t REPLAY_ENUMERATION_EXPECTED_LANGID_DESCRIPTOR[] = {
+    0x04, 0x03, 0x09, 0x04
+};
+
+static const uint8_t REPLAY_ENUMERATION_EXPECTED_PRODUCT_STRING_DESCRIPTOR[] = {
+    0x1E, 0x03, 0x52, 0x00, 0x65, 0x00, 0x70, 0x00, 0x6C, 0x00, 0x61, 0x00, 0x79, 0x00, 0x20, 0x00,
+    0x65, 0x00, 0x78, 0x00, 0x61, 0x00, 0x6D, 0x00, 0x70, 0x00, 0x6C, 0x00, 0x65, 0x00
+};
+
+static const uint8_t REPLAY_ENUMERATION_EXPECTED_MANUFACTURER_STRING_DESCRIPTOR[] = {
+    0x10, 0x03, 0x75, 0x00, 0x73, 0x00, 0x62, 0x00, 0x2D, 0x00, 0x6C, 0x00, 0x69, 0x00, 0x62, 0x00
+};
+
+static const USBD_REPLAY_record_t REPLAY_ENUMERATION_TRACE[] = {
+    REPLAY_ENUMERATION_BUS_RESET,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_GET_DEVICE_DESCRIPTOR_64_SETUP),
+    REPLAY_ENUMERATION_IN(REPLAY_ENUMERATION_EXPECTED_DEVICE_DESCRIPTOR),
+    REPLAY_ENUMERATION_STATUS_OUT,
+    REPLAY_ENUMERATION_BUS_RESET,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_SET_ADDRESS_SETUP),
+    REPLAY_ENUMERATION_STATUS_IN,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_GET_DEVICE_DESCRIPTOR_SETUP),
+    REPLAY_ENUMERATION_IN(REPLAY_ENUMERATION_EXPECTED_DEVICE_DESCRIPTOR),
+    REPLAY_ENUMERATION_STATUS_OUT,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_GET_DEVICE_QUALIFIER_DESCRIPTOR_SETUP),
+    REPLAY_ENUMERATION_IN(REPLAY_ENUMERATION_EXPECTED_DEVICE_QUALIFIER_DESCRIPTOR),
+    REPLAY_ENUMERATION_STATUS_OUT,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_GET_CONFIGURATION_DESCRIPTOR_HEADER_SETUP),
+    REPLAY_ENUMERATION_IN(REPLAY_ENUMERATION_EXPECTED_CONFIGURATION_DESCRIPTOR_HEADER),
+    REPLAY_ENUMERATION_STATUS_OUT,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_GET_CONFIGURATION_DESCRIPTOR_SETUP),
+    REPLAY_ENUMERATION_IN(REPLAY_ENUMERATION_EXPECTED_CONFIGURATION_DESCRIPTOR_1),
+    REPLAY_ENUMERATION_IN(REPLAY_ENUMERATION_EXPECTED_CONFIGURATION_DESCRIPTOR_2),
+    REPLAY_ENUMERATION_STATUS_OUT,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_GET_LANGID_DESCRIPTOR_SETUP),
+    REPLAY_ENUMERATION_IN(REPLAY_ENUMERATION_EXPECTED_LANGID_DESCRIPTOR),
+    REPLAY_ENUMERATION_STATUS_OUT,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_GET_PRODUCT_STRING_DESCRIPTOR_SETUP),
+    REPLAY_ENUMERATION_IN(REPLAY_ENUMERATION_EXPECTED_PRODUCT_STRING_DESCRIPTOR),
+    REPLAY_ENUMERATION_STATUS_OUT,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_GET_MANUFACTURER_STRING_DESCRIPTOR_SETUP),
+    REPLAY_ENUMERATION_IN(REPLAY_ENUMERATION_EXPECTED_MANUFACTURER_STRING_DESCRIPTOR),
+    REPLAY_ENUMERATION_STATUS_OUT,
+    REPLAY_ENUMERATION_SETUP(REPLAY_ENUMERATION_SET_CONFIGURATION_SETUP),
+    REPLAY_ENUMERATION_STATUS_IN
+};
+
+/*** REPLAY ENUMERATION local functions ***/
+
+/*******************************************************************/
+static USB_status_t _REPLAY_ENUMERATION_set_configuration_request(uint8_t configuration_value) {
+    // Unused parameter.
+    UNUSED(configuration_value);
+    return USB_SUCCESS;
+}
+
+/*******************************************************************/
+static USB_status_t _REPLAY_ENUMERATION_set_serial_port_state(uint8_t rts, uint8_t dtr) {
+    // Unused parameters.
+    UNUSED(rts);
+    UNUSED(dtr);
+    return USB_SUCCESS;
+}
+
+/*******************************************************************/
+static USB_status_t _REPLAY_ENUMERATION_rx_completion(uint8_t data) {
+    // Unused parameter.
+    UNUSED(data);
+    return USB_SUCCESS;
+}
+
+/*******************************************************************/
+static USB_status_t _REPLAY_ENUMERATION_tx_completion(void) {
+    return USB_SUCCESS;
+}
+
+/*******************************************************************/
+static void _REPLAY_ENUMERATION_print_report(const char* trace_name, USB_status_t status, USBD_REPLAY_report_t* report) {
+    // Print replay result.
+    printf("%s: status=%d records=%u", trace_name, (int) status, (unsigned int) (report->number_of_records));
+    if ((report->mismatch) != USBD_REPLAY_MISMATCH_NONE) {
+        printf(" mismatch=%d index=%u", (int) (report->mismatch), (unsigned int) (report->mismatch_index));
+    }
+    printf(" nak=%u device_time_ns=%llu max_ns=%llu (record %u)\n", (unsigned int) (report->nak_count), (unsigned long long) (report->device_time_ns), (unsigned long long) (report->device_time_max_ns), (unsigned int) (report->device_time_max_index));
+}
+
+/*** REPLAY ENUMERATION main function ***/
+
+/*******************************************************************/
+int main(int argc, char* argv[]) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_CONTROL_callbacks_t control_callbacks;
+    USBD_CDC_callbacks_t cdc_callbacks;
+    USBD_REPLAY_report_t report;
+    uint32_t device_time_max_ns = 0;
+    // Init stack.
+    control_callbacks.set_configuration_request = &_REPLAY_ENUMERATION_set_configuration_request;
+    control_callbacks.vendor_request = NULL;
+    cdc_callbacks.set_serial_port_configuration_request = NULL;
+    cdc_callbacks.get_serial_port_configuration_request = NULL;
+    cdc_callbacks.set_serial_port_state = &_REPLAY_ENUMERATION_set_serial_port_state;
+    cdc_callbacks.send_break = NULL;
+    cdc_callbacks.rx_completion = &_REPLAY_ENUMERATION_rx_completion;
+    cdc_callbacks.tx_completion = &_REPLAY_ENUMERATION_tx_completion;
+    status = USBD_init();
+    if (status != USB_SUCCESS) goto errors;
+    status = USBD_CONTROL_init((USB_device_t*) &REPLAY_ENUMERATION_DEVICE, &control_callbacks);
+    if (status != USB_SUCCESS) goto errors;
+    status = USBD_CDC_init(&cdc_callbacks);
+    if (status != USB_SUCCESS) goto errors;
+    status = USBD_start();
+    if (status != USB_SUCCESS) goto errors;
+    // Replay sample trace.
+    status = USBD_REPLAY_run(REPLAY_ENUMERATION_TRACE, (sizeof(REPLAY_ENUMERATION_TRACE) / sizeof(USBD_REPLAY_record_t)), &report);
+    _REPLAY_ENUMERATION_print_report("enumeration", status, &report);
+    if (status != USB_SUCCESS) goto errors;
+    // Replay capture file.
+    if (argc > 1) {
+        if (argc > 2) {
+            device_time_max_ns = (uint32_t) strtoul(argv[2], NULL, 0);
+        }
+        // Captures start from the default state.
+        status = USBD_SIM_bus_event(USB_BUS_EVENT_RESET);
+        if (status != USB_SUCCESS) goto errors;
+        status = USBD_REPLAY_run_pcap(argv[1], device_time_max_ns, &report);
+        _REPLAY_ENUMERATION_print_report(argv[1], status, &report);
+        if (status != USB_SUCCESS) goto errors;
+    }
+errors:
+    return ((status == USB_SUCCESS) ? 0 : 1);
+}
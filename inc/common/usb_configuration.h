@@ -45,7 +45,7 @@ typedef struct {
 
 /*!******************************************************************
  * \struct USB_configuration_t
- * \brief USB configuration structure.
+ * \brief USB configuration structure (the static descriptors are only used when USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR is defined).
  *******************************************************************/
 typedef struct {
     const USB_configuration_descriptor_t* descriptor;
@@ -54,6 +54,10 @@ typedef struct {
     const USB_interface_association_t** interface_association_list;
     const uint8_t number_of_interfaces_associations;
     const uint16_t max_power_ma;
+    // Whole configuration descriptor built at compile time (header followed by wTotalLength bytes of interface and endpoint descriptors).
+    const USB_configuration_descriptor_t* static_descriptor;
+    // High speed variant (the full speed one is used if NULL).
+    const USB_configuration_descriptor_t* static_hs_descriptor;
 } USB_configuration_t;
 
 #endif /* __USB_CONFIGURATION_H__ */
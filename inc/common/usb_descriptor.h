@@ -51,4 +51,27 @@ typedef struct {
     USB_descriptor_type_t bDescriptorType;
 } __attribute__((packed)) USB_string_descriptor_t;
 
+/*!******************************************************************
+ * \struct USB_string_descriptor_language_t
+ * \brief USB string descriptors set of a given language.
+ *******************************************************************/
+typedef struct {
+    uint16_t langid;
+    const USB_string_descriptor_t** string_descriptor_list;
+    uint8_t number_of_string_descriptors;
+} USB_string_descriptor_language_t;
+
+/*******************************************************************/
+#define USB_STRING_DESCRIPTOR(name, utf16_string) \
+    _Static_assert(sizeof(utf16_string) <= 0xFF, "USB string descriptor too long"); \
+    static const struct { \
+        uint8_t bLength; \
+        uint8_t bDescriptorType; \
+        uint16_t bString[(sizeof(utf16_string) / sizeof(uint16_t)) - 1]; \
+    } __attribute__((packed)) name = { \
+        .bLength = sizeof(utf16_string), \
+        .bDescriptorType = USB_DESCRIPTOR_TYPE_STRING, \
+        .bString = utf16_string \
+    }
+
 #endif /* __USB_DESCRIPTOR_H__ */
@@ -66,8 +66,8 @@ typedef struct {
     const USB_device_qualifier_descriptor_t* qualifier_descriptor;
     const USB_configuration_t** configuration_list;
     const uint8_t number_of_configurations;
-    const char_t** string_descriptor_list;
-    const uint8_t number_of_string_descriptors;
+    const USB_string_descriptor_language_t** language_list;
+    const uint8_t number_of_languages;
 } USB_device_t;
 
 #endif /* __USB_DEVICE_H__ */
@@ -10,16 +10,11 @@
 
 #include "common/usb_descriptor.h"
 #include "common/usb_request.h"
+#include "common/usb_types.h"
 #include "types.h"
 
 /*** USB ENDPOINT structures ***/
 
-/*!******************************************************************
- * \fn USB_endpoint_cb_t
- * \brief USB endpoint transfer completion callback.
- *******************************************************************/
-typedef void (*USB_endpoint_cb_t)(void);
-
 /*!******************************************************************
  * \fn USB_setup_cb_t
  * \brief USB setup packet reception callback.
@@ -71,6 +66,16 @@ typedef enum {
     USB_ENDPOINT_USAGE_TYPE_LAST
 } USB_endpoint_usage_type_t;
 
+/*!******************************************************************
+ * \enum USB_endpoint_buffer_mode_t
+ * \brief USB endpoint packet memory buffering modes list.
+ *******************************************************************/
+typedef enum {
+    USB_ENDPOINT_BUFFER_MODE_SINGLE = 0x00,
+    USB_ENDPOINT_BUFFER_MODE_DOUBLE = 0x01,
+    USB_ENDPOINT_BUFFER_MODE_LAST
+} USB_endpoint_buffer_mode_t;
+
 /*!******************************************************************
  * \struct USB_endpoint_bEndpointAddress_t
  * \brief USB endpoint address descriptor format.
@@ -124,27 +129,75 @@ typedef struct {
     uint8_t bInterval;
 } __attribute__((packed)) USB_endpoint_descriptor_t;
 
+/*!******************************************************************
+ * \enum USB_endpoint_transfer_status_t
+ * \brief USB endpoint transfer completion status list.
+ *******************************************************************/
+typedef enum {
+    USB_ENDPOINT_TRANSFER_STATUS_OK = 0x00,
+    USB_ENDPOINT_TRANSFER_STATUS_SHORT = 0x01,
+    USB_ENDPOINT_TRANSFER_STATUS_OVERRUN = 0x02,
+    USB_ENDPOINT_TRANSFER_STATUS_ERROR = 0x03,
+    USB_ENDPOINT_TRANSFER_STATUS_LAST
+} USB_endpoint_transfer_status_t;
+
+struct USB_physical_endpoint_s;
+
+/*!******************************************************************
+ * \fn USB_endpoint_cb_t
+ * \brief USB endpoint transfer completion callback (short means less than the maximum packet size, overrun means the packet was truncated and error reports a CRC or missed isochronous packet). On OUT endpoints, size_bytes is the size of the oldest received packet, which is returned by the next USBD_HW_read_data() or USBD_HW_acquire_data() call: double buffered endpoints issue one callback per packet in reception order.
+ *******************************************************************/
+typedef void (*USB_endpoint_cb_t)(struct USB_physical_endpoint_s* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number);
+
 /*!******************************************************************
  * \struct USB_physical_endpoint_t
- * \brief USB physical endpoint descriptor structure.
+ * \brief USB physical endpoint descriptor structure (high speed maximum packet size is 0 when identical to the full speed one).
  *******************************************************************/
-typedef struct {
+typedef struct USB_physical_endpoint_s {
     uint8_t number;
     USB_endpoint_direction_t direction;
     USB_endpoint_transfer_type_t transfer_type;
     USB_endpoint_synchronization_type_t synchronization_type;
     USB_endpoint_usage_type_t usage_type;
     uint16_t max_packet_size_bytes;
+    uint16_t high_speed_max_packet_size_bytes;
+    USB_endpoint_buffer_mode_t buffer_mode;
     USB_endpoint_cb_t callback;
 } USB_physical_endpoint_t;
 
 /*!******************************************************************
  * \struct USB_endpoint_t
- * \brief USB endpoint structure.
+ * \brief USB endpoint structure (high speed descriptor is NULL when identical to the full speed one).
  *******************************************************************/
 typedef struct {
     const USB_endpoint_descriptor_t* descriptor;
+    const USB_endpoint_descriptor_t* high_speed_descriptor;
     const USB_physical_endpoint_t* physical_endpoint;
 } USB_endpoint_t;
 
+/*******************************************************************/
+#define USB_ENDPOINT_DESCRIPTOR_INITIALIZER(ep_number, ep_direction, ep_transfer_type, ep_synchronization_type, ep_usage_type, ep_max_packet_size_bytes, ep_interval) { \
+    .bLength = sizeof(USB_endpoint_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT, \
+    .bEndpointAddress.number = (ep_number), \
+    .bEndpointAddress.direction = (ep_direction), \
+    .bEndpointAddress.reserved_6_4 = 0, \
+    .bmAttributes.transfer_type = (ep_transfer_type), \
+    .bmAttributes.synchronization_type = (ep_synchronization_type), \
+    .bmAttributes.usage_type = (ep_usage_type), \
+    .bmAttributes.reserved_7_6 = 0, \
+    .wMaxPacketSize.max_packet_size = (ep_max_packet_size_bytes), \
+    .wMaxPacketSize.transaction_per_microframe = 0, \
+    .wMaxPacketSize.reserved_15_13 = 0, \
+    .bInterval = (ep_interval) \
+}
+
+/*******************************************************************/
+#define USB_ENDPOINT_GET_MAX_PACKET_SIZE(physical_endpoint, speed) \
+    ((((speed) == USB_SPEED_HIGH) && (((physical_endpoint)->high_speed_max_packet_size_bytes) != 0)) ? ((physical_endpoint)->high_speed_max_packet_size_bytes) : ((physical_endpoint)->max_packet_size_bytes))
+
+/*******************************************************************/
+#define USB_ENDPOINT_GET_DESCRIPTOR(endpoint, speed) \
+    ((((speed) == USB_SPEED_HIGH) && (((endpoint)->high_speed_descriptor) != NULL)) ? ((endpoint)->high_speed_descriptor) : ((endpoint)->descriptor))
+
 #endif /* __USB_ENDPOINT_H__ */
@@ -47,17 +47,40 @@ typedef struct {
     uint8_t iFunction;
 } __attribute__((packed)) USB_interface_association_descriptor_t;
 
+/*!******************************************************************
+ * \fn USB_interface_set_alternate_setting_cb_t
+ * \brief USB interface alternate setting selection callback.
+ *******************************************************************/
+typedef USB_status_t (*USB_interface_set_alternate_setting_cb_t)(uint8_t alternate_setting);
+
+/*!******************************************************************
+ * \fn USB_interface_bus_event_cb_t
+ * \brief USB interface bus reset, suspend and resume callback.
+ *******************************************************************/
+typedef USB_status_t (*USB_interface_bus_event_cb_t)(USB_bus_event_t bus_event);
+
+/*!******************************************************************
+ * \fn USB_interface_sof_cb_t
+ * \brief USB interface start of frame callback (decimated by the device stack).
+ *******************************************************************/
+typedef USB_status_t (*USB_interface_sof_cb_t)(uint16_t frame_number);
+
 /*!******************************************************************
  * \struct USB_interface_t
  * \brief USB interface structure.
  *******************************************************************/
-typedef struct {
+typedef struct USB_interface_s {
     const USB_interface_descriptor_t* descriptor;
     const USB_endpoint_t** endpoint_list;
     const uint8_t number_of_endpoints;
-    const uint8_t** cs_descriptor;
+    const uint8_t* cs_descriptor;
     const uint8_t* cs_descriptor_length;
     USB_request_cb_t request_callback;
+    const struct USB_interface_s** alternate_setting_list;
+    const uint8_t number_of_alternate_settings;
+    USB_interface_set_alternate_setting_cb_t set_alternate_setting_callback;
+    USB_interface_bus_event_cb_t bus_event_callback;
+    USB_interface_sof_cb_t sof_callback;
 } USB_interface_t;
 
 /*!******************************************************************
@@ -65,6 +65,17 @@ typedef enum {
     USB_REQUEST_LAST
 } USB_request_standard_t;
 
+/*!******************************************************************
+ * \enum USB_request_feature_selector_t
+ * \brief USB standard feature selectors list.
+ *******************************************************************/
+typedef enum {
+    USB_REQUEST_FEATURE_SELECTOR_ENDPOINT_HALT = 0x00,
+    USB_REQUEST_FEATURE_SELECTOR_DEVICE_REMOTE_WAKEUP = 0x01,
+    USB_REQUEST_FEATURE_SELECTOR_TEST_MODE = 0x02,
+    USB_REQUEST_FEATURE_SELECTOR_LAST
+} USB_request_feature_selector_t;
+
 /*!******************************************************************
  * \enum USB_request_operation_t
  * \brief USB request operations list.
@@ -104,7 +115,7 @@ typedef struct {
 
 /*!******************************************************************
  * \fn USB_request_cb_t
- * \brief USB request execution callback.
+ * \brief USB request execution callback (the answer can be deferred by calling USBD_CONTROL_defer_request() before returning).
  *******************************************************************/
 typedef USB_status_t (*USB_request_cb_t)(USB_request_t* request, USB_data_t* data_out, USB_data_t* data_in);
 
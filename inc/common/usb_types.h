@@ -23,6 +23,8 @@
 #define USB_FS_CONTROL_PACKET_SIZE_MAX  64
 #define USB_HS_CONTROL_PACKET_SIZE_MAX  64
 
+#define USB_FRAME_NUMBER_MASK           0x07FF
+
 /*** USB TYPES structures ***/
 
 /*!******************************************************************
@@ -54,12 +56,88 @@ typedef enum {
     USB_ERROR_CDC_DATA_SIZE,
     // Low level drivers errors.
     USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED,
+    // Codes below were added afterwards: new codes must be appended at the end of the list to keep the existing values.
+    // Control pipe errors.
+    USB_ERROR_STRING_DESCRIPTOR_LANGUAGE,
+    USB_ERROR_SERIAL_NUMBER_SIZE,
+    USB_ERROR_INTERFACE_NUMBER,
+    USB_ERROR_REQUEST_RECIPIENT,
+    USB_ERROR_ALTERNATE_SETTING,
+    USB_ERROR_LATENCY_STAGE,
+    USB_ERROR_LATENCY_HISTOGRAM_NOT_FOUND,
+    USB_ERROR_NO_DEFERRED_REQUEST,
+    USB_ERROR_VENDOR_REQUEST_TABLE_FULL,
+    USB_ERROR_VENDOR_REQUEST_ALREADY_REGISTERED,
+    USB_ERROR_VENDOR_REQUEST_NOT_REGISTERED,
+    USB_ERROR_BUS_EVENT,
+    // Simulated controller errors.
+    USB_ERROR_SIM_DETACHED,
+    USB_ERROR_SIM_PACKET_SIZE,
+    USB_ERROR_SIM_STALL,
+    USB_ERROR_SIM_NAK_TIMEOUT,
+    USB_ERROR_SIM_SPEED,
+    USB_ERROR_SIM_SUSPENDED,
+    // USB/IP server errors.
+    USB_ERROR_USBIP_SOCKET,
+    USB_ERROR_USBIP_DISCONNECTED,
+    USB_ERROR_USBIP_PROTOCOL,
+    // Capture and trace replay errors.
+    USB_ERROR_CAPTURE_RUNNING,
+    USB_ERROR_REPLAY_MISMATCH,
+    USB_ERROR_REPLAY_FILE,
+    USB_ERROR_REPLAY_FORMAT,
+    USB_ERROR_REPLAY_TRACE_SIZE,
+    // Endpoint buffers errors.
+    USB_ERROR_ENDPOINT_BUFFER_OWNERSHIP,
+    USB_ERROR_ENDPOINT_TRANSFER,
+    USB_ERROR_ENDPOINT_PACKET_SIZE,
+    USB_ERROR_PMA_SIZE,
+    USB_ERROR_PMA_BUFFER_NOT_ALLOCATED,
+    // Event queue errors.
+    USB_ERROR_EVENT_QUEUE_FULL,
+    USB_ERROR_EVENT_TYPE,
+    // Vendor request errors.
+    USB_ERROR_VENDOR_REQUEST_ACTIVE,
     USB_ERROR_BASE_HW_INTERFACE = ERROR_BASE_STEP,
     USB_ERROR_BASE_STRING = (USB_ERROR_BASE_HW_INTERFACE + USB_LIB_HW_INTERFACE_ERROR_BASE_LAST),
     // Last base value.
     USB_ERROR_BASE_LAST = (USB_ERROR_BASE_STRING + STRING_ERROR_BASE_LAST)
 } USB_status_t;
 
+/*!******************************************************************
+ * \enum USB_speed_t
+ * \brief USB bus speeds list.
+ *******************************************************************/
+typedef enum {
+    USB_SPEED_LOW = 0,
+    USB_SPEED_FULL,
+    USB_SPEED_HIGH,
+    USB_SPEED_LAST
+} USB_speed_t;
+
+/*!******************************************************************
+ * \enum USB_bus_event_t
+ * \brief USB bus events list.
+ *******************************************************************/
+typedef enum {
+    USB_BUS_EVENT_RESET = 0,
+    USB_BUS_EVENT_SUSPEND,
+    USB_BUS_EVENT_RESUME,
+    USB_BUS_EVENT_LAST
+} USB_bus_event_t;
+
+/*!******************************************************************
+ * \fn USB_bus_event_cb_t
+ * \brief USB bus event callback.
+ *******************************************************************/
+typedef void (*USB_bus_event_cb_t)(USB_bus_event_t bus_event);
+
+/*!******************************************************************
+ * \fn USB_sof_cb_t
+ * \brief USB start of frame callback.
+ *******************************************************************/
+typedef void (*USB_sof_cb_t)(uint16_t frame_number);
+
 /*!******************************************************************
  * \struct USB_data_t
  * \brief USB data structure.
@@ -19,8 +19,146 @@
 
 #if (!(defined USB_LIB_DISABLE) && (defined USBD_CDC))
 
+/*** USBD CDC macros ***/
+
+#define USBD_CDC_NUMBER_OF_INTERFACES           2
+
+#define USBD_CDC_COMM_NUMBER_OF_ENDPOINTS       1
+#define USBD_CDC_DATA_NUMBER_OF_ENDPOINTS       2
+
+#define USBD_CDC_COMM_INTERFACE_DESCRIPTOR_INITIALIZER { \
+    .bLength = sizeof(USB_interface_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE, \
+    .bInterfaceNumber = USBD_CDC_COMM_INTERFACE_INDEX, \
+    .bAlternateSetting = 0, \
+    .bNumEndpoints = USBD_CDC_COMM_NUMBER_OF_ENDPOINTS, \
+    .bInterfaceClass = USB_CLASS_CODE_CDC_CONTROL, \
+    .bInterfaceSubClass = USB_CDC_SUBCLASS_CODE_ABSTRACT, \
+    .bInterfaceProtocol = USB_CDC_PROTOCOL_CODE_NONE, \
+    .iInterface = USBD_CDC_COMM_INTERFACE_STRING_DESCRIPTOR_INDEX \
+}
+
+#define USBD_CDC_DATA_INTERFACE_DESCRIPTOR_INITIALIZER { \
+    .bLength = sizeof(USB_interface_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE, \
+    .bInterfaceNumber = USBD_CDC_DATA_INTERFACE_INDEX, \
+    .bAlternateSetting = 0, \
+    .bNumEndpoints = USBD_CDC_DATA_NUMBER_OF_ENDPOINTS, \
+    .bInterfaceClass = USB_CLASS_CODE_CDC_DATA, \
+    .bInterfaceSubClass = 0, \
+    .bInterfaceProtocol = 0, \
+    .iInterface = USBD_CDC_DATA_INTERFACE_STRING_DESCRIPTOR_INDEX \
+}
+
+#define USBD_CDC_HEADER_DESCRIPTOR_INITIALIZER { \
+    .bFunctionLength = sizeof(USB_CDC_header_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_CLASS_SPECIFIC_INTERFACE, \
+    .bDescriptorSubtype = USB_CDC_DESCRIPTOR_SUBTYPE_HEADER, \
+    .bcdCDC = USB_CDC_DESCRIPTOR_VERSION \
+}
+
+#define USBD_CDC_CALL_DESCRIPTOR_INITIALIZER { \
+    .bFunctionLength = sizeof(USB_CDC_call_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_CLASS_SPECIFIC_INTERFACE, \
+    .bDescriptorSubtype = USB_CDC_DESCRIPTOR_SUBTYPE_CALL, \
+    .bmCapabilities.value = 0x01, \
+    .bDataInterface = USBD_CDC_DATA_INTERFACE_INDEX \
+}
+
+#define USBD_CDC_ABSTRACT_DESCRIPTOR_INITIALIZER { \
+    .bFunctionLength = sizeof(USB_CDC_abstract_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_CLASS_SPECIFIC_INTERFACE, \
+    .bDescriptorSubtype = USB_CDC_DESCRIPTOR_SUBTYPE_ABSTRACT, \
+    .bmCapabilities.value = 0x06 \
+}
+
+#define USBD_CDC_UNION_DESCRIPTOR_INITIALIZER { \
+    .bFunctionLength = sizeof(USB_CDC_union_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_CLASS_SPECIFIC_INTERFACE, \
+    .bDescriptorSubtype = USB_CDC_DESCRIPTOR_SUBTYPE_UNION, \
+    .bControlInterface = USBD_CDC_COMM_INTERFACE_INDEX, \
+    .bSubordinateInterface = USBD_CDC_DATA_INTERFACE_INDEX \
+}
+
+#define USBD_CDC_CS_DESCRIPTOR_INITIALIZER { \
+    .header = USBD_CDC_HEADER_DESCRIPTOR_INITIALIZER, \
+    .call = USBD_CDC_CALL_DESCRIPTOR_INITIALIZER, \
+    .abstract = USBD_CDC_ABSTRACT_DESCRIPTOR_INITIALIZER, \
+    .union_descriptor = USBD_CDC_UNION_DESCRIPTOR_INITIALIZER \
+}
+
+#define USBD_CDC_COMM_EP_IN_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_CDC_COMM_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_IN, USB_ENDPOINT_TRANSFER_TYPE_INTERRUPT, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_CDC_COMM_PACKET_SIZE_BYTES, 255)
+
+#define USBD_CDC_DATA_EP_OUT_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_CDC_DATA_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_OUT, USB_ENDPOINT_TRANSFER_TYPE_BULK, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_CDC_DATA_PACKET_SIZE_BYTES, 1)
+
+#define USBD_CDC_DATA_EP_IN_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_CDC_DATA_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_IN, USB_ENDPOINT_TRANSFER_TYPE_BULK, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_CDC_DATA_PACKET_SIZE_BYTES, 1)
+
+// High speed interrupt interval is expressed as a power of two of micro-frames (2^11 x 125us = 256ms).
+#define USBD_CDC_COMM_EP_IN_HS_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_CDC_COMM_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_IN, USB_ENDPOINT_TRANSFER_TYPE_INTERRUPT, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_CDC_COMM_HS_PACKET_SIZE_BYTES, 12)
+
+#define USBD_CDC_DATA_EP_OUT_HS_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_CDC_DATA_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_OUT, USB_ENDPOINT_TRANSFER_TYPE_BULK, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_CDC_DATA_HS_PACKET_SIZE_BYTES, 1)
+
+#define USBD_CDC_DATA_EP_IN_HS_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_CDC_DATA_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_IN, USB_ENDPOINT_TRANSFER_TYPE_BULK, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_CDC_DATA_HS_PACKET_SIZE_BYTES, 1)
+
+#define USBD_CDC_CONFIGURATION_DESCRIPTOR_INITIALIZER { \
+    .comm_interface = USBD_CDC_COMM_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .header = USBD_CDC_HEADER_DESCRIPTOR_INITIALIZER, \
+    .call = USBD_CDC_CALL_DESCRIPTOR_INITIALIZER, \
+    .abstract = USBD_CDC_ABSTRACT_DESCRIPTOR_INITIALIZER, \
+    .union_descriptor = USBD_CDC_UNION_DESCRIPTOR_INITIALIZER, \
+    .comm_ep_in = USBD_CDC_COMM_EP_IN_DESCRIPTOR_INITIALIZER, \
+    .data_interface = USBD_CDC_DATA_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .data_ep_out = USBD_CDC_DATA_EP_OUT_DESCRIPTOR_INITIALIZER, \
+    .data_ep_in = USBD_CDC_DATA_EP_IN_DESCRIPTOR_INITIALIZER \
+}
+
+#define USBD_CDC_HS_CONFIGURATION_DESCRIPTOR_INITIALIZER { \
+    .comm_interface = USBD_CDC_COMM_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .header = USBD_CDC_HEADER_DESCRIPTOR_INITIALIZER, \
+    .call = USBD_CDC_CALL_DESCRIPTOR_INITIALIZER, \
+    .abstract = USBD_CDC_ABSTRACT_DESCRIPTOR_INITIALIZER, \
+    .union_descriptor = USBD_CDC_UNION_DESCRIPTOR_INITIALIZER, \
+    .comm_ep_in = USBD_CDC_COMM_EP_IN_HS_DESCRIPTOR_INITIALIZER, \
+    .data_interface = USBD_CDC_DATA_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .data_ep_out = USBD_CDC_DATA_EP_OUT_HS_DESCRIPTOR_INITIALIZER, \
+    .data_ep_in = USBD_CDC_DATA_EP_IN_HS_DESCRIPTOR_INITIALIZER \
+}
+
 /*** USBD CDC global structures ***/
 
+/*!******************************************************************
+ * \struct USBD_CDC_cs_descriptor_t
+ * \brief USBD CDC class specific descriptors of the communication interface.
+ *******************************************************************/
+typedef struct {
+    USB_CDC_header_descriptor_t header;
+    USB_CDC_call_descriptor_t call;
+    USB_CDC_abstract_descriptor_t abstract;
+    USB_CDC_union_descriptor_t union_descriptor;
+} __attribute__((packed)) USBD_CDC_cs_descriptor_t;
+
+/*!******************************************************************
+ * \struct USBD_CDC_configuration_descriptor_t
+ * \brief USBD CDC descriptors as they appear in the configuration descriptor.
+ *******************************************************************/
+typedef struct {
+    USB_interface_descriptor_t comm_interface;
+    USB_CDC_header_descriptor_t header;
+    USB_CDC_call_descriptor_t call;
+    USB_CDC_abstract_descriptor_t abstract;
+    USB_CDC_union_descriptor_t union_descriptor;
+    USB_endpoint_descriptor_t comm_ep_in;
+    USB_interface_descriptor_t data_interface;
+    USB_endpoint_descriptor_t data_ep_out;
+    USB_endpoint_descriptor_t data_ep_in;
+} __attribute__((packed)) USBD_CDC_configuration_descriptor_t;
+
 /*!******************************************************************
  * \enum USBD_CDC_stop_bits_t
  * \brief USB CDC stop bits configurations list.
@@ -140,6 +278,16 @@ USB_status_t USBD_CDC_de_init(void);
  *******************************************************************/
 USB_status_t USBD_CDC_write(uint8_t* data, uint32_t data_size_bytes);
 
+/*!******************************************************************
+ * \fn USB_status_t USBD_CDC_submit(uint8_t* data, uint32_t data_size_bytes)
+ * \brief Send data over CDC interface without copy (the buffer must not be modified until the TX completion callback).
+ * \param[in]   data: Byte array to send.
+ * \param[in]   data_size_bytes: Number of bytes to send.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CDC_submit(uint8_t* data, uint32_t data_size_bytes);
+
 #endif /* USB_LIB_DISABLE */
 
 #endif /* __USBD_CDC_H__ */
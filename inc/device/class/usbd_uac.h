@@ -19,8 +19,126 @@
 
 #if (!(defined USB_LIB_DISABLE) && (defined USBD_UAC))
 
+/*** USBD UAC macros ***/
+
+#define USBD_UAC_NUMBER_OF_INTERFACES                   3
+
+#define USBD_UAC_CONTROL_NUMBER_OF_ENDPOINTS            1
+#define USBD_UAC_STREAM_PLAY_NUMBER_OF_ENDPOINTS        1
+#define USBD_UAC_STREAM_RECORD_NUMBER_OF_ENDPOINTS      1
+
+#define USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH    0
+#define USBD_UAC_STREAM_ALTERNATE_SETTING_OPERATIONAL       1
+#define USBD_UAC_STREAM_NUMBER_OF_ALTERNATE_SETTINGS        1
+
+#define USBD_UAC_INTERFACE_ASSOCIATION_DESCRIPTOR_INITIALIZER { \
+    .bLength = sizeof(USB_interface_association_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION, \
+    .bFirstInterface = USBD_UAC_CONTROL_INTERFACE_INDEX, \
+    .bInterfaceCount = USBD_UAC_NUMBER_OF_INTERFACES, \
+    .bFunctionClass = USB_CLASS_CODE_AUDIO, \
+    .bFunctionSubClass = 0, \
+    .bFunctionProtocol = 0, \
+    .iFunction = USBD_UAC_INTERFACE_ASSOCIATION_STRING_DESCRIPTOR_INDEX \
+}
+
+#define USBD_UAC_CONTROL_INTERFACE_DESCRIPTOR_INITIALIZER { \
+    .bLength = sizeof(USB_interface_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE, \
+    .bInterfaceNumber = USBD_UAC_CONTROL_INTERFACE_INDEX, \
+    .bAlternateSetting = 0, \
+    .bNumEndpoints = USBD_UAC_CONTROL_NUMBER_OF_ENDPOINTS, \
+    .bInterfaceClass = USB_CLASS_CODE_AUDIO, \
+    .bInterfaceSubClass = USB_UAC_SUBCLASS_CODE_AUDIO_CONTROL, \
+    .bInterfaceProtocol = USB_UAC_PROTOCOL_CODE_IP_VERSION_02_00, \
+    .iInterface = USBD_UAC_CONTROL_INTERFACE_STRING_DESCRIPTOR_INDEX \
+}
+
+#define USBD_UAC_STREAM_INTERFACE_DESCRIPTOR_INITIALIZER(interface_index, alternate_setting, number_of_endpoints, string_descriptor_index) { \
+    .bLength = sizeof(USB_interface_descriptor_t), \
+    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE, \
+    .bInterfaceNumber = (interface_index), \
+    .bAlternateSetting = (alternate_setting), \
+    .bNumEndpoints = (number_of_endpoints), \
+    .bInterfaceClass = USB_CLASS_CODE_AUDIO, \
+    .bInterfaceSubClass = USB_UAC_SUBCLASS_CODE_AUDIO_STREAMING, \
+    .bInterfaceProtocol = USB_UAC_PROTOCOL_CODE_IP_VERSION_02_00, \
+    .iInterface = (string_descriptor_index) \
+}
+
+#define USBD_UAC_STREAM_PLAY_INTERFACE_DESCRIPTOR_INITIALIZER \
+    USBD_UAC_STREAM_INTERFACE_DESCRIPTOR_INITIALIZER(USBD_UAC_STREAM_PLAY_INTERFACE_INDEX, USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH, 0, USBD_UAC_STREAM_PLAY_INTERFACE_STRING_DESCRIPTOR_INDEX)
+
+#define USBD_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE_DESCRIPTOR_INITIALIZER \
+    USBD_UAC_STREAM_INTERFACE_DESCRIPTOR_INITIALIZER(USBD_UAC_STREAM_PLAY_INTERFACE_INDEX, USBD_UAC_STREAM_ALTERNATE_SETTING_OPERATIONAL, USBD_UAC_STREAM_PLAY_NUMBER_OF_ENDPOINTS, USBD_UAC_STREAM_PLAY_INTERFACE_STRING_DESCRIPTOR_INDEX)
+
+#define USBD_UAC_STREAM_RECORD_INTERFACE_DESCRIPTOR_INITIALIZER \
+    USBD_UAC_STREAM_INTERFACE_DESCRIPTOR_INITIALIZER(USBD_UAC_STREAM_RECORD_INTERFACE_INDEX, USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH, 0, USBD_UAC_STREAM_RECORD_INTERFACE_STRING_DESCRIPTOR_INDEX)
+
+#define USBD_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE_DESCRIPTOR_INITIALIZER \
+    USBD_UAC_STREAM_INTERFACE_DESCRIPTOR_INITIALIZER(USBD_UAC_STREAM_RECORD_INTERFACE_INDEX, USBD_UAC_STREAM_ALTERNATE_SETTING_OPERATIONAL, USBD_UAC_STREAM_RECORD_NUMBER_OF_ENDPOINTS, USBD_UAC_STREAM_RECORD_INTERFACE_STRING_DESCRIPTOR_INDEX)
+
+#define USBD_UAC_CONTROL_EP_IN_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_UAC_CONTROL_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_IN, USB_ENDPOINT_TRANSFER_TYPE_INTERRUPT, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_UAC_CONTROL_PACKET_SIZE_BYTES, 255)
+
+#define USBD_UAC_STREAM_PLAY_EP_OUT_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_UAC_STREAM_PLAY_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_OUT, USB_ENDPOINT_TRANSFER_TYPE_ISOCHRONOUS, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_UAC_STREAM_PLAY_PACKET_SIZE_BYTES, 1)
+
+#define USBD_UAC_STREAM_RECORD_EP_IN_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_UAC_STREAM_RECORD_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_IN, USB_ENDPOINT_TRANSFER_TYPE_ISOCHRONOUS, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_UAC_STREAM_RECORD_PACKET_SIZE_BYTES, 1)
+
+// High speed intervals are expressed as a power of two of micro-frames (2^11 x 125us = 256ms and 2^3 x 125us = 1ms).
+#define USBD_UAC_CONTROL_EP_IN_HS_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_UAC_CONTROL_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_IN, USB_ENDPOINT_TRANSFER_TYPE_INTERRUPT, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_UAC_CONTROL_HS_PACKET_SIZE_BYTES, 12)
+
+#define USBD_UAC_STREAM_PLAY_EP_OUT_HS_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_UAC_STREAM_PLAY_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_OUT, USB_ENDPOINT_TRANSFER_TYPE_ISOCHRONOUS, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_UAC_STREAM_PLAY_HS_PACKET_SIZE_BYTES, 4)
+
+#define USBD_UAC_STREAM_RECORD_EP_IN_HS_DESCRIPTOR_INITIALIZER \
+    USB_ENDPOINT_DESCRIPTOR_INITIALIZER(USBD_UAC_STREAM_RECORD_ENDPOINT_NUMBER, USB_ENDPOINT_DIRECTION_IN, USB_ENDPOINT_TRANSFER_TYPE_ISOCHRONOUS, USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE, USB_ENDPOINT_USAGE_TYPE_DATA, USBD_UAC_STREAM_RECORD_HS_PACKET_SIZE_BYTES, 4)
+
+#define USBD_UAC_CONFIGURATION_DESCRIPTOR_INITIALIZER { \
+    .interface_association = USBD_UAC_INTERFACE_ASSOCIATION_DESCRIPTOR_INITIALIZER, \
+    .control_interface = USBD_UAC_CONTROL_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .control_ep_in = USBD_UAC_CONTROL_EP_IN_DESCRIPTOR_INITIALIZER, \
+    .stream_play_interface = USBD_UAC_STREAM_PLAY_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .stream_play_operational_interface = USBD_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .stream_play_ep_out = USBD_UAC_STREAM_PLAY_EP_OUT_DESCRIPTOR_INITIALIZER, \
+    .stream_record_interface = USBD_UAC_STREAM_RECORD_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .stream_record_operational_interface = USBD_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .stream_record_ep_in = USBD_UAC_STREAM_RECORD_EP_IN_DESCRIPTOR_INITIALIZER \
+}
+
+#define USBD_UAC_HS_CONFIGURATION_DESCRIPTOR_INITIALIZER { \
+    .interface_association = USBD_UAC_INTERFACE_ASSOCIATION_DESCRIPTOR_INITIALIZER, \
+    .control_interface = USBD_UAC_CONTROL_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .control_ep_in = USBD_UAC_CONTROL_EP_IN_HS_DESCRIPTOR_INITIALIZER, \
+    .stream_play_interface = USBD_UAC_STREAM_PLAY_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .stream_play_operational_interface = USBD_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .stream_play_ep_out = USBD_UAC_STREAM_PLAY_EP_OUT_HS_DESCRIPTOR_INITIALIZER, \
+    .stream_record_interface = USBD_UAC_STREAM_RECORD_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .stream_record_operational_interface = USBD_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE_DESCRIPTOR_INITIALIZER, \
+    .stream_record_ep_in = USBD_UAC_STREAM_RECORD_EP_IN_HS_DESCRIPTOR_INITIALIZER \
+}
+
 /*** USBD UAC structures ***/
 
+/*!******************************************************************
+ * \struct USBD_UAC_configuration_descriptor_t
+ * \brief USBD UAC descriptors as they appear in the configuration descriptor.
+ *******************************************************************/
+typedef struct {
+    USB_interface_association_descriptor_t interface_association;
+    USB_interface_descriptor_t control_interface;
+    USB_endpoint_descriptor_t control_ep_in;
+    USB_interface_descriptor_t stream_play_interface;
+    USB_interface_descriptor_t stream_play_operational_interface;
+    USB_endpoint_descriptor_t stream_play_ep_out;
+    USB_interface_descriptor_t stream_record_interface;
+    USB_interface_descriptor_t stream_record_operational_interface;
+    USB_endpoint_descriptor_t stream_record_ep_in;
+} __attribute__((packed)) USBD_UAC_configuration_descriptor_t;
+
 /*!******************************************************************
  * \struct USBD_UAC_callbacks_t
  * \brief USBD UAC driver callbacks.
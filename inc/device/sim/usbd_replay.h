@@ -0,0 +1,101 @@
+/*
+ * usbd_replay.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#ifndef __USBD_REPLAY_H__
+#define __USBD_REPLAY_H__
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_types.h"
+#include "device/sim/usbd_sim.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_SIM) && (defined USBD_REPLAY))
+
+/*** USBD REPLAY structures ***/
+
+/*!******************************************************************
+ * \enum USBD_REPLAY_token_t
+ * \brief Host transactions list of a trace.
+ *******************************************************************/
+typedef enum {
+    USBD_REPLAY_TOKEN_SETUP = 0,
+    USBD_REPLAY_TOKEN_IN,
+    USBD_REPLAY_TOKEN_OUT,
+    USBD_REPLAY_TOKEN_BUS_EVENT,
+    USBD_REPLAY_TOKEN_LAST
+} USBD_REPLAY_token_t;
+
+/*!******************************************************************
+ * \enum USBD_REPLAY_mismatch_t
+ * \brief Device response mismatches list.
+ *******************************************************************/
+typedef enum {
+    USBD_REPLAY_MISMATCH_NONE = 0,
+    USBD_REPLAY_MISMATCH_STATUS,
+    USBD_REPLAY_MISMATCH_HANDSHAKE,
+    USBD_REPLAY_MISMATCH_DATA_SIZE,
+    USBD_REPLAY_MISMATCH_DATA,
+    USBD_REPLAY_MISMATCH_DEVICE_TIME,
+    USBD_REPLAY_MISMATCH_LAST
+} USBD_REPLAY_mismatch_t;
+
+/*!******************************************************************
+ * \struct USBD_REPLAY_record_t
+ * \brief Host transaction of a trace and expected device response.
+ *******************************************************************/
+typedef struct {
+    USBD_REPLAY_token_t token;
+    uint8_t endpoint_number;
+    USB_bus_event_t bus_event;
+    const uint8_t* data;
+    uint32_t data_size_bytes;
+    uint32_t packet_size_bytes;
+    USBD_SIM_handshake_t handshake;
+    uint32_t device_time_max_ns;
+} USBD_REPLAY_record_t;
+
+/*!******************************************************************
+ * \struct USBD_REPLAY_report_t
+ * \brief Result of a trace replay.
+ *******************************************************************/
+typedef struct {
+    uint32_t number_of_records;
+    uint32_t mismatch_index;
+    USBD_REPLAY_mismatch_t mismatch;
+    uint32_t nak_count;
+    uint64_t device_time_ns;
+    uint64_t device_time_max_ns;
+    uint32_t device_time_max_index;
+} USBD_REPLAY_report_t;
+
+/*** USBD REPLAY functions ***/
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_REPLAY_run(const USBD_REPLAY_record_t* record_list, uint32_t number_of_records, USBD_REPLAY_report_t* report)
+ * \brief Issue the transactions of a trace on the simulated device and check its responses, stopping at the first mismatch.
+ * \param[in]   record_list: Transactions to replay.
+ * \param[in]   number_of_records: Number of transactions in the trace.
+ * \param[out]  report: Pointer to the replay result (filled even when a mismatch is detected).
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_REPLAY_run(const USBD_REPLAY_record_t* record_list, uint32_t number_of_records, USBD_REPLAY_report_t* report);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_REPLAY_run_pcap(const char* file_path, uint32_t device_time_max_ns, USBD_REPLAY_report_t* report)
+ * \brief Replay a usbmon pcap file exported by the capture module on the simulated device (only the packet level device side captures of USBD_CAPTURE_export_pcap() are supported, in any endianness and timestamp resolution: host side usbmon captures log URBs instead of packets and are rejected with USB_ERROR_REPLAY_FORMAT).
+ * \param[in]   file_path: Path of the pcap file.
+ * \param[in]   device_time_max_ns: Maximum time spent in the device callbacks by each transaction (0 to disable the check).
+ * \param[out]  report: Pointer to the replay result (filled even when a mismatch is detected).
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_REPLAY_run_pcap(const char* file_path, uint32_t device_time_max_ns, USBD_REPLAY_report_t* report);
+
+#endif /* USB_LIB_DISABLE */
+
+#endif /* __USBD_REPLAY_H__ */
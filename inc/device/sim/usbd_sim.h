@@ -0,0 +1,156 @@
+/*
+ * usbd_sim.h
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: Ludo
+ */
+
+#ifndef __USBD_SIM_H__
+#define __USBD_SIM_H__
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_endpoint.h"
+#include "common/usb_request.h"
+#include "common/usb_types.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_SIM))
+
+/*** USBD SIM structures ***/
+
+/*!******************************************************************
+ * \enum USBD_SIM_handshake_t
+ * \brief Handshakes returned by the simulated device to the virtual host.
+ *******************************************************************/
+typedef enum {
+    USBD_SIM_HANDSHAKE_ACK = 0,
+    USBD_SIM_HANDSHAKE_NAK,
+    USBD_SIM_HANDSHAKE_STALL,
+    USBD_SIM_HANDSHAKE_NONE,
+    USBD_SIM_HANDSHAKE_LAST
+} USBD_SIM_handshake_t;
+
+/*!******************************************************************
+ * \struct USBD_SIM_statistics_t
+ * \brief Traffic statistics of a simulated endpoint.
+ *******************************************************************/
+typedef struct {
+    uint32_t transactions_count;
+    uint32_t bytes_count;
+    uint32_t nak_count;
+    uint32_t stall_count;
+    uint64_t device_time_ns;
+} USBD_SIM_statistics_t;
+
+/*** USBD SIM functions ***/
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_setup(USB_request_t* request, USB_request_operation_t* request_operation)
+ * \brief Issue a SETUP transaction on the control pipe of the simulated device.
+ * \param[in]   request: Pointer to the request to send.
+ * \param[out]  request_operation: Pointer to the operation decoded by the device (USB_REQUEST_OPERATION_NOT_SUPPORTED when the pipe is stalled).
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_setup(USB_request_t* request, USB_request_operation_t* request_operation);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_in(uint8_t endpoint_number, USB_data_t* data_in, USBD_SIM_handshake_t* handshake)
+ * \brief Issue an IN transaction on the simulated device.
+ * \param[in]   endpoint_number: Number of the IN endpoint to poll.
+ * \param[in]   data_in: Pointer to the reception buffer (size_bytes gives its capacity on input).
+ * \param[out]  data_in: Number of bytes sent by the device.
+ * \param[out]  handshake: Pointer to the handshake returned by the device.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_in(uint8_t endpoint_number, USB_data_t* data_in, USBD_SIM_handshake_t* handshake);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_out(uint8_t endpoint_number, USB_data_t* data_out, USBD_SIM_handshake_t* handshake)
+ * \brief Issue an OUT transaction on the simulated device.
+ * \param[in]   endpoint_number: Number of the OUT endpoint to write.
+ * \param[in]   data_out: Pointer to the packet to send (size lower or equal to the endpoint maximum packet size, larger isochronous packets are truncated).
+ * \param[out]  handshake: Pointer to the handshake returned by the device.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_out(uint8_t endpoint_number, USB_data_t* data_out, USBD_SIM_handshake_t* handshake);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_control_transfer(USB_request_t* request, USB_data_t* data)
+ * \brief Perform a complete control transfer (setup, data and status stages) on the simulated device.
+ * \param[in]   request: Pointer to the request to send.
+ * \param[in]   data: Pointer to the data stage buffer (OUT data or IN reception buffer of at least wLength bytes).
+ * \param[out]  data: Number of bytes transferred during the data stage.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_control_transfer(USB_request_t* request, USB_data_t* data);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_enumerate(uint8_t device_address, USB_data_t* configuration_descriptor)
+ * \brief Enumerate the simulated device like a host does (device descriptor, address, configuration descriptor and first configuration selection).
+ * \param[in]   device_address: Address to assign to the device.
+ * \param[in]   configuration_descriptor: Pointer to the reception buffer of the full configuration descriptor (size_bytes gives its capacity on input).
+ * \param[out]  configuration_descriptor: Size of the configuration descriptor read from the device.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_enumerate(uint8_t device_address, USB_data_t* configuration_descriptor);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_bus_event(USB_bus_event_t bus_event)
+ * \brief Signal a bus reset, suspend or resume to the simulated device (host transactions fail while suspended).
+ * \param[in]   bus_event: Bus event to signal.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_bus_event(USB_bus_event_t bus_event);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_set_speed(USB_speed_t speed)
+ * \brief Select the speed reported by the simulated device after bus reset (high speed by default).
+ * \param[in]   speed: Bus speed of the virtual host port.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_set_speed(USB_speed_t speed);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_sof(void)
+ * \brief Signal the start of the current frame to the simulated device (also done by each host transaction when a new frame has started).
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_sof(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_get_address(uint8_t* device_address)
+ * \brief Read the address currently applied by the simulated device.
+ * \param[in]   none
+ * \param[out]  device_address: Pointer to the device address.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_get_address(uint8_t* device_address);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_SIM_get_statistics(uint8_t endpoint_number, USB_endpoint_direction_t endpoint_direction, USBD_SIM_statistics_t* statistics)
+ * \brief Read the traffic statistics of a simulated endpoint.
+ * \param[in]   endpoint_number: Endpoint number.
+ * \param[in]   endpoint_direction: Endpoint direction.
+ * \param[out]  statistics: Pointer to the endpoint statistics.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_SIM_get_statistics(uint8_t endpoint_number, USB_endpoint_direction_t endpoint_direction, USBD_SIM_statistics_t* statistics);
+
+/*!******************************************************************
+ * \fn void USBD_SIM_reset_statistics(void)
+ * \brief Clear the traffic statistics of all simulated endpoints.
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      none
+ *******************************************************************/
+void USBD_SIM_reset_statistics(void);
+
+#endif /* USB_LIB_DISABLE */
+
+#endif /* __USBD_SIM_H__ */
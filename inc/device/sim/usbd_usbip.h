@@ -0,0 +1,50 @@
+/*
+ * usbd_usbip.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#ifndef __USBD_USBIP_H__
+#define __USBD_USBIP_H__
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_types.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_SIM) && (defined USBD_USBIP))
+
+/*** USBD USBIP functions ***/
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_USBIP_init(void)
+ * \brief Open the USB/IP server socket exporting the simulated device on the loopback interface.
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_USBIP_init(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_USBIP_de_init(void)
+ * \brief Close the USB/IP client connection and the server socket.
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_USBIP_de_init(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_USBIP_process(uint32_t timeout_ms)
+ * \brief Serve pending USB/IP requests and poll the queued IN transfers (to be called periodically by the application).
+ * \param[in]   timeout_ms: Maximum time to wait for a request from the client.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_USBIP_process(uint32_t timeout_ms);
+
+#endif /* USB_LIB_DISABLE */
+
+#endif /* __USBD_USBIP_H__ */
@@ -17,7 +17,6 @@
 #include "common/usb_request.h"
 #include "common/usb_types.h"
 #include "error.h"
-#include "strings.h"
 #include "types.h"
 
 /*** USBD CONTROL structures ***/
@@ -26,7 +25,7 @@
 
 /*!******************************************************************
  * \fn USB_control_set_configuration_cb_t
- * \brief USBD CONTROL set configuration request callback.
+ * \brief USBD CONTROL set configuration request callback (called with the bConfigurationValue selected by the host, 0 meaning that the device returns to the address state; the current configuration is kept if an error is returned).
  *******************************************************************/
 typedef USB_status_t (*USB_control_set_configuration_cb_t)(uint8_t index);
 
@@ -39,6 +38,41 @@ typedef struct {
     USB_request_cb_t vendor_request;
 } USBD_CONTROL_callbacks_t;
 
+/*!******************************************************************
+ * \struct USBD_CONTROL_vendor_request_t
+ * \brief USBD CONTROL vendor request handler (the vendor_request callback is only called for requests without registered handler).
+ *******************************************************************/
+typedef struct {
+    uint8_t bRequest;
+    USB_request_recipient_t recipient;
+    USB_request_direction_t direction;
+    uint16_t max_length;
+    USB_request_cb_t callback;
+} USBD_CONTROL_vendor_request_t;
+
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+/*!******************************************************************
+ * \enum USBD_CONTROL_latency_stage_t
+ * \brief USBD CONTROL instrumented transfer stages (durations are measured from the setup packet reception).
+ *******************************************************************/
+typedef enum {
+    USBD_CONTROL_LATENCY_STAGE_CALLBACK = 0,
+    USBD_CONTROL_LATENCY_STAGE_DATA,
+    USBD_CONTROL_LATENCY_STAGE_STATUS,
+    USBD_CONTROL_LATENCY_STAGE_LAST
+} USBD_CONTROL_latency_stage_t;
+
+/*!******************************************************************
+ * \struct USBD_CONTROL_latency_histogram_t
+ * \brief USBD CONTROL latency histogram of one request and one stage.
+ *******************************************************************/
+typedef struct {
+    uint32_t count;
+    uint32_t max_cycles;
+    uint16_t bin[USBD_CONTROL_LATENCY_HISTOGRAM_NUMBER_OF_BINS];
+} USBD_CONTROL_latency_histogram_t;
+#endif
+
 /*** USBD CONTROL global variables ***/
 
 extern const USB_interface_t USBD_CONTROL_INTERFACE;
@@ -64,6 +98,110 @@ USB_status_t USBD_CONTROL_init(const USB_device_t* device, USBD_CONTROL_callback
  *******************************************************************/
 USB_status_t USBD_CONTROL_de_init(void);
 
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_invalidate_descriptor_cache(void)
+ * \brief Invalidate the cached configuration descriptor (to be called when a class descriptor changes).
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_invalidate_descriptor_cache(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_get_speed(USB_speed_t* speed)
+ * \brief Read the bus speed selecting the active descriptor set (full speed if the peripheral does not report it).
+ * \param[in]   none
+ * \param[out]  speed: Pointer to the current bus speed.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_get_speed(USB_speed_t* speed);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_bus_event(USB_bus_event_t bus_event)
+ * \brief Forward a bus event to the configured interfaces (a reset also returns the device to the default state).
+ * \param[in]   bus_event: Bus event reported by the peripheral.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_bus_event(USB_bus_event_t bus_event);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_sof(uint16_t frame_number)
+ * \brief Forward a start of frame notification to the configured interfaces.
+ * \param[in]   frame_number: Frame number reported by the peripheral.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_sof(uint16_t frame_number);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_defer_request(uint32_t* request_tag)
+ * \brief Defer the answer of the current control request (to be called from the request callback, which then returns USB_SUCCESS).
+ * \param[in]   none
+ * \param[out]  request_tag: Pointer to the tag identifying the request in the completion functions.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_defer_request(uint32_t* request_tag);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_complete_request(uint32_t request_tag, USB_data_t* data_in)
+ * \brief Complete a deferred control request (can be called from task context, USB_ERROR_NO_DEFERRED_REQUEST is returned if a new setup packet aborted it).
+ * \param[in]   request_tag: Tag given by USBD_CONTROL_defer_request().
+ * \param[in]   data_in: Answer of device to host requests (ignored for host to device requests).
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_complete_request(uint32_t request_tag, USB_data_t* data_in);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_fail_request(uint32_t request_tag)
+ * \brief Reject a deferred control request by stalling the control pipe (can be called from task context).
+ * \param[in]   request_tag: Tag given by USBD_CONTROL_defer_request().
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_fail_request(uint32_t request_tag);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_register_vendor_request(const USBD_CONTROL_vendor_request_t* vendor_request)
+ * \brief Register a vendor request handler (requests whose wLength exceeds max_length are stalled before the handler is called). Can be called while the device is running, the table update is protected by USBD_HW_enter_critical().
+ * \param[in]   vendor_request: Pointer to the handler to register (must remain valid until it is unregistered).
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_register_vendor_request(const USBD_CONTROL_vendor_request_t* vendor_request);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_unregister_vendor_request(const USBD_CONTROL_vendor_request_t* vendor_request)
+ * \brief Remove a vendor request handler (USB_ERROR_VENDOR_REQUEST_ACTIVE is returned while the handler is processing a control transfer).
+ * \param[in]   vendor_request: Pointer to the handler to remove.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_unregister_vendor_request(const USBD_CONTROL_vendor_request_t* vendor_request);
+
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_get_latency_histogram(USB_request_type_t request_type, uint8_t bRequest, USBD_CONTROL_latency_stage_t stage, const USBD_CONTROL_latency_histogram_t** histogram)
+ * \brief Get the latency histogram of a control request.
+ * \param[in]   request_type: Type of the request.
+ * \param[in]   bRequest: Request code.
+ * \param[in]   stage: Transfer stage to read.
+ * \param[out]  histogram: Pointer to the histogram.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_get_latency_histogram(USB_request_type_t request_type, uint8_t bRequest, USBD_CONTROL_latency_stage_t stage, const USBD_CONTROL_latency_histogram_t** histogram);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CONTROL_reset_latency_histograms(void)
+ * \brief Clear all control requests latency histograms.
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CONTROL_reset_latency_histograms(void);
+#endif
+
 #endif /* USB_LIB_DISABLE */
 
 #endif /* __USBD_CONTROL_H__ */
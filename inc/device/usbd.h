@@ -11,6 +11,7 @@
 #ifndef USB_LIB_DISABLE_FLAGS_FILE
 #include "usb_lib_flags.h"
 #endif
+#include "common/usb_endpoint.h"
 #include "common/usb_types.h"
 #include "types.h"
 
@@ -54,6 +55,110 @@ USB_status_t USBD_start(void);
  *******************************************************************/
 USB_status_t USBD_stop(void);
 
+/*!******************************************************************
+ * \fn USB_status_t USBD_register_bus_event_callback(USB_bus_event_cb_t bus_event_callback)
+ * \brief Register application bus event callback (called after the classes on reset and suspend, before them on resume).
+ * \param[in]   bus_event_callback: Function to call on bus reset, suspend and resume events (NULL to unregister).
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_register_bus_event_callback(USB_bus_event_cb_t bus_event_callback);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_get_bus_event_status(USB_status_t* last_error, uint32_t* error_count)
+ * \brief Read the number of bus events which the control pipe or a class driver failed to apply since USBD_init(), and the last error.
+ * \param[in]   none
+ * \param[out]  last_error: Pointer to the status of the last failed bus event (USB_SUCCESS if none).
+ * \param[out]  error_count: Pointer to the number of failed bus events.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_get_bus_event_status(USB_status_t* last_error, uint32_t* error_count);
+
+#ifdef USBD_SOF
+/*!******************************************************************
+ * \fn USB_status_t USBD_register_sof_callback(USB_sof_cb_t sof_callback)
+ * \brief Register application start of frame callback (called every USBD_SOF_DECIMATION frames, after the classes).
+ * \param[in]   sof_callback: Function to call on decimated start of frame events (NULL to unregister).
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_register_sof_callback(USB_sof_cb_t sof_callback);
+#endif
+
+#ifdef USBD_EVENT_QUEUE
+/*!******************************************************************
+ * \fn USB_status_t USBD_process(void)
+ * \brief Process the peripheral events queued by the interrupt (to be called from the main loop or a task).
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_process(void);
+#endif
+
+/*** USBD data functions ***/
+
+// The following functions wrap the USBD_HW data functions and record the traffic when USBD_CAPTURE is enabled.
+// Class drivers and applications driving endpoints directly (e.g. isochronous audio streams) must use them instead of the USBD_HW functions.
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_read_setup(USB_data_t* usb_setup_out)
+ * \brief Read the last setup packet received on the control endpoint (see USBD_HW_read_setup()).
+ * \param[in]   none
+ * \param[out]  usb_setup_out: Pointer to the setup packet.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_read_setup(USB_data_t* usb_setup_out);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_read_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out)
+ * \brief Read data received on an OUT endpoint (see USBD_HW_read_data()).
+ * \param[in]   endpoint: Physical endpoint to read.
+ * \param[out]  usb_data_out: Pointer to the data read.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_read_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_write_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in)
+ * \brief Write data to an IN endpoint (see USBD_HW_write_data()).
+ * \param[in]   endpoint: Physical endpoint to write.
+ * \param[in]   usb_data_in: Pointer to the data to send.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_write_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_write_data_vector(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in_list, uint8_t number_of_segments)
+ * \brief Write a packet made of several segments to an IN endpoint (see USBD_HW_write_data_vector()).
+ * \param[in]   endpoint: Physical endpoint to write.
+ * \param[in]   usb_data_in_list: List of segments to send.
+ * \param[in]   number_of_segments: Number of segments in the list.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_write_data_vector(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in_list, uint8_t number_of_segments);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_submit_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in)
+ * \brief Hand a buffer over to the peripheral for transmission on an IN endpoint (see USBD_HW_submit_data()).
+ * \param[in]   endpoint: Physical endpoint to write.
+ * \param[in]   usb_data_in: Pointer to the buffer to send.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_submit_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_acquire_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out)
+ * \brief Take the buffer filled by the peripheral on an OUT endpoint (see USBD_HW_acquire_data()).
+ * \param[in]   endpoint: Physical endpoint to read.
+ * \param[out]  usb_data_out: Pointer to the received data.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_acquire_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out);
+
 /*******************************************************************/
 #define USBD_exit_error(base) { ERROR_check_exit(usbd_status, USBD_SUCCESS, base) }
 
@@ -0,0 +1,97 @@
+/*
+ * usbd_capture.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#ifndef __USBD_CAPTURE_H__
+#define __USBD_CAPTURE_H__
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_endpoint.h"
+#include "common/usb_types.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_CAPTURE))
+
+/*** USBD CAPTURE structures ***/
+
+/*!******************************************************************
+ * \enum USBD_CAPTURE_transaction_t
+ * \brief Captured transactions list.
+ *******************************************************************/
+typedef enum {
+    USBD_CAPTURE_TRANSACTION_SETUP = 0,
+    USBD_CAPTURE_TRANSACTION_DATA,
+    USBD_CAPTURE_TRANSACTION_LAST
+} USBD_CAPTURE_transaction_t;
+
+/*!******************************************************************
+ * \fn USBD_CAPTURE_write_cb_t
+ * \brief Capture export output callback.
+ *******************************************************************/
+typedef USB_status_t (*USBD_CAPTURE_write_cb_t)(uint8_t* data, uint32_t size_bytes);
+
+/*** USBD CAPTURE functions ***/
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CAPTURE_start(void)
+ * \brief Start recording the traffic of the USBD data functions in the capture ring buffer (oldest records are overwritten when full).
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CAPTURE_start(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CAPTURE_stop(void)
+ * \brief Stop recording the endpoints traffic.
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CAPTURE_stop(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CAPTURE_clear(void)
+ * \brief Remove all records from the capture ring buffer.
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CAPTURE_clear(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_CAPTURE_export_pcap(USBD_CAPTURE_write_cb_t write_callback)
+ * \brief Serialize the stopped capture as a Linux usbmon pcap file (LINKTYPE_USB_LINUX_MMAPPED), oldest record first.
+ * \param[in]   write_callback: Function called with each chunk of the file.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_CAPTURE_export_pcap(USBD_CAPTURE_write_cb_t write_callback);
+
+/*!******************************************************************
+ * \fn void USBD_CAPTURE_record(USBD_CAPTURE_transaction_t transaction, USB_physical_endpoint_t* endpoint, USB_data_t* data_list, uint8_t number_of_segments)
+ * \brief Record a transaction exchanged with the peripheral (called by the USBD data functions which wrap the hardware interface).
+ * \param[in]   transaction: Transaction type.
+ * \param[in]   endpoint: Physical endpoint of the transaction (NULL for setup packets).
+ * \param[in]   data_list: Segments of the setup packet or data read from or written to the endpoint.
+ * \param[in]   number_of_segments: Number of segments in the list.
+ * \param[out]  none
+ * \retval      none
+ *******************************************************************/
+void USBD_CAPTURE_record(USBD_CAPTURE_transaction_t transaction, USB_physical_endpoint_t* endpoint, USB_data_t* data_list, uint8_t number_of_segments);
+
+#endif /* USB_LIB_DISABLE */
+
+/*******************************************************************/
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_CAPTURE))
+#define USBD_CAPTURE_transaction(transaction, endpoint, data_list, number_of_segments) { USBD_CAPTURE_record(transaction, endpoint, data_list, number_of_segments); }
+#else
+#define USBD_CAPTURE_transaction(transaction, endpoint, data_list, number_of_segments)
+#endif
+
+#endif /* __USBD_CAPTURE_H__ */
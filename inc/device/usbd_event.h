@@ -0,0 +1,129 @@
+/*
+ * usbd_event.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#ifndef __USBD_EVENT_H__
+#define __USBD_EVENT_H__
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_endpoint.h"
+#include "common/usb_request.h"
+#include "common/usb_types.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_EVENT_QUEUE))
+
+/*** USBD EVENT structures ***/
+
+/*!******************************************************************
+ * \enum USBD_EVENT_type_t
+ * \brief Queued peripheral events list.
+ *******************************************************************/
+typedef enum {
+    USBD_EVENT_TYPE_SETUP = 0,
+    USBD_EVENT_TYPE_ENDPOINT,
+    USBD_EVENT_TYPE_BUS,
+    USBD_EVENT_TYPE_LAST
+} USBD_EVENT_type_t;
+
+/*!******************************************************************
+ * \struct USBD_EVENT_t
+ * \brief Peripheral event record (callback to execute and its arguments).
+ *******************************************************************/
+typedef struct {
+    USBD_EVENT_type_t type;
+    union {
+        struct {
+            USB_setup_cb_t callback;
+        } setup;
+        struct {
+            USB_physical_endpoint_t* physical_endpoint;
+            uint32_t size_bytes;
+            USB_endpoint_transfer_status_t transfer_status;
+            uint16_t frame_number;
+        } endpoint;
+        struct {
+            USB_bus_event_cb_t callback;
+            USB_bus_event_t bus_event;
+        } bus;
+    };
+} USBD_EVENT_t;
+
+/*** USBD EVENT functions ***/
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_EVENT_push_setup(USB_setup_cb_t setup_callback)
+ * \brief Queue a setup packet reception (to be called by the peripheral interrupt instead of the setup callback). The request operation is not returned since the callback runs later: unsupported requests are reported by a stall of the control pipe. When USB_ERROR_EVENT_QUEUE_FULL is returned, the setup packet is lost and the control pipe is left without response: the driver must stall both directions of endpoint 0 so that the host fails the request (the next setup packet clears the stall).
+ * \param[in]   setup_callback: Setup callback registered by the stack.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_EVENT_push_setup(USB_setup_cb_t setup_callback);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_EVENT_push_endpoint(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number)
+ * \brief Queue an endpoint transfer completion (to be called by the peripheral interrupt instead of the endpoint callback). When USB_ERROR_EVENT_QUEUE_FULL is returned, the stack is never notified and the endpoint stays stuck (an OUT packet is never read and the reception is never re-armed, an IN transfer never completes): the driver must keep the endpoint NAKing and push the event again once the queue has been drained, typically from the next interrupt.
+ * \param[in]   physical_endpoint: Pointer to the physical endpoint.
+ * \param[in]   size_bytes: Number of bytes transferred.
+ * \param[in]   transfer_status: Transfer completion status.
+ * \param[in]   frame_number: Frame number of the transfer.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_EVENT_push_endpoint(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_EVENT_push_bus_event(USB_bus_event_cb_t bus_event_callback, USB_bus_event_t bus_event)
+ * \brief Queue a bus reset, suspend or resume event (to be called by the peripheral interrupt instead of the bus event callback).
+ * \param[in]   bus_event_callback: Bus event callback registered by the stack.
+ * \param[in]   bus_event: Bus event.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_EVENT_push_bus_event(USB_bus_event_cb_t bus_event_callback, USB_bus_event_t bus_event);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_EVENT_push_sof(USB_sof_cb_t sof_callback, uint16_t frame_number)
+ * \brief Post a start of frame instead of calling the start of frame callback (only the last one is kept, and it is processed before the queued events).
+ * \param[in]   sof_callback: Start of frame callback registered by the stack.
+ * \param[in]   frame_number: Frame number.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_EVENT_push_sof(USB_sof_cb_t sof_callback, uint16_t frame_number);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_EVENT_process(uint32_t* number_of_events)
+ * \brief Execute the callbacks of the events queued before the call, in order (single consumer).
+ * \param[in]   none
+ * \param[out]  number_of_events: Pointer to the number of processed events (can be NULL).
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_EVENT_process(uint32_t* number_of_events);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_EVENT_flush(void)
+ * \brief Drop all queued events (the peripheral interrupt must be disabled).
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_EVENT_flush(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_EVENT_get_overflow_count(uint32_t* overflow_count)
+ * \brief Get the number of events dropped because the queue was full.
+ * \param[in]   none
+ * \param[out]  overflow_count: Pointer to the number of dropped events.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_EVENT_get_overflow_count(uint32_t* overflow_count);
+
+#endif /* USB_LIB_DISABLE */
+
+#endif /* __USBD_EVENT_H__ */
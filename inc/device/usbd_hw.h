@@ -39,16 +39,34 @@ USB_status_t USBD_HW_de_init(void);
 
 /*!******************************************************************
  * \fn USB_status_t USBD_HW_register_setup_callback(USB_setup_cb_t setup_callback)
- * \brief Register specific setup callback.
+ * \brief Register specific setup callback (the peripheral must not handle the status stage of control transfers by itself: the control driver writes the status zero length packet of OUT and no data requests with USBD_HW_write_data(), and receives the status packet of IN requests through the OUT endpoint callback).
  * \param[in]   setup_callback: Function to call on setup event.
  * \param[out]  none
  * \retval      Function execution status.
  *******************************************************************/
 USB_status_t USBD_HW_register_setup_callback(USB_setup_cb_t setup_callback);
 
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_register_bus_event_callback(USB_bus_event_cb_t bus_event_callback)
+ * \brief Register bus event callback (reset is reported once the peripheral is back to address 0 with its registered endpoints cleared from halt).
+ * \param[in]   bus_event_callback: Function to call on bus reset, suspend and resume events.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_register_bus_event_callback(USB_bus_event_cb_t bus_event_callback);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_register_sof_callback(USB_sof_cb_t sof_callback)
+ * \brief Register start of frame callback (called on each frame or microframe, with the frame number).
+ * \param[in]   sof_callback: Function to call on start of frame event.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_register_sof_callback(USB_sof_cb_t sof_callback);
+
 /*!******************************************************************
  * \fn USB_status_t USBD_HW_register_endpoint(USB_physical_endpoint_t* endpoint)
- * \brief Register end-point in the USB peripheral.
+ * \brief Register end-point in the USB peripheral (USB_ERROR_ENDPOINT_BUFFER_MODE is returned when the requested buffering is not supported, buffer offsets are given by USBD_PMA_get_buffer() when USBD_PMA is defined).
  * \param[in]   endpoint: Pointer to the physical endpoint to register.
  * \param[out]  none
  * \retval      Function execution status.
@@ -64,6 +82,24 @@ USB_status_t USBD_HW_register_endpoint(USB_physical_endpoint_t* endpoint);
  *******************************************************************/
 USB_status_t USBD_HW_unregister_endpoint(USB_physical_endpoint_t* endpoint);
 
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_set_stall(USB_physical_endpoint_t* endpoint)
+ * \brief Halt end-point (all further transactions are answered with STALL).
+ * \param[in]   endpoint: Pointer to the physical endpoint to halt.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_set_stall(USB_physical_endpoint_t* endpoint);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_clear_stall(USB_physical_endpoint_t* endpoint)
+ * \brief Clear end-point halt condition and reset its data toggle.
+ * \param[in]   endpoint: Pointer to the physical endpoint to resume.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_clear_stall(USB_physical_endpoint_t* endpoint);
+
 /*!******************************************************************
  * \fn USB_status_t USBD_HW_set_address(uint8_t device_address)
  * \brief Set USB device address.
@@ -73,6 +109,33 @@ USB_status_t USBD_HW_unregister_endpoint(USB_physical_endpoint_t* endpoint);
  *******************************************************************/
 USB_status_t USBD_HW_set_address(uint8_t device_address);
 
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_set_control_status_pending(void)
+ * \brief NAK the data and status stages of the current control transfer until the control driver writes on the IN endpoint or stalls the pipe.
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_set_control_status_pending(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_enter_critical(void)
+ * \brief Prevent the stack callbacks from running (peripheral interrupt, or USBD_process() when USBD_EVENT_QUEUE is defined) while the stack is updated from another context.
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_enter_critical(void);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_exit_critical(void)
+ * \brief Allow the stack callbacks to run again.
+ * \param[in]   none
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_exit_critical(void);
+
 /*!******************************************************************
  * \fn USB_status_t USBD_HW_start(void)
  * \brief Start USB peripheral.
@@ -93,24 +156,63 @@ USB_status_t USBD_HW_stop(void);
 
 /*!******************************************************************
  * \fn USB_status_t USBD_HW_write_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in)
- * \brief Write data bytes to USB bus.
+ * \brief Write a single packet to USB bus.
  * \param[in]   endpoint: Pointer to the physical endpoint to use.
- * \param[in]   usb_data_in: Pointer to the data to write.
+ * \param[in]   usb_data_in: Pointer to the packet to write (size lower or equal to the endpoint maximum packet size, 0 for a zero length packet).
  * \param[out]  none
  * \retval      Function execution status.
  *******************************************************************/
 USB_status_t USBD_HW_write_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in);
 
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_write_data_vector(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in_list, uint8_t number_of_segments)
+ * \brief Write a single packet gathered from several segments to USB bus (the default implementation passes a single segment to USBD_HW_write_data(), and copies several segments into a buffer of USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES under critical section when this flag is defined).
+ * \param[in]   endpoint: Pointer to the physical endpoint to use.
+ * \param[in]   usb_data_in_list: Segments to write in order (total size lower or equal to the endpoint maximum packet size, 0 for a zero length packet).
+ * \param[in]   number_of_segments: Number of segments in the list.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_write_data_vector(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in_list, uint8_t number_of_segments);
+
 /*!******************************************************************
  * \fn USB_status_t USBD_HW_read_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out)
- * \brief Read data bytes from USB bus.
+ * \brief Read the oldest packet received on USB bus and re-arm the endpoint reception (its size is also given to the endpoint callback).
  * \param[in]   endpoint: Pointer to the physical endpoint to use.
- * \param[out]  usb_data_out: Pointer to the data to read.
+ * \param[out]  usb_data_out: Pointer to the received packet.
  * \param[out]  none
  * \retval      Function execution status.
  *******************************************************************/
 USB_status_t USBD_HW_read_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out);
 
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_submit_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in)
+ * \brief Transmit a single packet directly from a caller buffer, which is owned by the peripheral until the endpoint completion callback.
+ * \param[in]   endpoint: Pointer to the physical endpoint to use.
+ * \param[in]   usb_data_in: Pointer to the packet to transmit (size lower or equal to the endpoint maximum packet size, 0 for a zero length packet).
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_submit_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_acquire_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out)
+ * \brief Borrow the packet memory of the oldest packet received (the endpoint answers NAK until the buffer is released).
+ * \param[in]   endpoint: Pointer to the physical endpoint to use.
+ * \param[out]  usb_data_out: Pointer to the received packet in peripheral memory.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_acquire_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_release_data(USB_physical_endpoint_t* endpoint)
+ * \brief Give the packet memory acquired with USBD_HW_acquire_data() back to the peripheral and re-arm the endpoint reception.
+ * \param[in]   endpoint: Pointer to the physical endpoint to use.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_release_data(USB_physical_endpoint_t* endpoint);
+
 /*!******************************************************************
  * \fn USB_status_t USBD_HW_read_setup(USB_data_t* usb_data_out)
  * \brief Read setup bytes from USB bus control pipe.
@@ -120,6 +222,55 @@ USB_status_t USBD_HW_read_data(USB_physical_endpoint_t* endpoint, USB_data_t* us
  *******************************************************************/
 USB_status_t USBD_HW_read_setup(USB_data_t* usb_setup_out);
 
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_get_unique_id(USB_data_t* unique_id)
+ * \brief Read MCU unique identifier (used to generate the serial number string descriptor, which is not provided if the function is not implemented).
+ * \param[in]   none
+ * \param[out]  unique_id: Pointer to the unique ID bytes.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_get_unique_id(USB_data_t* unique_id);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_get_speed(USB_speed_t* speed)
+ * \brief Read the bus speed negotiated during the last USB reset (endpoints are configured with the maximum packet size of this speed).
+ * \param[in]   none
+ * \param[out]  speed: Pointer to the current bus speed.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_get_speed(USB_speed_t* speed);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_get_frame_number(uint16_t* frame_number)
+ * \brief Read the frame number of the last start of frame packet received.
+ * \param[in]   none
+ * \param[out]  frame_number: Pointer to the 11-bits frame number.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_get_frame_number(uint16_t* frame_number);
+
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_get_cycle_count(uint32_t* cycle_count)
+ * \brief Read a free running cycle counter (used by the control transfers latency instrumentation).
+ * \param[in]   none
+ * \param[out]  cycle_count: Pointer to the current counter value.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_get_cycle_count(uint32_t* cycle_count);
+#endif
+
+#ifdef USBD_CAPTURE
+/*!******************************************************************
+ * \fn USB_status_t USBD_HW_get_time_us(uint64_t* time_us)
+ * \brief Read the wall clock time since the Unix epoch (used to timestamp the captured transactions).
+ * \param[in]   none
+ * \param[out]  time_us: Pointer to the current time in microseconds.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_HW_get_time_us(uint64_t* time_us);
+#endif
+
 #endif /* USB_LIB_DISABLE */
 
 #endif /* __USBD_HW_H__ */
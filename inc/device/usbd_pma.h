@@ -0,0 +1,53 @@
+/*
+ * usbd_pma.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#ifndef __USBD_PMA_H__
+#define __USBD_PMA_H__
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_device.h"
+#include "common/usb_endpoint.h"
+#include "common/usb_types.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_PMA))
+
+/*** USBD PMA functions ***/
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_PMA_allocate(const USB_device_t* device)
+ * \brief Lay out the packet memory buffers of all the endpoints declared in the device configurations (called by the control pipe initialization).
+ * \param[in]   device: Pointer to the device to allocate.
+ * \param[out]  none
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_PMA_allocate(const USB_device_t* device);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_PMA_get_buffer(USB_physical_endpoint_t* endpoint, uint8_t buffer_index, uint32_t* offset)
+ * \brief Get the packet memory offset of an endpoint buffer (to be called by the peripheral driver when registering the endpoint).
+ * \param[in]   endpoint: Pointer to the physical endpoint.
+ * \param[in]   buffer_index: Buffer index (1 is only valid in double buffer mode).
+ * \param[out]  offset: Pointer to the buffer offset in bytes from the start of the packet memory.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_PMA_get_buffer(USB_physical_endpoint_t* endpoint, uint8_t buffer_index, uint32_t* offset);
+
+/*!******************************************************************
+ * \fn USB_status_t USBD_PMA_get_free_space(uint32_t* free_space_bytes)
+ * \brief Get the packet memory size left after the current layout.
+ * \param[in]   none
+ * \param[out]  free_space_bytes: Pointer to the number of unused bytes.
+ * \retval      Function execution status.
+ *******************************************************************/
+USB_status_t USBD_PMA_get_free_space(uint32_t* free_space_bytes);
+
+#endif /* USB_LIB_DISABLE */
+
+#endif /* __USBD_PMA_H__ */
@@ -16,6 +16,8 @@
 #include "common/usb_interface.h"
 #include "common/usb_request.h"
 #include "common/usb_types.h"
+#include "device/standard/usbd_control.h"
+#include "device/usbd.h"
 #include "device/usbd_hw.h"
 #include "types.h"
 
@@ -23,29 +25,30 @@
 
 /*** USBD CDC local macros ***/
 
-#define USBD_CDC_CS_DESCRIPTOR_BUFFER_SIZE_BYTES    256
-#define USBD_CDC_CS_DESCRIPTOR_LENGTH_INDEX         0
+#ifdef USBD_CDC_DATA_DOUBLE_BUFFER
+#define USBD_CDC_DATA_BUFFER_MODE   USB_ENDPOINT_BUFFER_MODE_DOUBLE
+#else
+#define USBD_CDC_DATA_BUFFER_MODE   USB_ENDPOINT_BUFFER_MODE_SINGLE
+#endif
 
 /*** USBD CDC local structures ***/
 
 /*******************************************************************/
 typedef enum {
     USBD_CDC_COMM_ENDPOINT_INDEX_IN = 0,
-    USBD_CDC_COMM_ENDPOINT_INDEX_LAST
+    USBD_CDC_COMM_ENDPOINT_INDEX_LAST = USBD_CDC_COMM_NUMBER_OF_ENDPOINTS
 } USBD_CDC_comm_endpoint_index_t;
 
 /*******************************************************************/
 typedef enum {
     USBD_CDC_DATA_ENDPOINT_INDEX_OUT = 0,
     USBD_CDC_DATA_ENDPOINT_INDEX_IN,
-    USBD_CDC_DATA_ENDPOINT_INDEX_LAST
+    USBD_CDC_DATA_ENDPOINT_INDEX_LAST = USBD_CDC_DATA_NUMBER_OF_ENDPOINTS
 } USBD_CDC_data_endpoint_index_t;
 
 /*******************************************************************/
 typedef struct {
     USBD_CDC_callbacks_t* callbacks;
-    uint8_t cs_descriptor[USBD_CDC_CS_DESCRIPTOR_BUFFER_SIZE_BYTES];
-    uint8_t cs_descriptor_length;
     USB_CDC_line_coding_t line_coding;
     USB_data_t data_out;
     USB_data_t data_in;
@@ -53,11 +56,10 @@ typedef struct {
 
 /*** USBD CDC local functions declaration ***/
 
-static void _USBD_CDC_COMM_endpoint_in_callback(void);
-static void _USBD_CDC_DATA_endpoint_out_callback(void);
-static void _USBD_CDC_DATA_endpoint_in_callback(void);
+static void _USBD_CDC_endpoint_callback(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number);
 
 static USB_status_t _USBD_CDC_COMM_request_callback(USB_request_t* request, USB_data_t* data_out, USB_data_t* data_in);
+static USB_status_t _USBD_CDC_COMM_bus_event_callback(USB_bus_event_t bus_event);
 
 /*** USB CDC local global variables ***/
 
@@ -68,7 +70,9 @@ static const USB_physical_endpoint_t USBD_CDC_COMM_EP_PHY_IN = {
     .synchronization_type = USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE,
     .usage_type = USB_ENDPOINT_USAGE_TYPE_DATA,
     .max_packet_size_bytes = USBD_CDC_COMM_PACKET_SIZE_BYTES,
-    .callback = &_USBD_CDC_COMM_endpoint_in_callback
+    .high_speed_max_packet_size_bytes = USBD_CDC_COMM_HS_PACKET_SIZE_BYTES,
+    .buffer_mode = USB_ENDPOINT_BUFFER_MODE_SINGLE,
+    .callback = &_USBD_CDC_endpoint_callback
 };
 
 static const USB_physical_endpoint_t USBD_CDC_DATA_EP_PHY_OUT = {
@@ -78,7 +82,9 @@ static const USB_physical_endpoint_t USBD_CDC_DATA_EP_PHY_OUT = {
     .synchronization_type = USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE,
     .usage_type = USB_ENDPOINT_USAGE_TYPE_DATA,
     .max_packet_size_bytes = USBD_CDC_DATA_PACKET_SIZE_BYTES,
-    .callback = &_USBD_CDC_DATA_endpoint_out_callback
+    .high_speed_max_packet_size_bytes = USBD_CDC_DATA_HS_PACKET_SIZE_BYTES,
+    .buffer_mode = USBD_CDC_DATA_BUFFER_MODE,
+    .callback = &_USBD_CDC_endpoint_callback
 };
 
 static const USB_physical_endpoint_t USBD_CDC_DATA_EP_PHY_IN = {
@@ -88,70 +94,39 @@ static const USB_physical_endpoint_t USBD_CDC_DATA_EP_PHY_IN = {
     .synchronization_type = USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE,
     .usage_type = USB_ENDPOINT_USAGE_TYPE_DATA,
     .max_packet_size_bytes = USBD_CDC_DATA_PACKET_SIZE_BYTES,
-    .callback = &_USBD_CDC_DATA_endpoint_in_callback
+    .high_speed_max_packet_size_bytes = USBD_CDC_DATA_HS_PACKET_SIZE_BYTES,
+    .buffer_mode = USBD_CDC_DATA_BUFFER_MODE,
+    .callback = &_USBD_CDC_endpoint_callback
 };
 
-static const USB_endpoint_descriptor_t USBD_CDC_COMM_EP_PHY_IN_DESCRIPTOR = {
-    .bLength = sizeof(USB_endpoint_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
-    .bEndpointAddress.number = USBD_CDC_COMM_EP_PHY_IN.number,
-    .bEndpointAddress.direction = USBD_CDC_COMM_EP_PHY_IN.direction,
-    .bEndpointAddress.reserved_6_4 = 0,
-    .bmAttributes.transfer_type = USBD_CDC_COMM_EP_PHY_IN.transfer_type,
-    .bmAttributes.synchronization_type = USBD_CDC_COMM_EP_PHY_IN.synchronization_type,
-    .bmAttributes.usage_type = USBD_CDC_COMM_EP_PHY_IN.usage_type,
-    .bmAttributes.reserved_7_6 = 0,
-    .wMaxPacketSize.max_packet_size = USBD_CDC_COMM_EP_PHY_IN.max_packet_size_bytes,
-    .wMaxPacketSize.transaction_per_microframe = 0,
-    .wMaxPacketSize.reserved_15_13 = 0,
-    .bInterval = 255
-};
+static const USB_endpoint_descriptor_t USBD_CDC_COMM_EP_PHY_IN_DESCRIPTOR = USBD_CDC_COMM_EP_IN_DESCRIPTOR_INITIALIZER;
 
-static const USB_endpoint_descriptor_t USBD_CDC_DATA_EP_PHY_OUT_DESCRIPTOR = {
-    .bLength = sizeof(USB_endpoint_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
-    .bEndpointAddress.number = USBD_CDC_DATA_EP_PHY_OUT.number,
-    .bEndpointAddress.direction = USBD_CDC_DATA_EP_PHY_OUT.direction,
-    .bEndpointAddress.reserved_6_4 = 0,
-    .bmAttributes.transfer_type = USBD_CDC_DATA_EP_PHY_OUT.transfer_type,
-    .bmAttributes.synchronization_type = USBD_CDC_DATA_EP_PHY_OUT.synchronization_type,
-    .bmAttributes.usage_type = USBD_CDC_DATA_EP_PHY_OUT.usage_type,
-    .bmAttributes.reserved_7_6 = 0,
-    .wMaxPacketSize.max_packet_size = USBD_CDC_DATA_EP_PHY_OUT.max_packet_size_bytes,
-    .wMaxPacketSize.transaction_per_microframe = 0,
-    .wMaxPacketSize.reserved_15_13 = 0,
-    .bInterval = 1
-};
+static const USB_endpoint_descriptor_t USBD_CDC_DATA_EP_PHY_OUT_DESCRIPTOR = USBD_CDC_DATA_EP_OUT_DESCRIPTOR_INITIALIZER;
 
-static const USB_endpoint_descriptor_t USBD_CDC_DATA_EP_PHY_IN_DESCRIPTOR = {
-    .bLength = sizeof(USB_endpoint_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
-    .bEndpointAddress.number = USBD_CDC_DATA_EP_PHY_IN.number,
-    .bEndpointAddress.direction = USBD_CDC_DATA_EP_PHY_IN.direction,
-    .bEndpointAddress.reserved_6_4 = 0,
-    .bmAttributes.transfer_type = USBD_CDC_DATA_EP_PHY_IN.transfer_type,
-    .bmAttributes.synchronization_type = USBD_CDC_DATA_EP_PHY_IN.synchronization_type,
-    .bmAttributes.usage_type = USBD_CDC_DATA_EP_PHY_IN.usage_type,
-    .bmAttributes.reserved_7_6 = 0,
-    .wMaxPacketSize.max_packet_size = USBD_CDC_DATA_EP_PHY_IN.max_packet_size_bytes,
-    .wMaxPacketSize.transaction_per_microframe = 0,
-    .wMaxPacketSize.reserved_15_13 = 0,
-    .bInterval = 1
-};
+static const USB_endpoint_descriptor_t USBD_CDC_DATA_EP_PHY_IN_DESCRIPTOR = USBD_CDC_DATA_EP_IN_DESCRIPTOR_INITIALIZER;
+
+static const USB_endpoint_descriptor_t USBD_CDC_COMM_EP_PHY_IN_HS_DESCRIPTOR = USBD_CDC_COMM_EP_IN_HS_DESCRIPTOR_INITIALIZER;
+
+static const USB_endpoint_descriptor_t USBD_CDC_DATA_EP_PHY_OUT_HS_DESCRIPTOR = USBD_CDC_DATA_EP_OUT_HS_DESCRIPTOR_INITIALIZER;
+
+static const USB_endpoint_descriptor_t USBD_CDC_DATA_EP_PHY_IN_HS_DESCRIPTOR = USBD_CDC_DATA_EP_IN_HS_DESCRIPTOR_INITIALIZER;
 
 static const USB_endpoint_t USBD_CDC_COMM_EP_IN = {
     .physical_endpoint = &USBD_CDC_COMM_EP_PHY_IN,
-    .descriptor = &USBD_CDC_COMM_EP_PHY_IN_DESCRIPTOR
+    .descriptor = &USBD_CDC_COMM_EP_PHY_IN_DESCRIPTOR,
+    .high_speed_descriptor = &USBD_CDC_COMM_EP_PHY_IN_HS_DESCRIPTOR
 };
 
 static const USB_endpoint_t USBD_CDC_DATA_EP_OUT = {
     .physical_endpoint = &USBD_CDC_DATA_EP_PHY_OUT,
-    .descriptor = &USBD_CDC_DATA_EP_PHY_OUT_DESCRIPTOR
+    .descriptor = &USBD_CDC_DATA_EP_PHY_OUT_DESCRIPTOR,
+    .high_speed_descriptor = &USBD_CDC_DATA_EP_PHY_OUT_HS_DESCRIPTOR
 };
 
 static const USB_endpoint_t USBD_CDC_DATA_EP_IN = {
     .physical_endpoint = &USBD_CDC_DATA_EP_PHY_IN,
-    .descriptor = &USBD_CDC_DATA_EP_PHY_IN_DESCRIPTOR
+    .descriptor = &USBD_CDC_DATA_EP_PHY_IN_DESCRIPTOR,
+    .high_speed_descriptor = &USBD_CDC_DATA_EP_PHY_IN_HS_DESCRIPTOR
 };
 
 static const USB_endpoint_t* const USBD_CDC_COMM_INTERFACE_EP_LIST[USBD_CDC_COMM_ENDPOINT_INDEX_LAST] = {
@@ -163,70 +138,15 @@ static const USB_endpoint_t* const USBD_CDC_DATA_INTERFACE_EP_LIST[USBD_CDC_DATA
     &USBD_CDC_DATA_EP_IN
 };
 
-static const USB_interface_descriptor_t USB_CDC_COMM_INTERFACE_DESCRIPTOR = {
-    .bLength = sizeof(USB_interface_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
-    .bInterfaceNumber = USBD_CDC_COMM_INTERFACE_INDEX,
-    .bAlternateSetting = 0,
-    .bNumEndpoints = USBD_CDC_COMM_ENDPOINT_INDEX_LAST,
-    .bInterfaceClass = USB_CLASS_CODE_CDC_CONTROL,
-    .bInterfaceSubClass = USB_CDC_SUBCLASS_CODE_ABSTRACT,
-    .bInterfaceProtocol = USB_CDC_PROTOCOL_CODE_NONE,
-    .iInterface = USBD_CDC_COMM_INTERFACE_STRING_DESCRIPTOR_INDEX
-};
-
-static const USB_interface_descriptor_t USB_CDC_DATA_INTERFACE_DESCRIPTOR = {
-    .bLength = sizeof(USB_interface_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
-    .bInterfaceNumber = USBD_CDC_DATA_INTERFACE_INDEX,
-    .bAlternateSetting = 0,
-    .bNumEndpoints = USBD_CDC_DATA_ENDPOINT_INDEX_LAST,
-    .bInterfaceClass = USB_CLASS_CODE_CDC_DATA,
-    .bInterfaceSubClass = 0,
-    .bInterfaceProtocol = 0,
-    .iInterface = USBD_CDC_DATA_INTERFACE_STRING_DESCRIPTOR_INDEX
-};
+static const USB_interface_descriptor_t USB_CDC_COMM_INTERFACE_DESCRIPTOR = USBD_CDC_COMM_INTERFACE_DESCRIPTOR_INITIALIZER;
 
-static const USB_CDC_header_descriptor_t USB_CDC_HEADER_DESCRIPTOR = {
-    .bFunctionLength = sizeof(USB_CDC_header_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_CLASS_SPECIFIC_INTERFACE,
-    .bDescriptorSubtype = USB_CDC_DESCRIPTOR_SUBTYPE_HEADER,
-    .bcdCDC = USB_CDC_DESCRIPTOR_VERSION
-};
+static const USB_interface_descriptor_t USB_CDC_DATA_INTERFACE_DESCRIPTOR = USBD_CDC_DATA_INTERFACE_DESCRIPTOR_INITIALIZER;
 
-static const USB_CDC_call_descriptor_t USB_CDC_CALL_DESCRIPTOR = {
-    .bFunctionLength = sizeof(USB_CDC_call_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_CLASS_SPECIFIC_INTERFACE,
-    .bDescriptorSubtype = USB_CDC_DESCRIPTOR_SUBTYPE_CALL,
-    .bmCapabilities.value = 0x01,
-    .bDataInterface = USBD_CDC_DATA_INTERFACE_INDEX
-};
+static const USBD_CDC_cs_descriptor_t USB_CDC_CS_DESCRIPTOR = USBD_CDC_CS_DESCRIPTOR_INITIALIZER;
 
-static const USB_CDC_abstract_descriptor_t USB_CDC_ABSTRACT_DESCRIPTOR = {
-    .bFunctionLength = sizeof(USB_CDC_abstract_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_CLASS_SPECIFIC_INTERFACE,
-    .bDescriptorSubtype = USB_CDC_DESCRIPTOR_SUBTYPE_ABSTRACT,
-    .bmCapabilities.value = 0x06
-};
-
-static const USB_CDC_union_descriptor_t USB_CDC_UNION_DESCRIPTOR = {
-    .bFunctionLength = sizeof(USB_CDC_union_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_CLASS_SPECIFIC_INTERFACE,
-    .bDescriptorSubtype = USB_CDC_DESCRIPTOR_SUBTYPE_UNION,
-    .bControlInterface = USBD_CDC_COMM_INTERFACE_INDEX,
-    .bSubordinateInterface = USBD_CDC_DATA_INTERFACE_INDEX
-};
-
-static const uint8_t* const USB_CDC_DESCRIPTOR_LIST[] = {
-    (uint8_t*) &USB_CDC_HEADER_DESCRIPTOR,
-    (uint8_t*) &USB_CDC_CALL_DESCRIPTOR,
-    (uint8_t*) &USB_CDC_ABSTRACT_DESCRIPTOR,
-    (uint8_t*) &USB_CDC_UNION_DESCRIPTOR
-};
+static const uint8_t USB_CDC_CS_DESCRIPTOR_LENGTH = sizeof(USBD_CDC_cs_descriptor_t);
 
 static USBD_CDC_context_t usbd_cdc_ctx = {
-    .cs_descriptor = { [0 ... (USBD_CDC_CS_DESCRIPTOR_BUFFER_SIZE_BYTES - 1)] = 0x00 },
-    .cs_descriptor_length = 0,
     .line_coding.dwDTERate = 0,
     .line_coding.bCharFormat = 0,
     .line_coding.bParityType = 0,
@@ -239,9 +159,10 @@ const USB_interface_t USBD_CDC_COMM_INTERFACE = {
     .descriptor = &USB_CDC_COMM_INTERFACE_DESCRIPTOR,
     .endpoint_list = (const USB_endpoint_t**) &USBD_CDC_COMM_INTERFACE_EP_LIST,
     .number_of_endpoints = USBD_CDC_COMM_ENDPOINT_INDEX_LAST,
-    .cs_descriptor = (const uint8_t**) &(usbd_cdc_ctx.cs_descriptor),
-    .cs_descriptor_length = &(usbd_cdc_ctx.cs_descriptor_length),
-    .request_callback = &_USBD_CDC_COMM_request_callback
+    .cs_descriptor = (const uint8_t*) &USB_CDC_CS_DESCRIPTOR,
+    .cs_descriptor_length = &USB_CDC_CS_DESCRIPTOR_LENGTH,
+    .request_callback = &_USBD_CDC_COMM_request_callback,
+    .bus_event_callback = &_USBD_CDC_COMM_bus_event_callback
 };
 
 const USB_interface_t USBD_CDC_DATA_INTERFACE = {
@@ -312,37 +233,111 @@ errors:
 }
 
 /*******************************************************************/
-static void _USBD_CDC_COMM_endpoint_in_callback(void) {
-    // TODO
+static USB_status_t _USBD_CDC_COMM_bus_event_callback(USB_bus_event_t bus_event) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Serial port is kept open across suspend.
+    if (bus_event != USB_BUS_EVENT_RESET) goto errors;
+    // Pending transfers are lost.
+    usbd_cdc_ctx.data_in.data = NULL;
+    usbd_cdc_ctx.data_in.size_bytes = 0;
+    // Host terminal is closed by the reset.
+    status = usbd_cdc_ctx.callbacks->set_serial_port_state(0, 0);
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
 }
 
 /*******************************************************************/
-static void _USBD_CDC_DATA_endpoint_out_callback(void) {
+static USB_status_t _USBD_CDC_DATA_read(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
+    USB_status_t release_status = USB_SUCCESS;
     uint32_t idx = 0;
-    // Read input data.
-    status = USBD_HW_read_data((USB_physical_endpoint_t*) &USBD_CDC_DATA_EP_PHY_OUT, &(usbd_cdc_ctx.data_out));
+    uint8_t data_out_acquired = 0;
+    // Borrow the received packet (copy fallback on peripherals which cannot lend their packet memory).
+    status = USBD_acquire_data(physical_endpoint, &(usbd_cdc_ctx.data_out));
+    if (status == USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED) {
+        status = USBD_read_data(physical_endpoint, &(usbd_cdc_ctx.data_out));
+    }
+    else if (status == USB_SUCCESS) {
+        data_out_acquired = 1;
+    }
     if (status != USB_SUCCESS) goto errors;
+    // Drop corrupted or truncated packets.
+    if ((transfer_status == USB_ENDPOINT_TRANSFER_STATUS_OVERRUN) || (transfer_status == USB_ENDPOINT_TRANSFER_STATUS_ERROR)) {
+        status = USB_ERROR_ENDPOINT_TRANSFER;
+        goto errors;
+    }
+    // Check size (given by the completion event).
+    if (size_bytes > (usbd_cdc_ctx.data_out.size_bytes)) {
+        status = USB_ERROR_ENDPOINT_PACKET_SIZE;
+        goto errors;
+    }
     // Bytes loop.
-    for (idx = 0; idx < usbd_cdc_ctx.data_out.size_bytes; idx++) {
+    for (idx = 0; idx < size_bytes; idx++) {
         // Call RX completion callback.
         status = usbd_cdc_ctx.callbacks->rx_completion(usbd_cdc_ctx.data_out.data[idx]);
         if (status != USB_SUCCESS) goto errors;
     }
+errors:
+    // Give the packet memory back to the peripheral (the first error is reported).
+    if (data_out_acquired != 0) {
+        release_status = USBD_HW_release_data(physical_endpoint);
+        if (status == USB_SUCCESS) {
+            status = release_status;
+        }
+    }
+    return status;
+}
+
+/*******************************************************************/
+static void _USBD_CDC_endpoint_callback(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Unused parameter.
+    UNUSED(frame_number);
+    // Check endpoint.
+    if (physical_endpoint == &USBD_CDC_DATA_EP_PHY_OUT) {
+        // Forward received bytes.
+        status = _USBD_CDC_DATA_read(physical_endpoint, size_bytes, transfer_status);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    else if (physical_endpoint == &USBD_CDC_DATA_EP_PHY_IN) {
+        // Call TX completion callback.
+        status = usbd_cdc_ctx.callbacks->tx_completion();
+        if (status != USB_SUCCESS) goto errors;
+    }
+    else {
+        // Nothing to do on the notification endpoint, which is never written since the serial state is not reported.
+    }
 errors:
     return;
 }
 
 /*******************************************************************/
-static void _USBD_CDC_DATA_endpoint_in_callback(void) {
+static USB_status_t _USBD_CDC_DATA_write(uint8_t* data, uint32_t data_size_bytes, uint8_t zero_copy) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
-    // Call TX completion callback.
-    status = usbd_cdc_ctx.callbacks->tx_completion();
+    USB_speed_t speed = USB_SPEED_FULL;
+    // Check size.
+    status = USBD_CONTROL_get_speed(&speed);
+    if (status != USB_SUCCESS) goto errors;
+    if (data_size_bytes > USB_ENDPOINT_GET_MAX_PACKET_SIZE(&USBD_CDC_DATA_EP_PHY_IN, speed)) {
+        status = USB_ERROR_CDC_DATA_SIZE;
+        goto errors;
+    }
+    // Build IN data structure.
+    usbd_cdc_ctx.data_in.data = data;
+    usbd_cdc_ctx.data_in.size_bytes = data_size_bytes;
+    // Hand the buffer to the peripheral (copy fallback on peripherals which cannot transmit from it).
+    status = (zero_copy != 0) ? USBD_submit_data((USB_physical_endpoint_t*) &USBD_CDC_DATA_EP_PHY_IN, &(usbd_cdc_ctx.data_in)) : USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    if (status == USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED) {
+        status = USBD_write_data((USB_physical_endpoint_t*) &USBD_CDC_DATA_EP_PHY_IN, &(usbd_cdc_ctx.data_in));
+    }
     if (status != USB_SUCCESS) goto errors;
 errors:
-    return;
+    return status;
 }
 
 /*** USBD CDC functions ***/
@@ -351,9 +346,6 @@ errors:
 USB_status_t USBD_CDC_init(USBD_CDC_callbacks_t* cdc_callbacks) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
-    const uint8_t* descriptor_ptr = NULL;
-    uint32_t descriptor_idx = 0;
-    uint32_t full_idx = 0;
     uint32_t idx = 0;
     // Check parameter.
     if (cdc_callbacks == NULL) {
@@ -362,22 +354,6 @@ USB_status_t USBD_CDC_init(USBD_CDC_callbacks_t* cdc_callbacks) {
     }
     // Register callbacks.
     usbd_cdc_ctx.callbacks = cdc_callbacks;
-    // Build class specific descriptor.
-    for (descriptor_idx = 0; descriptor_idx < (sizeof(USB_CDC_DESCRIPTOR_LIST) / (sizeof(uint8_t*))); descriptor_idx++) {
-        // Update pointer.
-        descriptor_ptr = USB_CDC_DESCRIPTOR_LIST[descriptor_idx];
-        // Bytes loop.
-        for (idx = 0; idx < descriptor_ptr[USBD_CDC_CS_DESCRIPTOR_LENGTH_INDEX] ; idx++) {
-            // Copy descriptor.
-            usbd_cdc_ctx.cs_descriptor[full_idx++] = descriptor_ptr[idx];
-            // Check length.
-            if (full_idx >= USBD_CDC_CS_DESCRIPTOR_BUFFER_SIZE_BYTES) {
-                status = USB_ERROR_CS_DESCRIPTOR_SIZE;
-                goto errors;
-            }
-        }
-    }
-    usbd_cdc_ctx.cs_descriptor_length = full_idx;
     // Endpoints loop.
     for (idx = 0; idx < (USBD_CDC_COMM_INTERFACE.number_of_endpoints); idx++) {
         // Register endpoint.
@@ -417,21 +393,12 @@ errors:
 
 /*******************************************************************/
 USB_status_t USBD_CDC_write(uint8_t* data, uint32_t data_size_bytes) {
-    // Local variables.
-    USB_status_t status = USB_SUCCESS;
-    // Check size.
-    if (data_size_bytes > USBD_CDC_DATA_EP_PHY_IN.max_packet_size_bytes) {
-        status = USB_ERROR_CDC_DATA_SIZE;
-        goto errors;
-    }
-    // Build IN data structure.
-    usbd_cdc_ctx.data_in.data = data;
-    usbd_cdc_ctx.data_in.size_bytes = data_size_bytes;
-    // Write data.
-    status = USBD_HW_write_data((USB_physical_endpoint_t*) &USBD_CDC_DATA_EP_PHY_IN, &(usbd_cdc_ctx.data_in));
-    if (status != USB_SUCCESS) goto errors;
-errors:
-    return status;
+    return _USBD_CDC_DATA_write(data, data_size_bytes, 0);
+}
+
+/*******************************************************************/
+USB_status_t USBD_CDC_submit(uint8_t* data, uint32_t data_size_bytes) {
+    return _USBD_CDC_DATA_write(data, data_size_bytes, 1);
 }
 
 #endif /* USB_LIB_DISABLE */
@@ -16,6 +16,7 @@
 #include "common/usb_request.h"
 #include "common/usb_types.h"
 #include "common/usb_uac.h"
+#include "device/standard/usbd_control.h"
 #include "device/usbd_hw.h"
 #include "types.h"
 
@@ -23,27 +24,30 @@
 
 /*** USBD UAC local macros ***/
 
-#define USBD_UAC_CS_DESCRIPTOR_BUFFER_SIZE_BYTES    1024
-#define USBD_UAC_CS_DESCRIPTOR_LENGTH_INDEX         0
+#ifdef USBD_UAC_STREAM_DOUBLE_BUFFER
+#define USBD_UAC_STREAM_BUFFER_MODE     USB_ENDPOINT_BUFFER_MODE_DOUBLE
+#else
+#define USBD_UAC_STREAM_BUFFER_MODE     USB_ENDPOINT_BUFFER_MODE_SINGLE
+#endif
 
 /*** USBD UAC local structures ***/
 
 /*******************************************************************/
 typedef enum {
     USBD_UAC_CONTROL_ENDPOINT_INDEX_IN = 0,
-    USBD_UAC_CONTROL_ENDPOINT_INDEX_LAST
+    USBD_UAC_CONTROL_ENDPOINT_INDEX_LAST = USBD_UAC_CONTROL_NUMBER_OF_ENDPOINTS
 } USBD_UAC_control_endpoint_index_t;
 
 /*******************************************************************/
 typedef enum {
     USBD_UAC_STREAM_PLAY_ENDPOINT_INDEX_OUT = 0,
-    USBD_UAC_STREAM_PLAY_ENDPOINT_INDEX_LAST
+    USBD_UAC_STREAM_PLAY_ENDPOINT_INDEX_LAST = USBD_UAC_STREAM_PLAY_NUMBER_OF_ENDPOINTS
 } USBD_UAC_stream_play_endpoint_index_t;
 
 /*******************************************************************/
 typedef enum {
     USBD_UAC_STREAM_RECORD_ENDPOINT_INDEX_IN = 0,
-    USBD_UAC_STREAM_RECORD_ENDPOINT_INDEX_LAST
+    USBD_UAC_STREAM_RECORD_ENDPOINT_INDEX_LAST = USBD_UAC_STREAM_RECORD_NUMBER_OF_ENDPOINTS
 } USBD_UAC_stream_record_endpoint_index_t;
 
 /*******************************************************************/
@@ -51,25 +55,33 @@ typedef enum {
     USBD_UAC_INTERFACE_INDEX_CONTROL = 0,
     USBD_UAC_INTERFACE_INDEX_STREAM_PLAY,
     USBD_UAC_INTERFACE_INDEX_STREAM_RECORD,
-    USBD_UAC_INTERFACE_INDEX_LAST
+    USBD_UAC_INTERFACE_INDEX_LAST = USBD_UAC_NUMBER_OF_INTERFACES
 } USBD_UAC_interface_index_t;
 
+/*******************************************************************/
+typedef enum {
+    USBD_UAC_STREAM_ALTERNATE_SETTING_INDEX_OPERATIONAL = 0,
+    USBD_UAC_STREAM_ALTERNATE_SETTING_INDEX_LAST = USBD_UAC_STREAM_NUMBER_OF_ALTERNATE_SETTINGS
+} USBD_UAC_stream_alternate_setting_index_t;
+
 /*******************************************************************/
 typedef struct {
     USBD_UAC_callbacks_t* callbacks;
-    uint8_t cs_descriptor[USBD_UAC_CS_DESCRIPTOR_BUFFER_SIZE_BYTES];
-    uint8_t cs_descriptor_length;
+    uint8_t stream_play_alternate_setting;
+    uint8_t stream_record_alternate_setting;
     USB_data_t data_out;
     USB_data_t data_in;
 } USBD_UAC_context_t;
 
 /*** USBD UAC local functions declaration ***/
 
-static void _USBD_UAC_CONTROL_endpoint_in_callback(void);
-static void _USBD_UAC_STREAM_PLAY_endpoint_out_callback(void);
-static void _USBD_UAC_STREAM_RECORD_endpoint_in_callback(void);
+static void _USBD_UAC_endpoint_callback(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number);
 
 static USB_status_t _USBD_UAC_CONTROL_request_callback(USB_request_t* request, USB_data_t* data_out, USB_data_t* data_in);
+static USB_status_t _USBD_UAC_STREAM_PLAY_set_alternate_setting_callback(uint8_t alternate_setting);
+static USB_status_t _USBD_UAC_STREAM_RECORD_set_alternate_setting_callback(uint8_t alternate_setting);
+static USB_status_t _USBD_UAC_STREAM_PLAY_bus_event_callback(USB_bus_event_t bus_event);
+static USB_status_t _USBD_UAC_STREAM_RECORD_bus_event_callback(USB_bus_event_t bus_event);
 
 /*** USBD UAC local global variables ***/
 
@@ -80,7 +92,9 @@ static const USB_physical_endpoint_t USBD_UAC_CONTROL_EP_PHY_IN = {
     .synchronization_type = USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE,
     .usage_type = USB_ENDPOINT_USAGE_TYPE_DATA,
     .max_packet_size_bytes = USBD_UAC_CONTROL_PACKET_SIZE_BYTES,
-    .callback = &_USBD_UAC_CONTROL_endpoint_in_callback
+    .high_speed_max_packet_size_bytes = USBD_UAC_CONTROL_HS_PACKET_SIZE_BYTES,
+    .buffer_mode = USB_ENDPOINT_BUFFER_MODE_SINGLE,
+    .callback = &_USBD_UAC_endpoint_callback
 };
 
 static const USB_physical_endpoint_t USBD_UAC_STREAM_PLAY_EP_PHY_OUT = {
@@ -90,7 +104,9 @@ static const USB_physical_endpoint_t USBD_UAC_STREAM_PLAY_EP_PHY_OUT = {
     .synchronization_type = USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE,
     .usage_type = USB_ENDPOINT_USAGE_TYPE_DATA,
     .max_packet_size_bytes = USBD_UAC_STREAM_PLAY_PACKET_SIZE_BYTES,
-    .callback = &_USBD_UAC_STREAM_PLAY_endpoint_out_callback
+    .high_speed_max_packet_size_bytes = USBD_UAC_STREAM_PLAY_HS_PACKET_SIZE_BYTES,
+    .buffer_mode = USBD_UAC_STREAM_BUFFER_MODE,
+    .callback = &_USBD_UAC_endpoint_callback
 };
 
 static const USB_physical_endpoint_t USBD_UAC_STREAM_RECORD_EP_PHY_IN = {
@@ -100,70 +116,39 @@ static const USB_physical_endpoint_t USBD_UAC_STREAM_RECORD_EP_PHY_IN = {
     .synchronization_type = USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE,
     .usage_type = USB_ENDPOINT_USAGE_TYPE_DATA,
     .max_packet_size_bytes = USBD_UAC_STREAM_RECORD_PACKET_SIZE_BYTES,
-    .callback = &_USBD_UAC_STREAM_RECORD_endpoint_in_callback
+    .high_speed_max_packet_size_bytes = USBD_UAC_STREAM_RECORD_HS_PACKET_SIZE_BYTES,
+    .buffer_mode = USBD_UAC_STREAM_BUFFER_MODE,
+    .callback = &_USBD_UAC_endpoint_callback
 };
 
-static const USB_endpoint_descriptor_t USBD_UAC_CONTROL_EP_PHY_IN_DESCRIPTOR = {
-    .bLength = sizeof(USB_endpoint_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
-    .bEndpointAddress.number = USBD_UAC_CONTROL_EP_PHY_IN.number,
-    .bEndpointAddress.direction = USBD_UAC_CONTROL_EP_PHY_IN.direction,
-    .bEndpointAddress.reserved_6_4 = 0,
-    .bmAttributes.transfer_type = USBD_UAC_CONTROL_EP_PHY_IN.transfer_type,
-    .bmAttributes.synchronization_type = USBD_UAC_CONTROL_EP_PHY_IN.synchronization_type,
-    .bmAttributes.usage_type = USBD_UAC_CONTROL_EP_PHY_IN.usage_type,
-    .bmAttributes.reserved_7_6 = 0,
-    .wMaxPacketSize.max_packet_size = USBD_UAC_CONTROL_EP_PHY_IN.max_packet_size_bytes,
-    .wMaxPacketSize.transaction_per_microframe = 0,
-    .wMaxPacketSize.reserved_15_13 = 0,
-    .bInterval = 255
-};
+static const USB_endpoint_descriptor_t USBD_UAC_CONTROL_EP_PHY_IN_DESCRIPTOR = USBD_UAC_CONTROL_EP_IN_DESCRIPTOR_INITIALIZER;
 
-static const USB_endpoint_descriptor_t USBD_UAC_STREAM_EP_PHY_OUT_DESCRIPTOR = {
-    .bLength = sizeof(USB_endpoint_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
-    .bEndpointAddress.number = USBD_UAC_STREAM_PLAY_EP_PHY_OUT.number,
-    .bEndpointAddress.direction = USBD_UAC_STREAM_PLAY_EP_PHY_OUT.direction,
-    .bEndpointAddress.reserved_6_4 = 0,
-    .bmAttributes.transfer_type = USBD_UAC_STREAM_PLAY_EP_PHY_OUT.transfer_type,
-    .bmAttributes.synchronization_type = USBD_UAC_STREAM_PLAY_EP_PHY_OUT.synchronization_type,
-    .bmAttributes.usage_type = USBD_UAC_STREAM_PLAY_EP_PHY_OUT.usage_type,
-    .bmAttributes.reserved_7_6 = 0,
-    .wMaxPacketSize.max_packet_size = USBD_UAC_STREAM_PLAY_EP_PHY_OUT.max_packet_size_bytes,
-    .wMaxPacketSize.transaction_per_microframe = 0,
-    .wMaxPacketSize.reserved_15_13 = 0,
-    .bInterval = 1
-};
+static const USB_endpoint_descriptor_t USBD_UAC_STREAM_EP_PHY_OUT_DESCRIPTOR = USBD_UAC_STREAM_PLAY_EP_OUT_DESCRIPTOR_INITIALIZER;
 
-static const USB_endpoint_descriptor_t USBD_UAC_STREAM_EP_PHY_IN_DESCRIPTOR = {
-    .bLength = sizeof(USB_endpoint_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_ENDPOINT,
-    .bEndpointAddress.number = USBD_UAC_STREAM_RECORD_EP_PHY_IN.number,
-    .bEndpointAddress.direction = USBD_UAC_STREAM_RECORD_EP_PHY_IN.direction,
-    .bEndpointAddress.reserved_6_4 = 0,
-    .bmAttributes.transfer_type = USBD_UAC_STREAM_RECORD_EP_PHY_IN.transfer_type,
-    .bmAttributes.synchronization_type = USBD_UAC_STREAM_RECORD_EP_PHY_IN.synchronization_type,
-    .bmAttributes.usage_type = USBD_UAC_STREAM_RECORD_EP_PHY_IN.usage_type,
-    .bmAttributes.reserved_7_6 = 0,
-    .wMaxPacketSize.max_packet_size = USBD_UAC_STREAM_RECORD_EP_PHY_IN.max_packet_size_bytes,
-    .wMaxPacketSize.transaction_per_microframe = 0,
-    .wMaxPacketSize.reserved_15_13 = 0,
-    .bInterval = 1
-};
+static const USB_endpoint_descriptor_t USBD_UAC_STREAM_EP_PHY_IN_DESCRIPTOR = USBD_UAC_STREAM_RECORD_EP_IN_DESCRIPTOR_INITIALIZER;
+
+static const USB_endpoint_descriptor_t USBD_UAC_CONTROL_EP_PHY_IN_HS_DESCRIPTOR = USBD_UAC_CONTROL_EP_IN_HS_DESCRIPTOR_INITIALIZER;
+
+static const USB_endpoint_descriptor_t USBD_UAC_STREAM_EP_PHY_OUT_HS_DESCRIPTOR = USBD_UAC_STREAM_PLAY_EP_OUT_HS_DESCRIPTOR_INITIALIZER;
+
+static const USB_endpoint_descriptor_t USBD_UAC_STREAM_EP_PHY_IN_HS_DESCRIPTOR = USBD_UAC_STREAM_RECORD_EP_IN_HS_DESCRIPTOR_INITIALIZER;
 
 static const USB_endpoint_t USBD_UAC_CONTROL_EP_IN = {
     .physical_endpoint = &USBD_UAC_CONTROL_EP_PHY_IN,
-    .descriptor = &USBD_UAC_CONTROL_EP_PHY_IN_DESCRIPTOR
+    .descriptor = &USBD_UAC_CONTROL_EP_PHY_IN_DESCRIPTOR,
+    .high_speed_descriptor = &USBD_UAC_CONTROL_EP_PHY_IN_HS_DESCRIPTOR
 };
 
 static const USB_endpoint_t USBD_UAC_STREAM_PLAY_EP_OUT = {
     .physical_endpoint = &USBD_UAC_STREAM_PLAY_EP_PHY_OUT,
-    .descriptor = &USBD_UAC_STREAM_EP_PHY_OUT_DESCRIPTOR
+    .descriptor = &USBD_UAC_STREAM_EP_PHY_OUT_DESCRIPTOR,
+    .high_speed_descriptor = &USBD_UAC_STREAM_EP_PHY_OUT_HS_DESCRIPTOR
 };
 
 static const USB_endpoint_t USBD_UAC_STREAM_RECORD_EP_IN = {
     .physical_endpoint = &USBD_UAC_STREAM_RECORD_EP_PHY_IN,
-    .descriptor = &USBD_UAC_STREAM_EP_PHY_IN_DESCRIPTOR
+    .descriptor = &USBD_UAC_STREAM_EP_PHY_IN_DESCRIPTOR,
+    .high_speed_descriptor = &USBD_UAC_STREAM_EP_PHY_IN_HS_DESCRIPTOR
 };
 
 static const USB_endpoint_t* const USBD_UAC_CONTROL_INTERFACE_EP_LIST[USBD_UAC_CONTROL_ENDPOINT_INDEX_LAST] = {
@@ -178,58 +163,32 @@ static const USB_endpoint_t* const USBD_UAC_STREAM_RECORD_INTERFACE_EP_LIST[USBD
     &USBD_UAC_STREAM_RECORD_EP_IN,
 };
 
-static const USB_interface_descriptor_t USB_UAC_CONTROL_INTERFACE_DESCRIPTOR = {
-    .bLength = sizeof(USB_interface_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
-    .bInterfaceNumber = USBD_UAC_CONTROL_INTERFACE_INDEX,
-    .bAlternateSetting = 0,
-    .bNumEndpoints = USBD_UAC_CONTROL_ENDPOINT_INDEX_LAST,
-    .bInterfaceClass = USB_CLASS_CODE_AUDIO,
-    .bInterfaceSubClass = USB_UAC_SUBCLASS_CODE_AUDIO_CONTROL,
-    .bInterfaceProtocol = USB_UAC_PROTOCOL_CODE_IP_VERSION_02_00,
-    .iInterface = USBD_UAC_CONTROL_INTERFACE_STRING_DESCRIPTOR_INDEX
-};
+static const USB_interface_descriptor_t USB_UAC_CONTROL_INTERFACE_DESCRIPTOR = USBD_UAC_CONTROL_INTERFACE_DESCRIPTOR_INITIALIZER;
 
-static const USB_interface_descriptor_t USB_UAC_STREAM_PLAY_INTERFACE_DESCRIPTOR = {
-    .bLength = sizeof(USB_interface_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
-    .bInterfaceNumber = USBD_UAC_STREAM_PLAY_INTERFACE_INDEX,
-    .bAlternateSetting = 0,
-    .bNumEndpoints = USBD_UAC_STREAM_PLAY_ENDPOINT_INDEX_LAST,
-    .bInterfaceClass = USB_CLASS_CODE_AUDIO,
-    .bInterfaceSubClass = USB_UAC_SUBCLASS_CODE_AUDIO_STREAMING,
-    .bInterfaceProtocol = USB_UAC_PROTOCOL_CODE_IP_VERSION_02_00,
-    .iInterface = USBD_UAC_STREAM_PLAY_INTERFACE_STRING_DESCRIPTOR_INDEX
-};
+static const USB_interface_descriptor_t USB_UAC_STREAM_PLAY_INTERFACE_DESCRIPTOR = USBD_UAC_STREAM_PLAY_INTERFACE_DESCRIPTOR_INITIALIZER;
 
-static const USB_interface_descriptor_t USB_UAC_STREAM_RECORD_INTERFACE_DESCRIPTOR = {
-    .bLength = sizeof(USB_interface_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE,
-    .bInterfaceNumber = USBD_UAC_STREAM_RECORD_INTERFACE_INDEX,
-    .bAlternateSetting = 0,
-    .bNumEndpoints = USBD_UAC_STREAM_RECORD_ENDPOINT_INDEX_LAST,
-    .bInterfaceClass = USB_CLASS_CODE_AUDIO,
-    .bInterfaceSubClass = USB_UAC_SUBCLASS_CODE_AUDIO_STREAMING,
-    .bInterfaceProtocol = USB_UAC_PROTOCOL_CODE_IP_VERSION_02_00,
-    .iInterface = USBD_UAC_STREAM_RECORD_INTERFACE_STRING_DESCRIPTOR_INDEX
-};
+static const USB_interface_descriptor_t USB_UAC_STREAM_RECORD_INTERFACE_DESCRIPTOR = USBD_UAC_STREAM_RECORD_INTERFACE_DESCRIPTOR_INITIALIZER;
+
+static const USB_interface_descriptor_t USB_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE_DESCRIPTOR = USBD_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE_DESCRIPTOR_INITIALIZER;
+
+static const USB_interface_descriptor_t USB_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE_DESCRIPTOR = USBD_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE_DESCRIPTOR_INITIALIZER;
 
 static USBD_UAC_context_t usbd_uac_ctx = {
-    .cs_descriptor = { [0 ... (USBD_UAC_CS_DESCRIPTOR_BUFFER_SIZE_BYTES - 1)] = 0x00 },
-    .cs_descriptor_length = 0,
+    .stream_play_alternate_setting = USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH,
+    .stream_record_alternate_setting = USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH,
 };
 
 static const USB_interface_t USBD_UAC_CONTROL_INTERFACE = {
     .descriptor = &USB_UAC_CONTROL_INTERFACE_DESCRIPTOR,
     .endpoint_list = (const USB_endpoint_t**) &USBD_UAC_CONTROL_INTERFACE_EP_LIST,
     .number_of_endpoints = USBD_UAC_CONTROL_ENDPOINT_INDEX_LAST,
-    .cs_descriptor = (const uint8_t**) &(usbd_uac_ctx.cs_descriptor),
-    .cs_descriptor_length = &(usbd_uac_ctx.cs_descriptor_length),
+    .cs_descriptor = NULL,
+    .cs_descriptor_length = NULL,
     .request_callback = &_USBD_UAC_CONTROL_request_callback
 };
 
-static const USB_interface_t USBD_UAC_STREAM_PLAY_INTERFACE = {
-    .descriptor = &USB_UAC_STREAM_PLAY_INTERFACE_DESCRIPTOR,
+static const USB_interface_t USBD_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE = {
+    .descriptor = &USB_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE_DESCRIPTOR,
     .endpoint_list = (const USB_endpoint_t**) &USBD_UAC_STREAM_PLAY_INTERFACE_EP_LIST,
     .number_of_endpoints = USBD_UAC_STREAM_PLAY_ENDPOINT_INDEX_LAST,
     .cs_descriptor = NULL,
@@ -237,8 +196,8 @@ static const USB_interface_t USBD_UAC_STREAM_PLAY_INTERFACE = {
     .request_callback = NULL
 };
 
-static const USB_interface_t USBD_UAC_STREAM_RECORD_INTERFACE = {
-    .descriptor = &USB_UAC_STREAM_RECORD_INTERFACE_DESCRIPTOR,
+static const USB_interface_t USBD_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE = {
+    .descriptor = &USB_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE_DESCRIPTOR,
     .endpoint_list = (const USB_endpoint_t**) &USBD_UAC_STREAM_RECORD_INTERFACE_EP_LIST,
     .number_of_endpoints = USBD_UAC_STREAM_RECORD_ENDPOINT_INDEX_LAST,
     .cs_descriptor = NULL,
@@ -246,22 +205,48 @@ static const USB_interface_t USBD_UAC_STREAM_RECORD_INTERFACE = {
     .request_callback = NULL
 };
 
+static const USB_interface_t* const USBD_UAC_STREAM_PLAY_ALTERNATE_SETTING_LIST[USBD_UAC_STREAM_ALTERNATE_SETTING_INDEX_LAST] = {
+    &USBD_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE
+};
+
+static const USB_interface_t* const USBD_UAC_STREAM_RECORD_ALTERNATE_SETTING_LIST[USBD_UAC_STREAM_ALTERNATE_SETTING_INDEX_LAST] = {
+    &USBD_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE
+};
+
+// Default alternate setting has no endpoint so that no isochronous bandwidth is reserved.
+static const USB_interface_t USBD_UAC_STREAM_PLAY_INTERFACE = {
+    .descriptor = &USB_UAC_STREAM_PLAY_INTERFACE_DESCRIPTOR,
+    .endpoint_list = NULL,
+    .number_of_endpoints = 0,
+    .cs_descriptor = NULL,
+    .cs_descriptor_length = NULL,
+    .request_callback = NULL,
+    .alternate_setting_list = (const USB_interface_t**) &USBD_UAC_STREAM_PLAY_ALTERNATE_SETTING_LIST,
+    .number_of_alternate_settings = USBD_UAC_STREAM_ALTERNATE_SETTING_INDEX_LAST,
+    .set_alternate_setting_callback = &_USBD_UAC_STREAM_PLAY_set_alternate_setting_callback,
+    .bus_event_callback = &_USBD_UAC_STREAM_PLAY_bus_event_callback
+};
+
+static const USB_interface_t USBD_UAC_STREAM_RECORD_INTERFACE = {
+    .descriptor = &USB_UAC_STREAM_RECORD_INTERFACE_DESCRIPTOR,
+    .endpoint_list = NULL,
+    .number_of_endpoints = 0,
+    .cs_descriptor = NULL,
+    .cs_descriptor_length = NULL,
+    .request_callback = NULL,
+    .alternate_setting_list = (const USB_interface_t**) &USBD_UAC_STREAM_RECORD_ALTERNATE_SETTING_LIST,
+    .number_of_alternate_settings = USBD_UAC_STREAM_ALTERNATE_SETTING_INDEX_LAST,
+    .set_alternate_setting_callback = &_USBD_UAC_STREAM_RECORD_set_alternate_setting_callback,
+    .bus_event_callback = &_USBD_UAC_STREAM_RECORD_bus_event_callback
+};
+
 static const USB_interface_t* USBD_UAC_INTERFACE_LIST[USBD_UAC_INTERFACE_INDEX_LAST] = {
     &USBD_UAC_CONTROL_INTERFACE,
     &USBD_UAC_STREAM_PLAY_INTERFACE,
     &USBD_UAC_STREAM_RECORD_INTERFACE
 };
 
-static USB_interface_association_descriptor_t USBD_UAC_INTERFACE_ASSOCIATION_DESCRIPTOR = {
-    .bLength = sizeof(USB_interface_association_descriptor_t),
-    .bDescriptorType = USB_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION,
-    .bFirstInterface = USBD_UAC_CONTROL_INTERFACE_INDEX,
-    .bInterfaceCount = USBD_UAC_INTERFACE_INDEX_LAST,
-    .bFunctionClass = USB_CLASS_CODE_AUDIO,
-    .bFunctionSubClass = 0,
-    .bFunctionProtocol = 0,
-    .iFunction = USBD_UAC_INTERFACE_ASSOCIATION_STRING_DESCRIPTOR_INDEX
-};
+static const USB_interface_association_descriptor_t USBD_UAC_INTERFACE_ASSOCIATION_DESCRIPTOR = USBD_UAC_INTERFACE_ASSOCIATION_DESCRIPTOR_INITIALIZER;
 
 /*** USB UAC global variables ***/
 
@@ -285,17 +270,92 @@ static USB_status_t _USBD_UAC_CONTROL_request_callback(USB_request_t* request, U
 }
 
 /*******************************************************************/
-static void _USBD_UAC_CONTROL_endpoint_in_callback(void) {
-    // TODO
+static USB_status_t _USBD_UAC_register_stream_endpoints(const USB_interface_t* operational_interface, uint8_t register_enable) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint8_t idx = 0;
+    // Endpoints loop.
+    for (idx = 0; idx < (operational_interface->number_of_endpoints); idx++) {
+        if (register_enable != 0) {
+            status = USBD_HW_register_endpoint((USB_physical_endpoint_t*) ((operational_interface->endpoint_list)[idx]->physical_endpoint));
+        }
+        else {
+            status = USBD_HW_unregister_endpoint((USB_physical_endpoint_t*) ((operational_interface->endpoint_list)[idx]->physical_endpoint));
+        }
+        if (status != USB_SUCCESS) goto errors;
+    }
+errors:
+    return status;
 }
 
 /*******************************************************************/
-static void _USBD_UAC_STREAM_PLAY_endpoint_out_callback(void) {
-    // TODO
+static USB_status_t _USBD_UAC_set_stream_alternate_setting(const USB_interface_t* operational_interface, uint8_t* current_alternate_setting, uint8_t alternate_setting) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check if alternate setting changes.
+    if (alternate_setting == (*current_alternate_setting)) goto errors;
+    // Isochronous endpoints only exist in the operational alternate setting.
+    status = _USBD_UAC_register_stream_endpoints(operational_interface, (alternate_setting == USBD_UAC_STREAM_ALTERNATE_SETTING_OPERATIONAL) ? 1 : 0);
+    if (status != USB_SUCCESS) goto errors;
+    (*current_alternate_setting) = alternate_setting;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_UAC_stream_bus_event(const USB_interface_t* operational_interface, uint8_t* current_alternate_setting, USB_bus_event_t bus_event) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check event.
+    switch (bus_event) {
+    case USB_BUS_EVENT_RESET:
+        // Host selects the alternate setting again after enumeration.
+        status = _USBD_UAC_set_stream_alternate_setting(operational_interface, current_alternate_setting, USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH);
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    case USB_BUS_EVENT_SUSPEND:
+    case USB_BUS_EVENT_RESUME:
+        // Release or restore the isochronous pipeline but keep the alternate setting selected by the host.
+        if ((*current_alternate_setting) == USBD_UAC_STREAM_ALTERNATE_SETTING_OPERATIONAL) {
+            status = _USBD_UAC_register_stream_endpoints(operational_interface, (bus_event == USB_BUS_EVENT_RESUME) ? 1 : 0);
+            if (status != USB_SUCCESS) goto errors;
+        }
+        break;
+    default:
+        status = USB_ERROR_BUS_EVENT;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_UAC_STREAM_PLAY_set_alternate_setting_callback(uint8_t alternate_setting) {
+    return _USBD_UAC_set_stream_alternate_setting(&USBD_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE, &(usbd_uac_ctx.stream_play_alternate_setting), alternate_setting);
 }
 
 /*******************************************************************/
-static void _USBD_UAC_STREAM_RECORD_endpoint_in_callback(void) {
+static USB_status_t _USBD_UAC_STREAM_RECORD_set_alternate_setting_callback(uint8_t alternate_setting) {
+    return _USBD_UAC_set_stream_alternate_setting(&USBD_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE, &(usbd_uac_ctx.stream_record_alternate_setting), alternate_setting);
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_UAC_STREAM_PLAY_bus_event_callback(USB_bus_event_t bus_event) {
+    return _USBD_UAC_stream_bus_event(&USBD_UAC_STREAM_PLAY_OPERATIONAL_INTERFACE, &(usbd_uac_ctx.stream_play_alternate_setting), bus_event);
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_UAC_STREAM_RECORD_bus_event_callback(USB_bus_event_t bus_event) {
+    return _USBD_UAC_stream_bus_event(&USBD_UAC_STREAM_RECORD_OPERATIONAL_INTERFACE, &(usbd_uac_ctx.stream_record_alternate_setting), bus_event);
+}
+
+/*******************************************************************/
+static void _USBD_UAC_endpoint_callback(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number) {
+    // Unused parameters.
+    UNUSED(physical_endpoint);
+    UNUSED(size_bytes);
+    UNUSED(transfer_status);
+    UNUSED(frame_number);
     // TODO
 }
 
@@ -319,16 +379,9 @@ USB_status_t USBD_UAC_init(USBD_UAC_callbacks_t* uac_callbacks) {
         status = USBD_HW_register_endpoint((USB_physical_endpoint_t*) ((USBD_UAC_CONTROL_INTERFACE.endpoint_list)[idx]->physical_endpoint));
         if (status != USB_SUCCESS) goto errors;
     }
-    for (idx = 0; idx < (USBD_UAC_STREAM_PLAY_INTERFACE.number_of_endpoints); idx++) {
-        // Register endpoint.
-        status = USBD_HW_register_endpoint((USB_physical_endpoint_t*) ((USBD_UAC_STREAM_PLAY_INTERFACE.endpoint_list)[idx]->physical_endpoint));
-        if (status != USB_SUCCESS) goto errors;
-    }
-    for (idx = 0; idx < (USBD_UAC_STREAM_RECORD_INTERFACE.number_of_endpoints); idx++) {
-        // Register endpoint.
-        status = USBD_HW_register_endpoint((USB_physical_endpoint_t*) ((USBD_UAC_STREAM_RECORD_INTERFACE.endpoint_list)[idx]->physical_endpoint));
-        if (status != USB_SUCCESS) goto errors;
-    }
+    // Streaming endpoints are registered when the host selects the operational alternate setting.
+    usbd_uac_ctx.stream_play_alternate_setting = USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH;
+    usbd_uac_ctx.stream_record_alternate_setting = USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH;
 errors:
     return status;
 }
@@ -346,16 +399,11 @@ USB_status_t USBD_UAC_de_init(void) {
         status = USBD_HW_unregister_endpoint((USB_physical_endpoint_t*) ((USBD_UAC_CONTROL_INTERFACE.endpoint_list)[idx]->physical_endpoint));
         if (status != USB_SUCCESS) goto errors;
     }
-    for (idx = 0; idx < (USBD_UAC_STREAM_PLAY_INTERFACE.number_of_endpoints); idx++) {
-        // Register endpoint.
-        status = USBD_HW_unregister_endpoint((USB_physical_endpoint_t*) ((USBD_UAC_STREAM_PLAY_INTERFACE.endpoint_list)[idx]->physical_endpoint));
-        if (status != USB_SUCCESS) goto errors;
-    }
-    for (idx = 0; idx < (USBD_UAC_STREAM_RECORD_INTERFACE.number_of_endpoints); idx++) {
-        // Register endpoint.
-        status = USBD_HW_unregister_endpoint((USB_physical_endpoint_t*) ((USBD_UAC_STREAM_RECORD_INTERFACE.endpoint_list)[idx]->physical_endpoint));
-        if (status != USB_SUCCESS) goto errors;
-    }
+    // Release streaming endpoints if they are still active.
+    status = _USBD_UAC_STREAM_PLAY_set_alternate_setting_callback(USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH);
+    if (status != USB_SUCCESS) goto errors;
+    status = _USBD_UAC_STREAM_RECORD_set_alternate_setting_callback(USBD_UAC_STREAM_ALTERNATE_SETTING_ZERO_BANDWIDTH);
+    if (status != USB_SUCCESS) goto errors;
 errors:
     return status;
 }
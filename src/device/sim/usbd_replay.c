@@ -0,0 +1,418 @@
+/*
+ * usbd_replay.c
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#include "device/sim/usbd_replay.h"
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_endpoint.h"
+#include "common/usb_request.h"
+#include "common/usb_types.h"
+#include "device/sim/usbd_sim.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_SIM) && (defined USBD_REPLAY))
+
+#include <stdio.h>
+
+/*** USBD REPLAY local macros ***/
+
+#define USBD_REPLAY_PACKET_SIZE_MAX             1024
+
+#define USBD_REPLAY_PCAP_MAGIC_NUMBER_US        0xA1B2C3D4
+#define USBD_REPLAY_PCAP_MAGIC_NUMBER_NS        0xA1B23C4D
+#define USBD_REPLAY_PCAP_LINKTYPE_USBMON        220
+
+#define USBD_REPLAY_USBMON_TYPE_SUBMISSION      'S'
+#define USBD_REPLAY_USBMON_TYPE_CALLBACK        'C'
+#define USBD_REPLAY_USBMON_XFER_TYPE_ISO        0
+#define USBD_REPLAY_USBMON_FLAG_PRESENT         0
+#define USBD_REPLAY_USBMON_DIRECTION_IN         0x80
+#define USBD_REPLAY_USBMON_ENDPOINT_NUMBER_MASK 0x7F
+
+/*** USBD REPLAY local structures ***/
+
+/*******************************************************************/
+typedef struct {
+    uint32_t magic_number;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t network;
+} __attribute__((packed)) USBD_REPLAY_pcap_header_t;
+
+/*******************************************************************/
+typedef struct {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+} __attribute__((packed)) USBD_REPLAY_pcap_record_header_t;
+
+/*******************************************************************/
+typedef struct {
+    uint64_t id;
+    uint8_t type;
+    uint8_t xfer_type;
+    uint8_t epnum;
+    uint8_t devnum;
+    uint16_t busnum;
+    uint8_t flag_setup;
+    uint8_t flag_data;
+    int64_t ts_sec;
+    int32_t ts_usec;
+    int32_t status;
+    uint32_t length;
+    uint32_t len_cap;
+    uint8_t setup[USB_SETUP_PACKET_SIZE_BYTES];
+    int32_t interval;
+    int32_t start_frame;
+    uint32_t xfer_flags;
+    uint32_t ndesc;
+} __attribute__((packed)) USBD_REPLAY_usbmon_header_t;
+
+/*******************************************************************/
+typedef struct {
+    uint8_t packet[USBD_REPLAY_PACKET_SIZE_MAX];
+    uint8_t pcap_file[USBD_REPLAY_PCAP_FILE_SIZE_BYTES];
+    USBD_REPLAY_record_t pcap_record[USBD_REPLAY_PCAP_RECORDS_MAX];
+} USBD_REPLAY_context_t;
+
+/*** USBD REPLAY local global variables ***/
+
+static USBD_REPLAY_context_t usbd_replay_ctx;
+
+/*** USBD REPLAY local functions ***/
+
+/*******************************************************************/
+static uint32_t _USBD_REPLAY_get_pcap_u32(uint32_t value, uint8_t swap) {
+    // Convert field of a file written with the opposite endianness.
+    if (swap != 0) {
+        value = (((value & 0x000000FF) << 24) | ((value & 0x0000FF00) << 8) | ((value & 0x00FF0000) >> 8) | ((value & 0xFF000000) >> 24));
+    }
+    return value;
+}
+
+/*******************************************************************/
+static uint64_t _USBD_REPLAY_get_device_time_ns(uint8_t endpoint_number, USB_endpoint_direction_t endpoint_direction) {
+    // Local variables.
+    USBD_SIM_statistics_t statistics;
+    // Endpoints which are not registered did not run any device code.
+    if (USBD_SIM_get_statistics(endpoint_number, endpoint_direction, &statistics) != USB_SUCCESS) {
+        statistics.device_time_ns = 0;
+    }
+    return (statistics.device_time_ns);
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_REPLAY_issue_token(const USBD_REPLAY_record_t* record, USB_data_t* packet, USBD_SIM_handshake_t* handshake, uint32_t* nak_count) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_request_t request;
+    USB_request_operation_t request_operation = USB_REQUEST_OPERATION_NOT_SUPPORTED;
+    uint32_t packet_size_bytes = (packet->size_bytes);
+    uint8_t retry_count = 0;
+    uint8_t idx = 0;
+    // Check token.
+    switch (record->token) {
+    case USBD_REPLAY_TOKEN_SETUP:
+        for (idx = 0; idx < USB_SETUP_PACKET_SIZE_BYTES; idx++) {
+            ((uint8_t*) &request)[idx] = (packet->data)[idx];
+        }
+        status = USBD_SIM_setup(&request, &request_operation);
+        if (status != USB_SUCCESS) goto errors;
+        // A rejected request is reported as a stall of the control pipe.
+        (*handshake) = (request_operation == USB_REQUEST_OPERATION_NOT_SUPPORTED) ? USBD_SIM_HANDSHAKE_STALL : USBD_SIM_HANDSHAKE_ACK;
+        break;
+    case USBD_REPLAY_TOKEN_IN:
+    case USBD_REPLAY_TOKEN_OUT:
+        // Retry like a host while the device is not ready, unless the trace expects the NAK.
+        do {
+            packet->size_bytes = packet_size_bytes;
+            if ((record->token) == USBD_REPLAY_TOKEN_IN) {
+                status = USBD_SIM_in((record->endpoint_number), packet, handshake);
+            }
+            else {
+                status = USBD_SIM_out((record->endpoint_number), packet, handshake);
+            }
+            if (status != USB_SUCCESS) goto errors;
+            if ((*handshake) != USBD_SIM_HANDSHAKE_NAK) break;
+            (*nak_count)++;
+            retry_count++;
+        }
+        while (((record->handshake) != USBD_SIM_HANDSHAKE_NAK) && (retry_count < USBD_SIM_NAK_RETRY_MAX));
+        break;
+    case USBD_REPLAY_TOKEN_BUS_EVENT:
+        status = USBD_SIM_bus_event(record->bus_event);
+        if (status != USB_SUCCESS) goto errors;
+        (*handshake) = (record->handshake);
+        break;
+    default:
+        status = USB_ERROR_REPLAY_FORMAT;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_REPLAY_run_record(const USBD_REPLAY_record_t* record, USBD_REPLAY_report_t* report) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_endpoint_direction_t endpoint_direction = ((record->token) == USBD_REPLAY_TOKEN_IN) ? USB_ENDPOINT_DIRECTION_IN : USB_ENDPOINT_DIRECTION_OUT;
+    uint8_t endpoint_number = ((record->token) == USBD_REPLAY_TOKEN_SETUP) ? 0 : (record->endpoint_number);
+    USBD_SIM_handshake_t handshake = USBD_SIM_HANDSHAKE_NONE;
+    USB_data_t packet;
+    uint64_t device_time_ns = 0;
+    uint32_t idx = 0;
+    // Check record.
+    if (((record->data) == NULL) && ((record->data_size_bytes) != 0)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if (((record->packet_size_bytes) > USBD_REPLAY_PACKET_SIZE_MAX) || ((record->data_size_bytes) > (record->packet_size_bytes))) {
+        status = USB_ERROR_REPLAY_FORMAT;
+        goto errors;
+    }
+    if (((record->token) == USBD_REPLAY_TOKEN_SETUP) && ((record->data_size_bytes) != USB_SETUP_PACKET_SIZE_BYTES)) {
+        status = USB_ERROR_REPLAY_FORMAT;
+        goto errors;
+    }
+    // Build packet (bytes truncated by the capture are replayed as zeros).
+    packet.data = usbd_replay_ctx.packet;
+    packet.size_bytes = ((record->token) == USBD_REPLAY_TOKEN_IN) ? USBD_REPLAY_PACKET_SIZE_MAX : (record->packet_size_bytes);
+    for (idx = 0; idx < USBD_REPLAY_PACKET_SIZE_MAX; idx++) {
+        usbd_replay_ctx.packet[idx] = (((record->token) != USBD_REPLAY_TOKEN_IN) && (idx < (record->data_size_bytes))) ? (record->data)[idx] : 0;
+    }
+    // Issue transaction and measure the time spent in the device callbacks.
+    device_time_ns = _USBD_REPLAY_get_device_time_ns(endpoint_number, endpoint_direction);
+    status = _USBD_REPLAY_issue_token(record, &packet, &handshake, &(report->nak_count));
+    device_time_ns = (_USBD_REPLAY_get_device_time_ns(endpoint_number, endpoint_direction) - device_time_ns);
+    if (status != USB_SUCCESS) {
+        report->mismatch = USBD_REPLAY_MISMATCH_STATUS;
+        goto errors;
+    }
+    report->device_time_ns += device_time_ns;
+    if (device_time_ns > (report->device_time_max_ns)) {
+        report->device_time_max_ns = device_time_ns;
+        report->device_time_max_index = (report->number_of_records);
+    }
+    // Check device response.
+    if (handshake != (record->handshake)) {
+        report->mismatch = USBD_REPLAY_MISMATCH_HANDSHAKE;
+        goto errors;
+    }
+    if ((record->token) == USBD_REPLAY_TOKEN_IN) {
+        if ((packet.size_bytes) != (record->packet_size_bytes)) {
+            report->mismatch = USBD_REPLAY_MISMATCH_DATA_SIZE;
+            goto errors;
+        }
+        for (idx = 0; idx < (record->data_size_bytes); idx++) {
+            if ((packet.data)[idx] != (record->data)[idx]) {
+                report->mismatch = USBD_REPLAY_MISMATCH_DATA;
+                goto errors;
+            }
+        }
+    }
+    if (((record->device_time_max_ns) != 0) && (device_time_ns > (record->device_time_max_ns))) {
+        report->mismatch = USBD_REPLAY_MISMATCH_DEVICE_TIME;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_REPLAY_add_pcap_record(uint32_t* number_of_records, USBD_REPLAY_token_t token, uint8_t endpoint_number, const uint8_t* data, uint32_t data_size_bytes, uint32_t packet_size_bytes, USBD_SIM_handshake_t handshake, uint32_t device_time_max_ns) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_REPLAY_record_t* record = NULL;
+    // Check index.
+    if ((*number_of_records) >= USBD_REPLAY_PCAP_RECORDS_MAX) {
+        status = USB_ERROR_REPLAY_TRACE_SIZE;
+        goto errors;
+    }
+    record = &(usbd_replay_ctx.pcap_record[*number_of_records]);
+    record->token = token;
+    record->endpoint_number = endpoint_number;
+    record->bus_event = USB_BUS_EVENT_LAST;
+    record->data = data;
+    record->data_size_bytes = data_size_bytes;
+    record->packet_size_bytes = packet_size_bytes;
+    record->handshake = handshake;
+    record->device_time_max_ns = device_time_max_ns;
+    (*number_of_records)++;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_REPLAY_load_pcap(const char* file_path, uint32_t device_time_max_ns, uint32_t* number_of_records) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    FILE* file = NULL;
+    USBD_REPLAY_pcap_header_t* pcap_header = (USBD_REPLAY_pcap_header_t*) usbd_replay_ctx.pcap_file;
+    USBD_REPLAY_pcap_record_header_t* pcap_record_header = NULL;
+    USBD_REPLAY_usbmon_header_t* usbmon_header = NULL;
+    USBD_SIM_handshake_t handshake = USBD_SIM_HANDSHAKE_ACK;
+    uint32_t magic_number = 0;
+    uint32_t incl_len = 0;
+    uint32_t length = 0;
+    uint32_t len_cap = 0;
+    uint8_t endpoint_number = 0;
+    uint8_t direction_in = 0;
+    uint8_t swap = 0;
+    size_t file_size_bytes = 0;
+    size_t offset = 0;
+    // Read file.
+    file = fopen(file_path, "rb");
+    if (file == NULL) {
+        status = USB_ERROR_REPLAY_FILE;
+        goto errors;
+    }
+    file_size_bytes = fread(usbd_replay_ctx.pcap_file, 1, USBD_REPLAY_PCAP_FILE_SIZE_BYTES, file);
+    if (fgetc(file) != EOF) {
+        status = USB_ERROR_REPLAY_TRACE_SIZE;
+        goto errors;
+    }
+    if (file_size_bytes < sizeof(USBD_REPLAY_pcap_header_t)) {
+        status = USB_ERROR_REPLAY_FORMAT;
+        goto errors;
+    }
+    // Check global header (timestamps are not used, so microsecond and nanosecond files are both accepted).
+    magic_number = (pcap_header->magic_number);
+    if ((magic_number != USBD_REPLAY_PCAP_MAGIC_NUMBER_US) && (magic_number != USBD_REPLAY_PCAP_MAGIC_NUMBER_NS)) {
+        swap = 1;
+        magic_number = _USBD_REPLAY_get_pcap_u32(magic_number, swap);
+    }
+    if (((magic_number != USBD_REPLAY_PCAP_MAGIC_NUMBER_US) && (magic_number != USBD_REPLAY_PCAP_MAGIC_NUMBER_NS)) || (_USBD_REPLAY_get_pcap_u32((pcap_header->network), swap) != USBD_REPLAY_PCAP_LINKTYPE_USBMON)) {
+        status = USB_ERROR_REPLAY_FORMAT;
+        goto errors;
+    }
+    offset = sizeof(USBD_REPLAY_pcap_header_t);
+    (*number_of_records) = 0;
+    // Convert usbmon records to host transactions.
+    while (offset < file_size_bytes) {
+        // Check record bounds.
+        if ((offset + sizeof(USBD_REPLAY_pcap_record_header_t)) > file_size_bytes) {
+            status = USB_ERROR_REPLAY_FORMAT;
+            goto errors;
+        }
+        pcap_record_header = (USBD_REPLAY_pcap_record_header_t*) &(usbd_replay_ctx.pcap_file[offset]);
+        incl_len = _USBD_REPLAY_get_pcap_u32((pcap_record_header->incl_len), swap);
+        offset += sizeof(USBD_REPLAY_pcap_record_header_t);
+        if ((incl_len < sizeof(USBD_REPLAY_usbmon_header_t)) || (incl_len > (file_size_bytes - offset))) {
+            status = USB_ERROR_REPLAY_FORMAT;
+            goto errors;
+        }
+        // The usbmon header has the endianness of the capturing machine, like the file.
+        usbmon_header = (USBD_REPLAY_usbmon_header_t*) &(usbd_replay_ctx.pcap_file[offset]);
+        length = _USBD_REPLAY_get_pcap_u32((usbmon_header->length), swap);
+        len_cap = _USBD_REPLAY_get_pcap_u32((usbmon_header->len_cap), swap);
+        if (len_cap > (incl_len - sizeof(USBD_REPLAY_usbmon_header_t))) {
+            status = USB_ERROR_REPLAY_FORMAT;
+            goto errors;
+        }
+        offset += incl_len;
+        endpoint_number = ((usbmon_header->epnum) & USBD_REPLAY_USBMON_ENDPOINT_NUMBER_MASK);
+        direction_in = (((usbmon_header->epnum) & USBD_REPLAY_USBMON_DIRECTION_IN) != 0) ? 1 : 0;
+        handshake = ((usbmon_header->xfer_type) == USBD_REPLAY_USBMON_XFER_TYPE_ISO) ? USBD_SIM_HANDSHAKE_NONE : USBD_SIM_HANDSHAKE_ACK;
+        // Only the packet level captures of the device side (USBD_CAPTURE) can be replayed:
+        // host side usbmon captures log URBs, whose IN submissions and OUT completions carry no data and whose control OUT submissions embed the data stage.
+        if ((endpoint_number != 0) && ((((usbmon_header->type) == USBD_REPLAY_USBMON_TYPE_SUBMISSION) && (direction_in != 0)) || (((usbmon_header->type) == USBD_REPLAY_USBMON_TYPE_CALLBACK) && (direction_in == 0)))) {
+            status = USB_ERROR_REPLAY_FORMAT;
+            goto errors;
+        }
+        if (((usbmon_header->type) == USBD_REPLAY_USBMON_TYPE_SUBMISSION) && ((usbmon_header->flag_setup) == USBD_REPLAY_USBMON_FLAG_PRESENT)) {
+            if (len_cap != 0) {
+                status = USB_ERROR_REPLAY_FORMAT;
+                goto errors;
+            }
+            status = _USBD_REPLAY_add_pcap_record(number_of_records, USBD_REPLAY_TOKEN_SETUP, 0, (usbmon_header->setup), USB_SETUP_PACKET_SIZE_BYTES, USB_SETUP_PACKET_SIZE_BYTES, USBD_SIM_HANDSHAKE_ACK, device_time_max_ns);
+        }
+        else if ((usbmon_header->type) == USBD_REPLAY_USBMON_TYPE_SUBMISSION) {
+            // Device OUT reads, including the status stage of control reads.
+            status = _USBD_REPLAY_add_pcap_record(number_of_records, USBD_REPLAY_TOKEN_OUT, endpoint_number, ((uint8_t*) usbmon_header) + sizeof(USBD_REPLAY_usbmon_header_t), len_cap, length, handshake, device_time_max_ns);
+        }
+        else if ((usbmon_header->type) == USBD_REPLAY_USBMON_TYPE_CALLBACK) {
+            // Device IN writes, including the status stage of control writes.
+            status = _USBD_REPLAY_add_pcap_record(number_of_records, USBD_REPLAY_TOKEN_IN, endpoint_number, ((uint8_t*) usbmon_header) + sizeof(USBD_REPLAY_usbmon_header_t), len_cap, length, handshake, device_time_max_ns);
+        }
+        else {
+            status = USB_ERROR_REPLAY_FORMAT;
+        }
+        if (status != USB_SUCCESS) goto errors;
+    }
+errors:
+    if (file != NULL) {
+        fclose(file);
+    }
+    return status;
+}
+
+/*** USBD REPLAY functions ***/
+
+/*******************************************************************/
+USB_status_t USBD_REPLAY_run(const USBD_REPLAY_record_t* record_list, uint32_t number_of_records, USBD_REPLAY_report_t* report) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint32_t idx = 0;
+    // Check parameters.
+    if ((report == NULL) || ((record_list == NULL) && (number_of_records != 0))) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Reset report.
+    report->number_of_records = 0;
+    report->mismatch_index = 0;
+    report->mismatch = USBD_REPLAY_MISMATCH_NONE;
+    report->nak_count = 0;
+    report->device_time_ns = 0;
+    report->device_time_max_ns = 0;
+    report->device_time_max_index = 0;
+    // Records loop.
+    for (idx = 0; idx < number_of_records; idx++) {
+        status = _USBD_REPLAY_run_record(&(record_list[idx]), report);
+        if (status != USB_SUCCESS) {
+            // Transaction errors of the simulated controller are part of the device behavior.
+            if ((report->mismatch) == USBD_REPLAY_MISMATCH_NONE) goto errors;
+            status = USB_SUCCESS;
+        }
+        if ((report->mismatch) != USBD_REPLAY_MISMATCH_NONE) {
+            report->mismatch_index = idx;
+            status = USB_ERROR_REPLAY_MISMATCH;
+            goto errors;
+        }
+        report->number_of_records++;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_REPLAY_run_pcap(const char* file_path, uint32_t device_time_max_ns, USBD_REPLAY_report_t* report) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint32_t number_of_records = 0;
+    // Check parameters.
+    if ((file_path == NULL) || (report == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Convert file and replay it.
+    status = _USBD_REPLAY_load_pcap(file_path, device_time_max_ns, &number_of_records);
+    if (status != USB_SUCCESS) goto errors;
+    status = USBD_REPLAY_run(usbd_replay_ctx.pcap_record, number_of_records, report);
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+#endif /* USB_LIB_DISABLE */
@@ -0,0 +1,1299 @@
+/*
+ * usbd_sim.c
+ *
+ *  Created on: 17 oct. 2026
+ *      Author: Ludo
+ */
+
+#include "device/sim/usbd_sim.h"
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_configuration.h"
+#include "common/usb_descriptor.h"
+#include "common/usb_device.h"
+#include "common/usb_endpoint.h"
+#include "common/usb_interface.h"
+#include "common/usb_request.h"
+#include "common/usb_types.h"
+#include "device/usbd.h"
+#include "device/usbd_event.h"
+#include "device/usbd_hw.h"
+#include "device/usbd_pma.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_SIM))
+
+#include <time.h>
+
+/*** USBD SIM local macros ***/
+
+// Descriptors enumeration fields are serialized as single bytes, which requires the -fshort-enums option on the host compiler.
+_Static_assert(sizeof(USB_device_descriptor_t) == 18, "USBD_SIM requires -fshort-enums");
+_Static_assert(sizeof(USB_configuration_descriptor_t) == 9, "USBD_SIM requires -fshort-enums");
+_Static_assert(sizeof(USB_interface_descriptor_t) == 9, "USBD_SIM requires -fshort-enums");
+_Static_assert(sizeof(USB_endpoint_descriptor_t) == 7, "USBD_SIM requires -fshort-enums");
+
+#define USBD_SIM_NUMBER_OF_ENDPOINTS            16
+#define USBD_SIM_PACKET_SIZE_MAX                1024
+#define USBD_SIM_NUMBER_OF_BUFFERS              2
+
+#define USBD_SIM_UNIQUE_ID_SIZE_BYTES           12
+
+#define USBD_SIM_FRAME_PERIOD_NS                1000000
+
+#define USBD_SIM_DESCRIPTOR_TOTAL_LENGTH_INDEX  2
+
+/*** USBD SIM local structures ***/
+
+/*******************************************************************/
+typedef union {
+    uint8_t all;
+    struct {
+        uint8_t full :1;
+        uint8_t lent :1;
+    } __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed));
+} USBD_SIM_buffer_flags_t;
+
+/*******************************************************************/
+typedef struct {
+    USBD_SIM_buffer_flags_t flags;
+    uint8_t packet[USBD_SIM_PACKET_SIZE_MAX];
+    uint8_t* lent_data;
+    uint32_t packet_size_bytes;
+} USBD_SIM_buffer_t;
+
+/*******************************************************************/
+typedef union {
+    uint8_t all;
+    struct {
+        uint8_t registered :1;
+        uint8_t stall :1;
+    } __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed));
+} USBD_SIM_endpoint_flags_t;
+
+/*******************************************************************/
+typedef struct {
+    USBD_SIM_endpoint_flags_t flags;
+    USB_physical_endpoint_t* physical_endpoint;
+    USBD_SIM_buffer_t buffer[USBD_SIM_NUMBER_OF_BUFFERS];
+    uint8_t number_of_buffers;
+    uint8_t host_index;
+    uint8_t device_index;
+    USBD_SIM_statistics_t statistics;
+} USBD_SIM_endpoint_t;
+
+/*******************************************************************/
+typedef union {
+    uint8_t all;
+    struct {
+        uint8_t init :1;
+        uint8_t started :1;
+        uint8_t suspended :1;
+        uint8_t sof_notified :1;
+    } __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed));
+} USBD_SIM_flags_t;
+
+/*******************************************************************/
+typedef struct {
+    USBD_SIM_flags_t flags;
+    USB_setup_cb_t setup_callback;
+    USB_bus_event_cb_t bus_event_callback;
+    USB_sof_cb_t sof_callback;
+    uint16_t sof_frame_number;
+    USBD_SIM_endpoint_t endpoint[USBD_SIM_NUMBER_OF_ENDPOINTS][USB_ENDPOINT_DIRECTION_LAST];
+    uint8_t setup_packet[USB_SETUP_PACKET_SIZE_BYTES];
+    uint8_t device_address;
+    USB_speed_t speed;
+} USBD_SIM_context_t;
+
+/*** USBD SIM local global variables ***/
+
+static const uint8_t USBD_SIM_UNIQUE_ID[USBD_SIM_UNIQUE_ID_SIZE_BYTES] = {
+    0x55, 0x53, 0x42, 0x44, 0x53, 0x49, 0x4D, 0x00, 0x00, 0x00, 0x00, 0x01
+};
+
+static USBD_SIM_context_t usbd_sim_ctx = {
+    .flags.all = 0,
+    .setup_callback = NULL,
+    .bus_event_callback = NULL,
+    .sof_callback = NULL,
+    .sof_frame_number = 0,
+    .device_address = 0,
+    .speed = USB_SPEED_HIGH
+};
+
+/*** USBD SIM local functions ***/
+
+/*******************************************************************/
+static uint64_t _USBD_SIM_get_time_ns(void) {
+    // Local variables.
+    struct timespec now;
+    // Read monotonic clock.
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((((uint64_t) now.tv_sec) * 1000000000ULL) + ((uint64_t) now.tv_nsec));
+}
+
+/*******************************************************************/
+static uint16_t _USBD_SIM_get_frame_number(void) {
+    // Frames are derived from the monotonic clock (11-bits counter of the SOF packets).
+    return ((uint16_t) ((_USBD_SIM_get_time_ns() / USBD_SIM_FRAME_PERIOD_NS) & USB_FRAME_NUMBER_MASK));
+}
+
+/*******************************************************************/
+static void _USBD_SIM_sof(void) {
+    // Local variables.
+    uint16_t frame_number = _USBD_SIM_get_frame_number();
+    // Frames elapsed since the last notification are reported once (like a missed SOF interrupt).
+    if ((usbd_sim_ctx.sof_callback == NULL) || ((usbd_sim_ctx.flags.sof_notified != 0) && (frame_number == usbd_sim_ctx.sof_frame_number))) goto errors;
+    usbd_sim_ctx.flags.sof_notified = 1;
+    usbd_sim_ctx.sof_frame_number = frame_number;
+#ifdef USBD_EVENT_QUEUE
+    USBD_EVENT_push_sof(usbd_sim_ctx.sof_callback, frame_number);
+    USBD_process();
+#else
+    usbd_sim_ctx.sof_callback(frame_number);
+#endif
+errors:
+    return;
+}
+
+/*******************************************************************/
+static void _USBD_SIM_flush_buffers(USBD_SIM_endpoint_t* endpoint) {
+    // Local variables.
+    uint8_t idx = 0;
+    // Buffers loop.
+    for (idx = 0; idx < USBD_SIM_NUMBER_OF_BUFFERS; idx++) {
+        endpoint->buffer[idx].flags.all = 0;
+        endpoint->buffer[idx].lent_data = NULL;
+        endpoint->buffer[idx].packet_size_bytes = 0;
+    }
+    endpoint->host_index = 0;
+    endpoint->device_index = 0;
+}
+
+/*******************************************************************/
+static void _USBD_SIM_reset_endpoints(void) {
+    // Local variables.
+    uint8_t number = 0;
+    uint8_t direction = 0;
+    // Endpoints loop.
+    for (number = 0; number < USBD_SIM_NUMBER_OF_ENDPOINTS; number++) {
+        for (direction = 0; direction < USB_ENDPOINT_DIRECTION_LAST; direction++) {
+            usbd_sim_ctx.endpoint[number][direction].flags.all = 0;
+            usbd_sim_ctx.endpoint[number][direction].physical_endpoint = NULL;
+            usbd_sim_ctx.endpoint[number][direction].number_of_buffers = 1;
+            _USBD_SIM_flush_buffers(&(usbd_sim_ctx.endpoint[number][direction]));
+        }
+    }
+}
+
+/*******************************************************************/
+static void _USBD_SIM_flush_endpoints(void) {
+    // Local variables.
+    uint8_t number = 0;
+    uint8_t direction = 0;
+    // Endpoints loop (registrations are kept).
+    for (number = 0; number < USBD_SIM_NUMBER_OF_ENDPOINTS; number++) {
+        for (direction = 0; direction < USB_ENDPOINT_DIRECTION_LAST; direction++) {
+            usbd_sim_ctx.endpoint[number][direction].flags.stall = 0;
+            _USBD_SIM_flush_buffers(&(usbd_sim_ctx.endpoint[number][direction]));
+        }
+    }
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_SIM_get_endpoint(USB_physical_endpoint_t* physical_endpoint, USBD_SIM_endpoint_t** endpoint) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameters.
+    if (physical_endpoint == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if ((physical_endpoint->number) >= USBD_SIM_NUMBER_OF_ENDPOINTS) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    if ((physical_endpoint->direction) >= USB_ENDPOINT_DIRECTION_LAST) {
+        status = USB_ERROR_ENDPOINT_DIRECTION;
+        goto errors;
+    }
+    (*endpoint) = &(usbd_sim_ctx.endpoint[physical_endpoint->number][physical_endpoint->direction]);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_SIM_get_host_endpoint(uint8_t endpoint_number, USB_endpoint_direction_t endpoint_direction, USBD_SIM_endpoint_t** endpoint) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check state.
+    if (usbd_sim_ctx.flags.started == 0) {
+        status = USB_ERROR_SIM_DETACHED;
+        goto errors;
+    }
+    if (usbd_sim_ctx.flags.suspended != 0) {
+        status = USB_ERROR_SIM_SUSPENDED;
+        goto errors;
+    }
+    // Check endpoint.
+    if (endpoint_number >= USBD_SIM_NUMBER_OF_ENDPOINTS) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    (*endpoint) = &(usbd_sim_ctx.endpoint[endpoint_number][endpoint_direction]);
+    if ((((*endpoint)->flags.registered) == 0) || (((*endpoint)->physical_endpoint) == NULL)) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    // Report the start of frame before the first transaction of a new frame.
+    _USBD_SIM_sof();
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static void _USBD_SIM_call_endpoint_callback(USBD_SIM_endpoint_t* endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status) {
+    // Local variables.
+    uint64_t start_ns = 0;
+    // Check callback.
+    if ((endpoint->physical_endpoint->callback) == NULL) goto errors;
+    // Packets shorter than the maximum size end the transfer.
+    if ((transfer_status == USB_ENDPOINT_TRANSFER_STATUS_OK) && (size_bytes < USB_ENDPOINT_GET_MAX_PACKET_SIZE(endpoint->physical_endpoint, usbd_sim_ctx.speed))) {
+        transfer_status = USB_ENDPOINT_TRANSFER_STATUS_SHORT;
+    }
+    // Measure the time spent in the device stack.
+    start_ns = _USBD_SIM_get_time_ns();
+#ifdef USBD_EVENT_QUEUE
+    // The interrupt only queues the event, and the application task runs before the next host transaction.
+    USBD_EVENT_push_endpoint(endpoint->physical_endpoint, size_bytes, transfer_status, _USBD_SIM_get_frame_number());
+    USBD_process();
+#else
+    endpoint->physical_endpoint->callback(endpoint->physical_endpoint, size_bytes, transfer_status, _USBD_SIM_get_frame_number());
+#endif
+    endpoint->statistics.device_time_ns += (_USBD_SIM_get_time_ns() - start_ns);
+errors:
+    return;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_SIM_wait_in(uint8_t endpoint_number, USB_data_t* data_in) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_handshake_t handshake = USBD_SIM_HANDSHAKE_NAK;
+    uint32_t retry_count = 0;
+    // Retry while the device answers NAK.
+    while (retry_count <= USBD_SIM_NAK_RETRY_MAX) {
+        status = USBD_SIM_in(endpoint_number, data_in, &handshake);
+        if (status != USB_SUCCESS) goto errors;
+        if (handshake != USBD_SIM_HANDSHAKE_NAK) break;
+        retry_count++;
+    }
+    // Check handshake.
+    if (handshake == USBD_SIM_HANDSHAKE_NAK) {
+        status = USB_ERROR_SIM_NAK_TIMEOUT;
+        goto errors;
+    }
+    if (handshake == USBD_SIM_HANDSHAKE_STALL) {
+        status = USB_ERROR_SIM_STALL;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_SIM_wait_out(uint8_t endpoint_number, USB_data_t* data_out) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_handshake_t handshake = USBD_SIM_HANDSHAKE_NAK;
+    uint32_t retry_count = 0;
+    // Retry while the device answers NAK.
+    while (retry_count <= USBD_SIM_NAK_RETRY_MAX) {
+        status = USBD_SIM_out(endpoint_number, data_out, &handshake);
+        if (status != USB_SUCCESS) goto errors;
+        if (handshake != USBD_SIM_HANDSHAKE_NAK) break;
+        retry_count++;
+    }
+    // Check handshake.
+    if (handshake == USBD_SIM_HANDSHAKE_NAK) {
+        status = USB_ERROR_SIM_NAK_TIMEOUT;
+        goto errors;
+    }
+    if (handshake == USBD_SIM_HANDSHAKE_STALL) {
+        status = USB_ERROR_SIM_STALL;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*** USBD HW functions ***/
+
+/*******************************************************************/
+USB_status_t USBD_HW_init(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Reset controller.
+    usbd_sim_ctx.flags.all = 0;
+    usbd_sim_ctx.setup_callback = NULL;
+    usbd_sim_ctx.bus_event_callback = NULL;
+    usbd_sim_ctx.sof_callback = NULL;
+    usbd_sim_ctx.device_address = 0;
+    _USBD_SIM_reset_endpoints();
+    USBD_SIM_reset_statistics();
+    // Update initialization flag.
+    usbd_sim_ctx.flags.init = 1;
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_de_init(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Release controller.
+    _USBD_SIM_reset_endpoints();
+    usbd_sim_ctx.flags.all = 0;
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_register_setup_callback(USB_setup_cb_t setup_callback) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (setup_callback == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    usbd_sim_ctx.setup_callback = setup_callback;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_register_bus_event_callback(USB_bus_event_cb_t bus_event_callback) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (bus_event_callback == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    usbd_sim_ctx.bus_event_callback = bus_event_callback;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_register_sof_callback(USB_sof_cb_t sof_callback) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (sof_callback == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    usbd_sim_ctx.sof_callback = sof_callback;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_register_endpoint(USB_physical_endpoint_t* endpoint) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* sim_endpoint = NULL;
+#ifdef USBD_PMA
+    uint32_t offset = 0;
+#endif
+    // Get endpoint.
+    status = _USBD_SIM_get_endpoint(endpoint, &sim_endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    // Check packet size.
+    if (((endpoint->max_packet_size_bytes) > USBD_SIM_PACKET_SIZE_MAX) || ((endpoint->high_speed_max_packet_size_bytes) > USBD_SIM_PACKET_SIZE_MAX)) {
+        status = USB_ERROR_SIM_PACKET_SIZE;
+        goto errors;
+    }
+    // Check buffer mode (control pipe is always single buffered).
+    if (((endpoint->buffer_mode) >= USB_ENDPOINT_BUFFER_MODE_LAST) || (((endpoint->buffer_mode) == USB_ENDPOINT_BUFFER_MODE_DOUBLE) && ((endpoint->transfer_type) == USB_ENDPOINT_TRANSFER_TYPE_CONTROL))) {
+        status = USB_ERROR_ENDPOINT_BUFFER_MODE;
+        goto errors;
+    }
+#ifdef USBD_PMA
+    // Check that the packet memory layout holds all the endpoint buffers, as a real peripheral would.
+    status = USBD_PMA_get_buffer(endpoint, 0, &offset);
+    if (status != USB_SUCCESS) goto errors;
+    if ((endpoint->buffer_mode) == USB_ENDPOINT_BUFFER_MODE_DOUBLE) {
+        status = USBD_PMA_get_buffer(endpoint, 1, &offset);
+        if (status != USB_SUCCESS) goto errors;
+    }
+#endif
+    // Register endpoint.
+    sim_endpoint->flags.all = 0;
+    sim_endpoint->flags.registered = 1;
+    sim_endpoint->physical_endpoint = endpoint;
+    sim_endpoint->number_of_buffers = ((endpoint->buffer_mode) == USB_ENDPOINT_BUFFER_MODE_DOUBLE) ? 2 : 1;
+    _USBD_SIM_flush_buffers(sim_endpoint);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_unregister_endpoint(USB_physical_endpoint_t* endpoint) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* sim_endpoint = NULL;
+    // Get endpoint.
+    status = _USBD_SIM_get_endpoint(endpoint, &sim_endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    // Release endpoint.
+    sim_endpoint->flags.all = 0;
+    sim_endpoint->physical_endpoint = NULL;
+    _USBD_SIM_flush_buffers(sim_endpoint);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_set_stall(USB_physical_endpoint_t* endpoint) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* sim_endpoint = NULL;
+    // Get endpoint.
+    status = _USBD_SIM_get_endpoint(endpoint, &sim_endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    sim_endpoint->flags.stall = 1;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_clear_stall(USB_physical_endpoint_t* endpoint) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* sim_endpoint = NULL;
+    // Get endpoint.
+    status = _USBD_SIM_get_endpoint(endpoint, &sim_endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    sim_endpoint->flags.stall = 0;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_set_address(uint8_t device_address) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Update address.
+    usbd_sim_ctx.device_address = device_address;
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_set_control_status_pending(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Status stage is never answered by the simulated controller itself, so the control pipe already NAKs until the driver writes or stalls.
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_start(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Attach device.
+    usbd_sim_ctx.flags.started = 1;
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_stop(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Detach device.
+    usbd_sim_ctx.flags.started = 0;
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_write_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (usb_data_in == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Write single segment.
+    status = USBD_HW_write_data_vector(endpoint, usb_data_in, 1);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_write_data_vector(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in_list, uint8_t number_of_segments) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* sim_endpoint = NULL;
+    USBD_SIM_buffer_t* buffer = NULL;
+    uint32_t max_packet_size_bytes = 0;
+    uint32_t packet_size_bytes = 0;
+    uint32_t idx = 0;
+    uint8_t segment_idx = 0;
+    // Check parameters.
+    if ((usb_data_in_list == NULL) && (number_of_segments != 0)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Get endpoint.
+    status = _USBD_SIM_get_endpoint(endpoint, &sim_endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    if ((sim_endpoint->flags.registered) == 0) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    if ((endpoint->direction) != USB_ENDPOINT_DIRECTION_IN) {
+        status = USB_ERROR_ENDPOINT_DIRECTION;
+        goto errors;
+    }
+    max_packet_size_bytes = USB_ENDPOINT_GET_MAX_PACKET_SIZE(endpoint, usbd_sim_ctx.speed);
+    for (segment_idx = 0; segment_idx < number_of_segments; segment_idx++) {
+        if (((usb_data_in_list[segment_idx].data) == NULL) && ((usb_data_in_list[segment_idx].size_bytes) != 0)) {
+            status = USB_ERROR_NULL_PARAMETER;
+            goto errors;
+        }
+        // Compare with the remaining room so that the total size can not wrap.
+        if ((usb_data_in_list[segment_idx].size_bytes) > (max_packet_size_bytes - packet_size_bytes)) {
+            status = USB_ERROR_SIM_PACKET_SIZE;
+            goto errors;
+        }
+        packet_size_bytes += (usb_data_in_list[segment_idx].size_bytes);
+    }
+    // A single buffer is overwritten by a new packet, while both buffers are in use in double buffer mode.
+    buffer = &(sim_endpoint->buffer[sim_endpoint->device_index]);
+    if (((buffer->flags.lent) != 0) || (((buffer->flags.full) != 0) && ((sim_endpoint->number_of_buffers) > 1))) {
+        status = USB_ERROR_ENDPOINT_BUFFER_OWNERSHIP;
+        goto errors;
+    }
+    // Gather segments directly in packet memory.
+    buffer->packet_size_bytes = 0;
+    for (segment_idx = 0; segment_idx < number_of_segments; segment_idx++) {
+        for (idx = 0; idx < (usb_data_in_list[segment_idx].size_bytes); idx++) {
+            buffer->packet[buffer->packet_size_bytes++] = usb_data_in_list[segment_idx].data[idx];
+        }
+    }
+    if ((buffer->flags.full) == 0) {
+        buffer->flags.full = 1;
+        sim_endpoint->device_index = (((sim_endpoint->device_index) + 1) % (sim_endpoint->number_of_buffers));
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_read_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* sim_endpoint = NULL;
+    USBD_SIM_buffer_t* buffer = NULL;
+    // Check parameter.
+    if (usb_data_out == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Get endpoint.
+    status = _USBD_SIM_get_endpoint(endpoint, &sim_endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    if ((sim_endpoint->flags.registered) == 0) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    if ((endpoint->direction) != USB_ENDPOINT_DIRECTION_OUT) {
+        status = USB_ERROR_ENDPOINT_DIRECTION;
+        goto errors;
+    }
+    buffer = &(sim_endpoint->buffer[sim_endpoint->device_index]);
+    if ((buffer->flags.lent) != 0) {
+        status = USB_ERROR_ENDPOINT_BUFFER_OWNERSHIP;
+        goto errors;
+    }
+    // Lend packet memory and re-arm the buffer.
+    usb_data_out->data = (buffer->packet);
+    usb_data_out->size_bytes = 0;
+    if ((buffer->flags.full) != 0) {
+        usb_data_out->size_bytes = (buffer->packet_size_bytes);
+        buffer->flags.full = 0;
+        sim_endpoint->device_index = (((sim_endpoint->device_index) + 1) % (sim_endpoint->number_of_buffers));
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_submit_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* sim_endpoint = NULL;
+    USBD_SIM_buffer_t* buffer = NULL;
+    // Check parameters.
+    if (usb_data_in == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if (((usb_data_in->data) == NULL) && ((usb_data_in->size_bytes) != 0)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Get endpoint.
+    status = _USBD_SIM_get_endpoint(endpoint, &sim_endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    if ((sim_endpoint->flags.registered) == 0) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    if ((endpoint->direction) != USB_ENDPOINT_DIRECTION_IN) {
+        status = USB_ERROR_ENDPOINT_DIRECTION;
+        goto errors;
+    }
+    if ((usb_data_in->size_bytes) > USB_ENDPOINT_GET_MAX_PACKET_SIZE(endpoint, usbd_sim_ctx.speed)) {
+        status = USB_ERROR_SIM_PACKET_SIZE;
+        goto errors;
+    }
+    // A packet buffer must be free before the peripheral takes another caller buffer.
+    buffer = &(sim_endpoint->buffer[sim_endpoint->device_index]);
+    if ((buffer->flags.full) != 0) {
+        status = USB_ERROR_ENDPOINT_BUFFER_OWNERSHIP;
+        goto errors;
+    }
+    // Take buffer ownership until the IN transaction.
+    buffer->lent_data = (usb_data_in->data);
+    buffer->packet_size_bytes = (usb_data_in->size_bytes);
+    buffer->flags.lent = 1;
+    buffer->flags.full = 1;
+    sim_endpoint->device_index = (((sim_endpoint->device_index) + 1) % (sim_endpoint->number_of_buffers));
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_acquire_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* sim_endpoint = NULL;
+    USBD_SIM_buffer_t* buffer = NULL;
+    // Check parameter.
+    if (usb_data_out == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Get endpoint.
+    status = _USBD_SIM_get_endpoint(endpoint, &sim_endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    if ((sim_endpoint->flags.registered) == 0) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    if ((endpoint->direction) != USB_ENDPOINT_DIRECTION_OUT) {
+        status = USB_ERROR_ENDPOINT_DIRECTION;
+        goto errors;
+    }
+    buffer = &(sim_endpoint->buffer[sim_endpoint->device_index]);
+    if ((buffer->flags.lent) != 0) {
+        status = USB_ERROR_ENDPOINT_BUFFER_OWNERSHIP;
+        goto errors;
+    }
+    // Lend packet memory (the host cannot write a lent buffer until release).
+    usb_data_out->data = (buffer->packet);
+    usb_data_out->size_bytes = ((buffer->flags.full) != 0) ? (buffer->packet_size_bytes) : 0;
+    buffer->flags.lent = 1;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_release_data(USB_physical_endpoint_t* endpoint) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* sim_endpoint = NULL;
+    USBD_SIM_buffer_t* buffer = NULL;
+    // Get endpoint.
+    status = _USBD_SIM_get_endpoint(endpoint, &sim_endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    if ((sim_endpoint->flags.registered) == 0) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    if ((endpoint->direction) != USB_ENDPOINT_DIRECTION_OUT) {
+        status = USB_ERROR_ENDPOINT_DIRECTION;
+        goto errors;
+    }
+    buffer = &(sim_endpoint->buffer[sim_endpoint->device_index]);
+    if ((buffer->flags.lent) == 0) {
+        status = USB_ERROR_ENDPOINT_BUFFER_OWNERSHIP;
+        goto errors;
+    }
+    // Re-arm the buffer.
+    buffer->flags.lent = 0;
+    if ((buffer->flags.full) != 0) {
+        buffer->flags.full = 0;
+        sim_endpoint->device_index = (((sim_endpoint->device_index) + 1) % (sim_endpoint->number_of_buffers));
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_read_setup(USB_data_t* usb_setup_out) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (usb_setup_out == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    usb_setup_out->data = (usbd_sim_ctx.setup_packet);
+    usb_setup_out->size_bytes = USB_SETUP_PACKET_SIZE_BYTES;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_get_unique_id(USB_data_t* unique_id) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (unique_id == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    unique_id->data = (uint8_t*) USBD_SIM_UNIQUE_ID;
+    unique_id->size_bytes = USBD_SIM_UNIQUE_ID_SIZE_BYTES;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_get_speed(USB_speed_t* speed) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (speed == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    (*speed) = usbd_sim_ctx.speed;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_HW_get_frame_number(uint16_t* frame_number) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (frame_number == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    (*frame_number) = _USBD_SIM_get_frame_number();
+errors:
+    return status;
+}
+
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+/*******************************************************************/
+USB_status_t USBD_HW_get_cycle_count(uint32_t* cycle_count) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (cycle_count == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // One cycle is one nanosecond of the monotonic clock.
+    (*cycle_count) = (uint32_t) _USBD_SIM_get_time_ns();
+errors:
+    return status;
+}
+#endif
+
+#ifdef USBD_CAPTURE
+/*******************************************************************/
+USB_status_t USBD_HW_get_time_us(uint64_t* time_us) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    struct timespec now;
+    // Check parameter.
+    if (time_us == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    clock_gettime(CLOCK_REALTIME, &now);
+    (*time_us) = ((((uint64_t) now.tv_sec) * 1000000ULL) + (((uint64_t) now.tv_nsec) / 1000ULL));
+errors:
+    return status;
+}
+#endif
+
+/*** USBD SIM functions ***/
+
+/*******************************************************************/
+USB_status_t USBD_SIM_setup(USB_request_t* request, USB_request_operation_t* request_operation) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* ep0_out = NULL;
+    USBD_SIM_endpoint_t* ep0_in = NULL;
+    uint64_t start_ns = 0;
+    uint8_t idx = 0;
+    // Check parameters.
+    if ((request == NULL) || (request_operation == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    (*request_operation) = USB_REQUEST_OPERATION_NOT_SUPPORTED;
+    // Get control endpoints.
+    status = _USBD_SIM_get_host_endpoint(0, USB_ENDPOINT_DIRECTION_OUT, &ep0_out);
+    if (status != USB_SUCCESS) goto errors;
+    status = _USBD_SIM_get_host_endpoint(0, USB_ENDPOINT_DIRECTION_IN, &ep0_in);
+    if (status != USB_SUCCESS) goto errors;
+    if (usbd_sim_ctx.setup_callback == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // A setup packet is always accepted and clears the control pipe state.
+    for (idx = 0; idx < USB_SETUP_PACKET_SIZE_BYTES; idx++) {
+        usbd_sim_ctx.setup_packet[idx] = ((uint8_t*) request)[idx];
+    }
+    _USBD_SIM_flush_buffers(ep0_out);
+    ep0_out->flags.stall = 0;
+    _USBD_SIM_flush_buffers(ep0_in);
+    ep0_in->flags.stall = 0;
+    ep0_out->statistics.transactions_count++;
+    ep0_out->statistics.bytes_count += USB_SETUP_PACKET_SIZE_BYTES;
+    // Call control driver.
+    start_ns = _USBD_SIM_get_time_ns();
+#ifdef USBD_EVENT_QUEUE
+    status = USBD_EVENT_push_setup(usbd_sim_ctx.setup_callback);
+    if (status != USB_SUCCESS) goto errors;
+    USBD_process();
+    // The operation is not returned by the queue, so it is deduced from the control pipe state.
+    if (((ep0_out->flags.stall) == 0) && ((ep0_in->flags.stall) == 0)) {
+        if ((request->wLength) == 0) {
+            (*request_operation) = USB_REQUEST_OPERATION_WRITE_NO_DATA;
+        }
+        else {
+            (*request_operation) = ((request->bmRequestType.direction) == USB_REQUEST_DIRECTION_DEVICE_TO_HOST) ? USB_REQUEST_OPERATION_READ : USB_REQUEST_OPERATION_WRITE;
+        }
+    }
+#else
+    usbd_sim_ctx.setup_callback(request_operation);
+#endif
+    ep0_out->statistics.device_time_ns += (_USBD_SIM_get_time_ns() - start_ns);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_SIM_in(uint8_t endpoint_number, USB_data_t* data_in, USBD_SIM_handshake_t* handshake) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* endpoint = NULL;
+    USBD_SIM_buffer_t* buffer = NULL;
+    uint8_t* packet = NULL;
+    uint32_t idx = 0;
+    // Check parameters.
+    if ((data_in == NULL) || (handshake == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if (((data_in->data) == NULL) && ((data_in->size_bytes) != 0)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    (*handshake) = USBD_SIM_HANDSHAKE_NAK;
+    // Get endpoint.
+    status = _USBD_SIM_get_host_endpoint(endpoint_number, USB_ENDPOINT_DIRECTION_IN, &endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    endpoint->statistics.transactions_count++;
+    // Check halt condition.
+    if ((endpoint->flags.stall) != 0) {
+        endpoint->statistics.stall_count++;
+        (*handshake) = USBD_SIM_HANDSHAKE_STALL;
+        data_in->size_bytes = 0;
+        goto errors;
+    }
+    // Check packet memory.
+    buffer = &(endpoint->buffer[endpoint->host_index]);
+    if ((buffer->flags.full) == 0) {
+        data_in->size_bytes = 0;
+        // Isochronous endpoints send an empty packet instead of a handshake.
+        if ((endpoint->physical_endpoint->transfer_type) == USB_ENDPOINT_TRANSFER_TYPE_ISOCHRONOUS) {
+            (*handshake) = USBD_SIM_HANDSHAKE_NONE;
+            goto errors;
+        }
+        endpoint->statistics.nak_count++;
+        goto errors;
+    }
+    // Check reception buffer size.
+    if ((buffer->packet_size_bytes) > (data_in->size_bytes)) {
+        status = USB_ERROR_SIM_PACKET_SIZE;
+        goto errors;
+    }
+    // Copy packet (submitted buffers are read in place like a DMA transfer).
+    packet = ((buffer->flags.lent) != 0) ? (buffer->lent_data) : (buffer->packet);
+    for (idx = 0; idx < (buffer->packet_size_bytes); idx++) {
+        data_in->data[idx] = packet[idx];
+    }
+    data_in->size_bytes = (buffer->packet_size_bytes);
+    endpoint->statistics.bytes_count += (buffer->packet_size_bytes);
+    // Buffer ownership goes back to the device stack before the completion callback.
+    buffer->flags.all = 0;
+    buffer->lent_data = NULL;
+    endpoint->host_index = (((endpoint->host_index) + 1) % (endpoint->number_of_buffers));
+    (*handshake) = ((endpoint->physical_endpoint->transfer_type) == USB_ENDPOINT_TRANSFER_TYPE_ISOCHRONOUS) ? USBD_SIM_HANDSHAKE_NONE : USBD_SIM_HANDSHAKE_ACK;
+    // Notify transfer completion.
+    _USBD_SIM_call_endpoint_callback(endpoint, (data_in->size_bytes), USB_ENDPOINT_TRANSFER_STATUS_OK);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_SIM_out(uint8_t endpoint_number, USB_data_t* data_out, USBD_SIM_handshake_t* handshake) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_endpoint_t* endpoint = NULL;
+    USBD_SIM_buffer_t* buffer = NULL;
+    USB_endpoint_transfer_status_t transfer_status = USB_ENDPOINT_TRANSFER_STATUS_OK;
+    uint32_t max_packet_size_bytes = 0;
+    uint32_t size_bytes = 0;
+    uint32_t idx = 0;
+    // Check parameters.
+    if ((data_out == NULL) || (handshake == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if (((data_out->data) == NULL) && ((data_out->size_bytes) != 0)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    (*handshake) = USBD_SIM_HANDSHAKE_NAK;
+    // Get endpoint.
+    status = _USBD_SIM_get_host_endpoint(endpoint_number, USB_ENDPOINT_DIRECTION_OUT, &endpoint);
+    if (status != USB_SUCCESS) goto errors;
+    // Check packet size (isochronous packets are truncated like a babble on a real peripheral).
+    size_bytes = (data_out->size_bytes);
+    max_packet_size_bytes = USB_ENDPOINT_GET_MAX_PACKET_SIZE(endpoint->physical_endpoint, usbd_sim_ctx.speed);
+    if (size_bytes > max_packet_size_bytes) {
+        if ((endpoint->physical_endpoint->transfer_type) != USB_ENDPOINT_TRANSFER_TYPE_ISOCHRONOUS) {
+            status = USB_ERROR_SIM_PACKET_SIZE;
+            goto errors;
+        }
+        size_bytes = max_packet_size_bytes;
+        transfer_status = USB_ENDPOINT_TRANSFER_STATUS_OVERRUN;
+    }
+    endpoint->statistics.transactions_count++;
+    // Check halt condition.
+    if ((endpoint->flags.stall) != 0) {
+        endpoint->statistics.stall_count++;
+        (*handshake) = USBD_SIM_HANDSHAKE_STALL;
+        goto errors;
+    }
+    // Check packet memory (isochronous packets replace the oldest one unless it is lent to the device stack).
+    buffer = &(endpoint->buffer[endpoint->host_index]);
+    if (((buffer->flags.full) != 0) || ((buffer->flags.lent) != 0)) {
+        if ((endpoint->physical_endpoint->transfer_type) != USB_ENDPOINT_TRANSFER_TYPE_ISOCHRONOUS) {
+            endpoint->statistics.nak_count++;
+            goto errors;
+        }
+        if ((buffer->flags.lent) != 0) {
+            (*handshake) = USBD_SIM_HANDSHAKE_NONE;
+            goto errors;
+        }
+        // All buffers are full: the host slot is the oldest packet, drop it so that the device keeps reading in order.
+        buffer->flags.full = 0;
+        endpoint->device_index = (((endpoint->device_index) + 1) % (endpoint->number_of_buffers));
+    }
+    // Fill packet memory.
+    for (idx = 0; idx < size_bytes; idx++) {
+        buffer->packet[idx] = data_out->data[idx];
+    }
+    buffer->packet_size_bytes = size_bytes;
+    buffer->flags.full = 1;
+    endpoint->host_index = (((endpoint->host_index) + 1) % (endpoint->number_of_buffers));
+    endpoint->statistics.bytes_count += size_bytes;
+    (*handshake) = ((endpoint->physical_endpoint->transfer_type) == USB_ENDPOINT_TRANSFER_TYPE_ISOCHRONOUS) ? USBD_SIM_HANDSHAKE_NONE : USBD_SIM_HANDSHAKE_ACK;
+    // Notify transfer completion.
+    _USBD_SIM_call_endpoint_callback(endpoint, size_bytes, transfer_status);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_SIM_control_transfer(USB_request_t* request, USB_data_t* data) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_request_operation_t request_operation = USB_REQUEST_OPERATION_NOT_SUPPORTED;
+    USBD_SIM_endpoint_t* ep0_in = NULL;
+    USB_data_t packet;
+    uint32_t packet_size_max = 0;
+    uint32_t transferred_size_bytes = 0;
+    // Check parameters.
+    if ((request == NULL) || (data == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if (((request->wLength) != 0) && (((data->data) == NULL) || ((data->size_bytes) < (request->wLength)))) {
+        status = USB_ERROR_REQUEST_SIZE;
+        goto errors;
+    }
+    // Setup stage.
+    status = USBD_SIM_setup(request, &request_operation);
+    if (status != USB_SUCCESS) goto errors;
+    if (request_operation == USB_REQUEST_OPERATION_NOT_SUPPORTED) {
+        status = USB_ERROR_SIM_STALL;
+        goto errors;
+    }
+    status = _USBD_SIM_get_host_endpoint(0, USB_ENDPOINT_DIRECTION_IN, &ep0_in);
+    if (status != USB_SUCCESS) goto errors;
+    packet_size_max = USB_ENDPOINT_GET_MAX_PACKET_SIZE(ep0_in->physical_endpoint, usbd_sim_ctx.speed);
+    // Data stage.
+    if ((request->bmRequestType.direction) == USB_REQUEST_DIRECTION_DEVICE_TO_HOST) {
+        // Read packets until all bytes or a short packet are received.
+        while (transferred_size_bytes < (request->wLength)) {
+            packet.data = &(data->data[transferred_size_bytes]);
+            packet.size_bytes = ((request->wLength) - transferred_size_bytes);
+            status = _USBD_SIM_wait_in(0, &packet);
+            if (status != USB_SUCCESS) goto errors;
+            transferred_size_bytes += packet.size_bytes;
+            if ((packet.size_bytes) < packet_size_max) break;
+        }
+        // Status stage.
+        packet.data = NULL;
+        packet.size_bytes = 0;
+        status = _USBD_SIM_wait_out(0, &packet);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    else {
+        // Send packets.
+        while (transferred_size_bytes < (request->wLength)) {
+            packet.data = &(data->data[transferred_size_bytes]);
+            packet.size_bytes = ((request->wLength) - transferred_size_bytes);
+            if ((packet.size_bytes) > packet_size_max) {
+                packet.size_bytes = packet_size_max;
+            }
+            status = _USBD_SIM_wait_out(0, &packet);
+            if (status != USB_SUCCESS) goto errors;
+            transferred_size_bytes += packet.size_bytes;
+        }
+        // Status stage.
+        packet.data = NULL;
+        packet.size_bytes = 0;
+        status = _USBD_SIM_wait_in(0, &packet);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    // Update output size.
+    data->size_bytes = transferred_size_bytes;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_SIM_enumerate(uint8_t device_address, USB_data_t* configuration_descriptor) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_request_t request;
+    USB_data_t data;
+    uint8_t device_descriptor[sizeof(USB_device_descriptor_t)];
+    uint16_t total_length = 0;
+    // Check parameter.
+    if ((configuration_descriptor == NULL) || ((configuration_descriptor->data) == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if ((configuration_descriptor->size_bytes) < sizeof(USB_configuration_descriptor_t)) {
+        status = USB_ERROR_CONFIGURATION_DESCRIPTOR_SIZE;
+        goto errors;
+    }
+    // Device descriptor.
+    request.bmRequestType.value = 0x80;
+    request.bRequest = USB_REQUEST_GET_DESCRIPTOR;
+    request.wValue = (uint16_t) (USB_DESCRIPTOR_TYPE_DEVICE << 8);
+    request.wIndex = 0;
+    request.wLength = sizeof(USB_device_descriptor_t);
+    data.data = device_descriptor;
+    data.size_bytes = sizeof(USB_device_descriptor_t);
+    status = USBD_SIM_control_transfer(&request, &data);
+    if (status != USB_SUCCESS) goto errors;
+    // Address.
+    request.bmRequestType.value = 0x00;
+    request.bRequest = USB_REQUEST_SET_ADDRESS;
+    request.wValue = device_address;
+    request.wLength = 0;
+    data.data = NULL;
+    data.size_bytes = 0;
+    status = USBD_SIM_control_transfer(&request, &data);
+    if (status != USB_SUCCESS) goto errors;
+    // Configuration descriptor header.
+    request.bmRequestType.value = 0x80;
+    request.bRequest = USB_REQUEST_GET_DESCRIPTOR;
+    request.wValue = (uint16_t) (USB_DESCRIPTOR_TYPE_CONFIGURATION << 8);
+    request.wLength = sizeof(USB_configuration_descriptor_t);
+    data.data = (configuration_descriptor->data);
+    data.size_bytes = sizeof(USB_configuration_descriptor_t);
+    status = USBD_SIM_control_transfer(&request, &data);
+    if (status != USB_SUCCESS) goto errors;
+    // Full configuration descriptor.
+    total_length = (uint16_t) ((configuration_descriptor->data[USBD_SIM_DESCRIPTOR_TOTAL_LENGTH_INDEX]) | (configuration_descriptor->data[USBD_SIM_DESCRIPTOR_TOTAL_LENGTH_INDEX + 1] << 8));
+    if (total_length > (configuration_descriptor->size_bytes)) {
+        status = USB_ERROR_CONFIGURATION_DESCRIPTOR_SIZE;
+        goto errors;
+    }
+    request.wLength = total_length;
+    data.size_bytes = (configuration_descriptor->size_bytes);
+    status = USBD_SIM_control_transfer(&request, &data);
+    if (status != USB_SUCCESS) goto errors;
+    configuration_descriptor->size_bytes = data.size_bytes;
+    // Select first configuration.
+    request.bmRequestType.value = 0x00;
+    request.bRequest = USB_REQUEST_SET_CONFIGURATION;
+    request.wValue = ((USB_configuration_descriptor_t*) (configuration_descriptor->data))->bConfigurationValue;
+    request.wLength = 0;
+    data.data = NULL;
+    data.size_bytes = 0;
+    status = USBD_SIM_control_transfer(&request, &data);
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_SIM_bus_event(USB_bus_event_t bus_event) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (bus_event >= USB_BUS_EVENT_LAST) {
+        status = USB_ERROR_BUS_EVENT;
+        goto errors;
+    }
+    // Check state.
+    if (usbd_sim_ctx.flags.started == 0) {
+        status = USB_ERROR_SIM_DETACHED;
+        goto errors;
+    }
+    // Update controller state before reporting the event.
+    switch (bus_event) {
+    case USB_BUS_EVENT_RESET:
+        usbd_sim_ctx.device_address = 0;
+        usbd_sim_ctx.flags.suspended = 0;
+        _USBD_SIM_flush_endpoints();
+        break;
+    case USB_BUS_EVENT_SUSPEND:
+        usbd_sim_ctx.flags.suspended = 1;
+        break;
+    default:
+        usbd_sim_ctx.flags.suspended = 0;
+        break;
+    }
+    // Call device stack.
+    if (usbd_sim_ctx.bus_event_callback != NULL) {
+#ifdef USBD_EVENT_QUEUE
+        USBD_EVENT_push_bus_event(usbd_sim_ctx.bus_event_callback, bus_event);
+        USBD_process();
+#else
+        usbd_sim_ctx.bus_event_callback(bus_event);
+#endif
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_SIM_sof(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check state.
+    if (usbd_sim_ctx.flags.started == 0) {
+        status = USB_ERROR_SIM_DETACHED;
+        goto errors;
+    }
+    if (usbd_sim_ctx.flags.suspended != 0) {
+        status = USB_ERROR_SIM_SUSPENDED;
+        goto errors;
+    }
+    _USBD_SIM_sof();
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_SIM_set_speed(USB_speed_t speed) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (speed >= USB_SPEED_LAST) {
+        status = USB_ERROR_SIM_SPEED;
+        goto errors;
+    }
+    // Port speed is kept across controller resets.
+    usbd_sim_ctx.speed = speed;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_SIM_get_address(uint8_t* device_address) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (device_address == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    (*device_address) = usbd_sim_ctx.device_address;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_SIM_get_statistics(uint8_t endpoint_number, USB_endpoint_direction_t endpoint_direction, USBD_SIM_statistics_t* statistics) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameters.
+    if (statistics == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if (endpoint_number >= USBD_SIM_NUMBER_OF_ENDPOINTS) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    if (endpoint_direction >= USB_ENDPOINT_DIRECTION_LAST) {
+        status = USB_ERROR_ENDPOINT_DIRECTION;
+        goto errors;
+    }
+    (*statistics) = usbd_sim_ctx.endpoint[endpoint_number][endpoint_direction].statistics;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+void USBD_SIM_reset_statistics(void) {
+    // Local variables.
+    uint8_t number = 0;
+    uint8_t direction = 0;
+    // Endpoints loop.
+    for (number = 0; number < USBD_SIM_NUMBER_OF_ENDPOINTS; number++) {
+        for (direction = 0; direction < USB_ENDPOINT_DIRECTION_LAST; direction++) {
+            usbd_sim_ctx.endpoint[number][direction].statistics.transactions_count = 0;
+            usbd_sim_ctx.endpoint[number][direction].statistics.bytes_count = 0;
+            usbd_sim_ctx.endpoint[number][direction].statistics.nak_count = 0;
+            usbd_sim_ctx.endpoint[number][direction].statistics.stall_count = 0;
+            usbd_sim_ctx.endpoint[number][direction].statistics.device_time_ns = 0;
+        }
+    }
+}
+
+#endif /* USB_LIB_DISABLE */
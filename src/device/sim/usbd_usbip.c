@@ -0,0 +1,924 @@
+/*
+ * usbd_usbip.c
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#include "device/sim/usbd_usbip.h"
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_configuration.h"
+#include "common/usb_descriptor.h"
+#include "common/usb_device.h"
+#include "common/usb_endpoint.h"
+#include "common/usb_interface.h"
+#include "common/usb_request.h"
+#include "common/usb_types.h"
+#include "device/sim/usbd_sim.h"
+#include "device/usbd_hw.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_SIM) && (defined USBD_USBIP))
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*** USBD USBIP local macros ***/
+
+#define USBD_USBIP_VERSION                      0x0111
+
+#define USBD_USBIP_OP_REQ_DEVLIST               0x8005
+#define USBD_USBIP_OP_REP_DEVLIST               0x0005
+#define USBD_USBIP_OP_REQ_IMPORT                0x8003
+#define USBD_USBIP_OP_REP_IMPORT                0x0003
+
+#define USBD_USBIP_CMD_SUBMIT                   0x00000001
+#define USBD_USBIP_CMD_UNLINK                   0x00000002
+#define USBD_USBIP_RET_SUBMIT                   0x00000003
+#define USBD_USBIP_RET_UNLINK                   0x00000004
+
+#define USBD_USBIP_DIRECTION_IN                 1
+
+#define USBD_USBIP_URB_ZERO_PACKET              0x00000040
+
+#define USBD_USBIP_PATH_SIZE_BYTES              256
+#define USBD_USBIP_BUSID_SIZE_BYTES             32
+#define USBD_USBIP_BUSID                        "1-1"
+#define USBD_USBIP_PATH                         "/sys/devices/platform/usbd_sim/usb1/1-1"
+#define USBD_USBIP_BUSNUM                       1
+#define USBD_USBIP_DEVNUM                       1
+
+#define USBD_USBIP_NUMBER_OF_ENDPOINTS          16
+#define USBD_USBIP_INTERFACES_MAX               32
+#define USBD_USBIP_ISO_PACKETS_MAX              64
+#define USBD_USBIP_NUMBER_OF_PACKETS_NONE       0xFFFFFFFF
+
+#define USBD_USBIP_SOCKET_NONE                  (-1)
+
+// Hub class request forwarded by the client to reset the device.
+#define USBD_USBIP_PORT_RESET_REQUEST_TYPE      0x23
+#define USBD_USBIP_PORT_RESET_REQUEST           0x03
+#define USBD_USBIP_PORT_RESET_FEATURE           0x0004
+
+/*** USBD USBIP local structures ***/
+
+/*******************************************************************/
+typedef struct {
+    uint16_t version;
+    uint16_t code;
+    uint32_t status;
+} __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed)) USBD_USBIP_op_header_t;
+
+/*******************************************************************/
+typedef struct {
+    char path[USBD_USBIP_PATH_SIZE_BYTES];
+    char busid[USBD_USBIP_BUSID_SIZE_BYTES];
+    uint32_t busnum;
+    uint32_t devnum;
+    uint32_t speed;
+    uint16_t idVendor;
+    uint16_t idProduct;
+    uint16_t bcdDevice;
+    uint8_t bDeviceClass;
+    uint8_t bDeviceSubClass;
+    uint8_t bDeviceProtocol;
+    uint8_t bConfigurationValue;
+    uint8_t bNumConfigurations;
+    uint8_t bNumInterfaces;
+} __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed)) USBD_USBIP_device_t;
+
+/*******************************************************************/
+typedef struct {
+    uint8_t bInterfaceClass;
+    uint8_t bInterfaceSubClass;
+    uint8_t bInterfaceProtocol;
+    uint8_t padding;
+} __attribute__((packed)) USBD_USBIP_interface_t;
+
+/*******************************************************************/
+typedef struct {
+    uint32_t command;
+    uint32_t seqnum;
+    uint32_t devid;
+    uint32_t direction;
+    uint32_t ep;
+} __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed)) USBD_USBIP_header_t;
+
+/*******************************************************************/
+typedef struct {
+    uint32_t transfer_flags;
+    uint32_t transfer_buffer_length;
+    uint32_t start_frame;
+    uint32_t number_of_packets;
+    uint32_t interval;
+    uint8_t setup[USB_SETUP_PACKET_SIZE_BYTES];
+} __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed)) USBD_USBIP_cmd_submit_t;
+
+/*******************************************************************/
+typedef struct {
+    uint32_t unlink_seqnum;
+    uint8_t padding[24];
+} __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed)) USBD_USBIP_cmd_unlink_t;
+
+/*******************************************************************/
+typedef struct {
+    USBD_USBIP_header_t header;
+    uint32_t status;
+    uint32_t actual_length;
+    uint32_t start_frame;
+    uint32_t number_of_packets;
+    uint32_t error_count;
+    uint8_t padding[USB_SETUP_PACKET_SIZE_BYTES];
+} __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed)) USBD_USBIP_ret_submit_t;
+
+/*******************************************************************/
+typedef struct {
+    USBD_USBIP_header_t header;
+    uint32_t status;
+    uint8_t padding[24];
+} __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed)) USBD_USBIP_ret_unlink_t;
+
+/*******************************************************************/
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t actual_length;
+    uint32_t status;
+} __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed)) USBD_USBIP_iso_packet_t;
+
+/*******************************************************************/
+typedef struct {
+    uint32_t seqnum;
+    uint32_t transfer_buffer_length;
+    uint32_t number_of_packets;
+    uint8_t endpoint_number;
+} USBD_USBIP_urb_t;
+
+/*******************************************************************/
+typedef union {
+    uint8_t all;
+    struct {
+        uint8_t init :1;
+        uint8_t imported :1;
+    } __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed));
+} USBD_USBIP_flags_t;
+
+/*******************************************************************/
+typedef struct {
+    USBD_USBIP_flags_t flags;
+    int server_socket;
+    int client_socket;
+    uint16_t max_packet_size[USBD_USBIP_NUMBER_OF_ENDPOINTS][USB_ENDPOINT_DIRECTION_LAST];
+    USBD_USBIP_urb_t urb_queue[USBD_USBIP_URB_QUEUE_SIZE];
+    uint8_t urb_queue_count;
+    USBD_USBIP_iso_packet_t iso_packet[USBD_USBIP_ISO_PACKETS_MAX];
+    uint8_t transfer_buffer[USBD_USBIP_TRANSFER_BUFFER_SIZE_BYTES];
+} USBD_USBIP_context_t;
+
+/*** USBD USBIP local global variables ***/
+
+static USBD_USBIP_context_t usbd_usbip_ctx = {
+    .flags.all = 0,
+    .server_socket = USBD_USBIP_SOCKET_NONE,
+    .client_socket = USBD_USBIP_SOCKET_NONE,
+    .urb_queue_count = 0
+};
+
+/*** USBD USBIP local functions ***/
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_receive(uint8_t* data, uint32_t size_bytes) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    ssize_t received_size = 0;
+    uint32_t offset = 0;
+    // Read until all bytes are received.
+    while (offset < size_bytes) {
+        received_size = recv(usbd_usbip_ctx.client_socket, &(data[offset]), (size_bytes - offset), MSG_WAITALL);
+        if (received_size <= 0) {
+            status = USB_ERROR_USBIP_DISCONNECTED;
+            goto errors;
+        }
+        offset += (uint32_t) received_size;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_send(uint8_t* data, uint32_t size_bytes) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    ssize_t sent_size = 0;
+    uint32_t offset = 0;
+    // Write until all bytes are sent.
+    while (offset < size_bytes) {
+        sent_size = send(usbd_usbip_ctx.client_socket, &(data[offset]), (size_bytes - offset), MSG_NOSIGNAL);
+        if (sent_size <= 0) {
+            status = USB_ERROR_USBIP_DISCONNECTED;
+            goto errors;
+        }
+        offset += (uint32_t) sent_size;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static void _USBD_USBIP_close_client(void) {
+    // Check socket.
+    if (usbd_usbip_ctx.client_socket == USBD_USBIP_SOCKET_NONE) goto errors;
+    close(usbd_usbip_ctx.client_socket);
+    usbd_usbip_ctx.client_socket = USBD_USBIP_SOCKET_NONE;
+    // Device is unplugged from the client: stop class streams.
+    if (usbd_usbip_ctx.flags.imported != 0) {
+        USBD_SIM_bus_event(USB_BUS_EVENT_RESET);
+    }
+    usbd_usbip_ctx.flags.imported = 0;
+    usbd_usbip_ctx.urb_queue_count = 0;
+errors:
+    return;
+}
+
+/*******************************************************************/
+static int32_t _USBD_USBIP_get_urb_status(USB_status_t status, USBD_SIM_handshake_t handshake) {
+    // Local variables.
+    int32_t urb_status = 0;
+    // Convert to Linux URB status.
+    if ((status == USB_ERROR_SIM_STALL) || (handshake == USBD_SIM_HANDSHAKE_STALL)) {
+        urb_status = (-EPIPE);
+    }
+    else if (status == USB_ERROR_SIM_NAK_TIMEOUT) {
+        urb_status = (-ETIMEDOUT);
+    }
+    else if (status != USB_SUCCESS) {
+        urb_status = (-EPROTO);
+    }
+    return urb_status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_read_descriptor(uint8_t descriptor_type, uint16_t length, USB_data_t* descriptor) {
+    // Local variables.
+    USB_request_t request;
+    // Standard request from the virtual host.
+    request.bmRequestType.value = 0x80;
+    request.bRequest = USB_REQUEST_GET_DESCRIPTOR;
+    request.wValue = (uint16_t) (descriptor_type << 8);
+    request.wIndex = 0;
+    request.wLength = length;
+    descriptor->data = usbd_usbip_ctx.transfer_buffer;
+    descriptor->size_bytes = length;
+    return USBD_SIM_control_transfer(&request, descriptor);
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_read_device(USBD_USBIP_device_t* device, USBD_USBIP_interface_t* interface_list, uint8_t* number_of_interfaces) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_device_descriptor_t* device_descriptor_ptr = NULL;
+    USB_configuration_descriptor_t* configuration_descriptor_ptr = NULL;
+    USB_interface_descriptor_t* interface_descriptor_ptr = NULL;
+    USB_endpoint_descriptor_t* endpoint_descriptor_ptr = NULL;
+    USB_speed_t speed = USB_SPEED_FULL;
+    USB_data_t descriptor;
+    uint16_t total_length = 0;
+    uint32_t idx = 0;
+    // Device location.
+    for (idx = 0; idx < USBD_USBIP_PATH_SIZE_BYTES; idx++) {
+        device->path[idx] = 0;
+    }
+    for (idx = 0; idx < USBD_USBIP_BUSID_SIZE_BYTES; idx++) {
+        device->busid[idx] = 0;
+    }
+    for (idx = 0; idx < sizeof(USBD_USBIP_PATH); idx++) {
+        device->path[idx] = USBD_USBIP_PATH[idx];
+    }
+    for (idx = 0; idx < sizeof(USBD_USBIP_BUSID); idx++) {
+        device->busid[idx] = USBD_USBIP_BUSID[idx];
+    }
+    device->busnum = USBD_USBIP_BUSNUM;
+    device->devnum = USBD_USBIP_DEVNUM;
+    // Linux speed codes start at 1 for low speed.
+    status = USBD_HW_get_speed(&speed);
+    if (status != USB_SUCCESS) goto errors;
+    device->speed = ((uint32_t) speed + 1);
+    // Device descriptor (the structures match the wire layout since usbd_sim.c is built with -fshort-enums).
+    status = _USBD_USBIP_read_descriptor(USB_DESCRIPTOR_TYPE_DEVICE, sizeof(USB_device_descriptor_t), &descriptor);
+    if (status != USB_SUCCESS) goto errors;
+    device_descriptor_ptr = (USB_device_descriptor_t*) usbd_usbip_ctx.transfer_buffer;
+    device->idVendor = (device_descriptor_ptr->idVendor);
+    device->idProduct = (device_descriptor_ptr->idProduct);
+    device->bcdDevice = (device_descriptor_ptr->bcdDevice);
+    device->bDeviceClass = (device_descriptor_ptr->bDeviceClass);
+    device->bDeviceSubClass = (device_descriptor_ptr->bDeviceSubClass);
+    device->bDeviceProtocol = (device_descriptor_ptr->bDeviceProtocol);
+    device->bNumConfigurations = (device_descriptor_ptr->bNumConfigurations);
+    device->bConfigurationValue = 0;
+    // Configuration descriptor header.
+    status = _USBD_USBIP_read_descriptor(USB_DESCRIPTOR_TYPE_CONFIGURATION, sizeof(USB_configuration_descriptor_t), &descriptor);
+    if (status != USB_SUCCESS) goto errors;
+    configuration_descriptor_ptr = (USB_configuration_descriptor_t*) usbd_usbip_ctx.transfer_buffer;
+    total_length = (configuration_descriptor_ptr->wTotalLength);
+    if (total_length > USBD_USBIP_TRANSFER_BUFFER_SIZE_BYTES) {
+        status = USB_ERROR_CONFIGURATION_DESCRIPTOR_SIZE;
+        goto errors;
+    }
+    // Full configuration descriptor.
+    status = _USBD_USBIP_read_descriptor(USB_DESCRIPTOR_TYPE_CONFIGURATION, total_length, &descriptor);
+    if (status != USB_SUCCESS) goto errors;
+    // Parse interfaces and endpoints like the host does.
+    for (idx = 0; idx < USBD_USBIP_NUMBER_OF_ENDPOINTS; idx++) {
+        usbd_usbip_ctx.max_packet_size[idx][USB_ENDPOINT_DIRECTION_OUT] = 0;
+        usbd_usbip_ctx.max_packet_size[idx][USB_ENDPOINT_DIRECTION_IN] = 0;
+    }
+    (*number_of_interfaces) = 0;
+    idx = 0;
+    while ((idx + 1) < (descriptor.size_bytes)) {
+        // Check descriptor length.
+        if (usbd_usbip_ctx.transfer_buffer[idx] == 0) {
+            status = USB_ERROR_CONFIGURATION_DESCRIPTOR_SIZE;
+            goto errors;
+        }
+        if (usbd_usbip_ctx.transfer_buffer[idx + 1] == USB_DESCRIPTOR_TYPE_INTERFACE) {
+            interface_descriptor_ptr = (USB_interface_descriptor_t*) &(usbd_usbip_ctx.transfer_buffer[idx]);
+            if (((interface_descriptor_ptr->bAlternateSetting) == 0) && ((*number_of_interfaces) < USBD_USBIP_INTERFACES_MAX)) {
+                interface_list[*number_of_interfaces].bInterfaceClass = (interface_descriptor_ptr->bInterfaceClass);
+                interface_list[*number_of_interfaces].bInterfaceSubClass = (interface_descriptor_ptr->bInterfaceSubClass);
+                interface_list[*number_of_interfaces].bInterfaceProtocol = (interface_descriptor_ptr->bInterfaceProtocol);
+                interface_list[*number_of_interfaces].padding = 0;
+                (*number_of_interfaces)++;
+            }
+        }
+        if (usbd_usbip_ctx.transfer_buffer[idx + 1] == USB_DESCRIPTOR_TYPE_ENDPOINT) {
+            endpoint_descriptor_ptr = (USB_endpoint_descriptor_t*) &(usbd_usbip_ctx.transfer_buffer[idx]);
+            usbd_usbip_ctx.max_packet_size[endpoint_descriptor_ptr->bEndpointAddress.number][endpoint_descriptor_ptr->bEndpointAddress.direction] = (endpoint_descriptor_ptr->wMaxPacketSize.max_packet_size);
+        }
+        idx += usbd_usbip_ctx.transfer_buffer[idx];
+    }
+    device->bNumInterfaces = (*number_of_interfaces);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_process_operation(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_USBIP_op_header_t op_header;
+    USBD_USBIP_device_t device;
+    USBD_USBIP_interface_t interface_list[USBD_USBIP_INTERFACES_MAX];
+    uint8_t number_of_interfaces = 0;
+    char busid[USBD_USBIP_BUSID_SIZE_BYTES];
+    uint32_t number_of_devices = 0;
+    uint32_t idx = 0;
+    // Read request.
+    status = _USBD_USBIP_receive((uint8_t*) &op_header, sizeof(USBD_USBIP_op_header_t));
+    if (status != USB_SUCCESS) goto errors;
+    switch (op_header.code) {
+    case USBD_USBIP_OP_REQ_DEVLIST:
+        status = _USBD_USBIP_read_device(&device, interface_list, &number_of_interfaces);
+        if (status != USB_SUCCESS) goto errors;
+        // Reply with the single exported device.
+        op_header.version = USBD_USBIP_VERSION;
+        op_header.code = USBD_USBIP_OP_REP_DEVLIST;
+        op_header.status = 0;
+        number_of_devices = htonl(1);
+        status = _USBD_USBIP_send((uint8_t*) &op_header, sizeof(USBD_USBIP_op_header_t));
+        if (status != USB_SUCCESS) goto errors;
+        status = _USBD_USBIP_send((uint8_t*) &number_of_devices, sizeof(uint32_t));
+        if (status != USB_SUCCESS) goto errors;
+        status = _USBD_USBIP_send((uint8_t*) &device, sizeof(USBD_USBIP_device_t));
+        if (status != USB_SUCCESS) goto errors;
+        status = _USBD_USBIP_send((uint8_t*) interface_list, (number_of_interfaces * sizeof(USBD_USBIP_interface_t)));
+        if (status != USB_SUCCESS) goto errors;
+        // Client closes the connection after the list.
+        _USBD_USBIP_close_client();
+        break;
+    case USBD_USBIP_OP_REQ_IMPORT:
+        status = _USBD_USBIP_receive((uint8_t*) busid, USBD_USBIP_BUSID_SIZE_BYTES);
+        if (status != USB_SUCCESS) goto errors;
+        // Plug the device in the client port.
+        status = USBD_SIM_bus_event(USB_BUS_EVENT_RESET);
+        if (status != USB_SUCCESS) goto errors;
+        status = _USBD_USBIP_read_device(&device, interface_list, &number_of_interfaces);
+        if (status != USB_SUCCESS) goto errors;
+        // Check bus identifier.
+        op_header.version = USBD_USBIP_VERSION;
+        op_header.code = USBD_USBIP_OP_REP_IMPORT;
+        op_header.status = 0;
+        for (idx = 0; idx < sizeof(USBD_USBIP_BUSID); idx++) {
+            if (busid[idx] != USBD_USBIP_BUSID[idx]) {
+                op_header.status = 1;
+                break;
+            }
+        }
+        status = _USBD_USBIP_send((uint8_t*) &op_header, sizeof(USBD_USBIP_op_header_t));
+        if (status != USB_SUCCESS) goto errors;
+        if (op_header.status != 0) {
+            _USBD_USBIP_close_client();
+            break;
+        }
+        status = _USBD_USBIP_send((uint8_t*) &device, sizeof(USBD_USBIP_device_t));
+        if (status != USB_SUCCESS) goto errors;
+        // Connection now carries URBs.
+        usbd_usbip_ctx.flags.imported = 1;
+        usbd_usbip_ctx.urb_queue_count = 0;
+        break;
+    default:
+        status = USB_ERROR_USBIP_PROTOCOL;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_send_ret_submit(uint32_t seqnum, int32_t urb_status, uint32_t actual_length, uint32_t number_of_packets, uint8_t* data) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_USBIP_ret_submit_t ret_submit;
+    uint32_t idx = 0;
+    // Build header.
+    ret_submit.header.command = USBD_USBIP_RET_SUBMIT;
+    ret_submit.header.seqnum = seqnum;
+    ret_submit.header.devid = 0;
+    ret_submit.header.direction = 0;
+    ret_submit.header.ep = 0;
+    ret_submit.status = (uint32_t) urb_status;
+    ret_submit.actual_length = actual_length;
+    ret_submit.start_frame = 0;
+    ret_submit.number_of_packets = number_of_packets;
+    ret_submit.error_count = 0;
+    for (idx = 0; idx < USB_SETUP_PACKET_SIZE_BYTES; idx++) {
+        ret_submit.padding[idx] = 0;
+    }
+    status = _USBD_USBIP_send((uint8_t*) &ret_submit, sizeof(USBD_USBIP_ret_submit_t));
+    if (status != USB_SUCCESS) goto errors;
+    // IN data.
+    if (data != NULL) {
+        status = _USBD_USBIP_send(data, actual_length);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    // Isochronous packets status.
+    if ((number_of_packets != 0) && (number_of_packets != USBD_USBIP_NUMBER_OF_PACKETS_NONE)) {
+        status = _USBD_USBIP_send((uint8_t*) usbd_usbip_ctx.iso_packet, (number_of_packets * sizeof(USBD_USBIP_iso_packet_t)));
+        if (status != USB_SUCCESS) goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_control_transfer(USBD_USBIP_header_t* header, USBD_USBIP_cmd_submit_t* cmd_submit) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_request_t request;
+    USB_data_t data;
+    int32_t urb_status = 0;
+    uint32_t idx = 0;
+    // Decode setup packet.
+    for (idx = 0; idx < USB_SETUP_PACKET_SIZE_BYTES; idx++) {
+        ((uint8_t*) &request)[idx] = cmd_submit->setup[idx];
+    }
+    data.data = usbd_usbip_ctx.transfer_buffer;
+    data.size_bytes = (cmd_submit->transfer_buffer_length);
+    // Port reset is performed by the controller.
+    if (((request.bmRequestType.value) == USBD_USBIP_PORT_RESET_REQUEST_TYPE) && ((request.bRequest) == USBD_USBIP_PORT_RESET_REQUEST) && ((request.wValue) == USBD_USBIP_PORT_RESET_FEATURE)) {
+        status = USBD_SIM_bus_event(USB_BUS_EVENT_RESET);
+        data.size_bytes = 0;
+    }
+    else {
+        status = USBD_SIM_control_transfer(&request, &data);
+    }
+    urb_status = _USBD_USBIP_get_urb_status(status, USBD_SIM_HANDSHAKE_ACK);
+    if (urb_status != 0) {
+        data.size_bytes = 0;
+    }
+    // Send completion.
+    status = _USBD_USBIP_send_ret_submit((header->seqnum), urb_status, data.size_bytes, (cmd_submit->number_of_packets), (((header->direction) == USBD_USBIP_DIRECTION_IN) ? usbd_usbip_ctx.transfer_buffer : NULL));
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_isochronous_transfer(USBD_USBIP_header_t* header, USBD_USBIP_cmd_submit_t* cmd_submit) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_handshake_t handshake = USBD_SIM_HANDSHAKE_NONE;
+    USB_data_t packet;
+    int32_t urb_status = 0;
+    uint32_t actual_length = 0;
+    uint32_t idx = 0;
+    // Read packets descriptors.
+    status = _USBD_USBIP_receive((uint8_t*) usbd_usbip_ctx.iso_packet, ((cmd_submit->number_of_packets) * sizeof(USBD_USBIP_iso_packet_t)));
+    if (status != USB_SUCCESS) goto errors;
+    // One packet per (micro)frame.
+    for (idx = 0; idx < (cmd_submit->number_of_packets); idx++) {
+        // Check packet location (without overflow on the client values).
+        if (((usbd_usbip_ctx.iso_packet[idx].length) > (cmd_submit->transfer_buffer_length)) || ((usbd_usbip_ctx.iso_packet[idx].offset) > ((cmd_submit->transfer_buffer_length) - (usbd_usbip_ctx.iso_packet[idx].length)))) {
+            status = USB_ERROR_USBIP_PROTOCOL;
+            goto errors;
+        }
+        // IN packets are packed so they must also fit after the previous ones.
+        if (((header->direction) == USBD_USBIP_DIRECTION_IN) && ((usbd_usbip_ctx.iso_packet[idx].length) > ((cmd_submit->transfer_buffer_length) - actual_length))) {
+            status = USB_ERROR_USBIP_PROTOCOL;
+            goto errors;
+        }
+        if ((header->direction) == USBD_USBIP_DIRECTION_IN) {
+            // IN packets are sent back without gaps.
+            packet.data = &(usbd_usbip_ctx.transfer_buffer[actual_length]);
+            packet.size_bytes = (usbd_usbip_ctx.iso_packet[idx].length);
+            status = USBD_SIM_in((uint8_t) (header->ep), &packet, &handshake);
+        }
+        else {
+            packet.data = &(usbd_usbip_ctx.transfer_buffer[usbd_usbip_ctx.iso_packet[idx].offset]);
+            packet.size_bytes = (usbd_usbip_ctx.iso_packet[idx].length);
+            status = USBD_SIM_out((uint8_t) (header->ep), &packet, &handshake);
+        }
+        urb_status = _USBD_USBIP_get_urb_status(status, handshake);
+        usbd_usbip_ctx.iso_packet[idx].status = (uint32_t) urb_status;
+        usbd_usbip_ctx.iso_packet[idx].actual_length = (urb_status == 0) ? packet.size_bytes : 0;
+        actual_length += (usbd_usbip_ctx.iso_packet[idx].actual_length);
+    }
+    // Send completion.
+    status = _USBD_USBIP_send_ret_submit((header->seqnum), 0, actual_length, (cmd_submit->number_of_packets), (((header->direction) == USBD_USBIP_DIRECTION_IN) ? usbd_usbip_ctx.transfer_buffer : NULL));
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_bulk_out_transfer(USBD_USBIP_header_t* header, USBD_USBIP_cmd_submit_t* cmd_submit) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_handshake_t handshake = USBD_SIM_HANDSHAKE_NAK;
+    USB_data_t packet;
+    uint32_t packet_size_max = usbd_usbip_ctx.max_packet_size[header->ep][USB_ENDPOINT_DIRECTION_OUT];
+    uint32_t actual_length = 0;
+    uint32_t retry_count = 0;
+    uint8_t zlp_required = 0;
+    // Check endpoint.
+    if (packet_size_max == 0) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+    }
+    else {
+        // A transfer ending on a full packet is terminated by a zero length packet if requested by the client.
+        zlp_required = (((cmd_submit->transfer_flags) & USBD_USBIP_URB_ZERO_PACKET) != 0) && ((cmd_submit->transfer_buffer_length) != 0) && (((cmd_submit->transfer_buffer_length) % packet_size_max) == 0);
+    }
+    // Send packets (a zero length transfer is a single empty packet).
+    while (status == USB_SUCCESS) {
+        packet.data = &(usbd_usbip_ctx.transfer_buffer[actual_length]);
+        packet.size_bytes = ((cmd_submit->transfer_buffer_length) - actual_length);
+        if ((packet.size_bytes) > packet_size_max) {
+            packet.size_bytes = packet_size_max;
+        }
+        status = USBD_SIM_out((uint8_t) (header->ep), &packet, &handshake);
+        if ((status != USB_SUCCESS) || (handshake == USBD_SIM_HANDSHAKE_STALL)) break;
+        if (handshake == USBD_SIM_HANDSHAKE_NAK) {
+            // Retry while the device answers NAK.
+            retry_count++;
+            if (retry_count > USBD_SIM_NAK_RETRY_MAX) {
+                status = USB_ERROR_SIM_NAK_TIMEOUT;
+            }
+        }
+        else {
+            retry_count = 0;
+            actual_length += packet.size_bytes;
+            if ((actual_length >= (cmd_submit->transfer_buffer_length)) && ((zlp_required == 0) || ((packet.size_bytes) == 0))) break;
+        }
+    }
+    // Send completion.
+    status = _USBD_USBIP_send_ret_submit((header->seqnum), _USBD_USBIP_get_urb_status(status, handshake), actual_length, (cmd_submit->number_of_packets), NULL);
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_poll_urb(USBD_USBIP_urb_t* urb, uint8_t* urb_completed) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_SIM_handshake_t handshake = USBD_SIM_HANDSHAKE_NAK;
+    USB_data_t packet;
+    uint32_t packet_size_max = usbd_usbip_ctx.max_packet_size[urb->endpoint_number][USB_ENDPOINT_DIRECTION_IN];
+    uint32_t actual_length = 0;
+    (*urb_completed) = 0;
+    // Read packets until a short packet, a full buffer or a NAK.
+    while (actual_length < (urb->transfer_buffer_length)) {
+        packet.data = &(usbd_usbip_ctx.transfer_buffer[actual_length]);
+        packet.size_bytes = ((urb->transfer_buffer_length) - actual_length);
+        status = USBD_SIM_in((urb->endpoint_number), &packet, &handshake);
+        if ((status != USB_SUCCESS) || (handshake != USBD_SIM_HANDSHAKE_ACK)) break;
+        actual_length += packet.size_bytes;
+        if ((packet.size_bytes) < packet_size_max) break;
+    }
+    // Keep the transfer queued until the device sends data.
+    if ((status == USB_SUCCESS) && (handshake == USBD_SIM_HANDSHAKE_NAK) && (actual_length == 0)) goto errors;
+    (*urb_completed) = 1;
+    status = _USBD_USBIP_send_ret_submit((urb->seqnum), _USBD_USBIP_get_urb_status(status, handshake), actual_length, (urb->number_of_packets), usbd_usbip_ctx.transfer_buffer);
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static void _USBD_USBIP_remove_urb(uint8_t urb_index) {
+    // Local variables.
+    uint8_t idx = 0;
+    // Keep submission order.
+    for (idx = urb_index; (idx + 1) < usbd_usbip_ctx.urb_queue_count; idx++) {
+        usbd_usbip_ctx.urb_queue[idx] = usbd_usbip_ctx.urb_queue[idx + 1];
+    }
+    usbd_usbip_ctx.urb_queue_count--;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_poll_urb_queue(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint16_t nak_mask = 0;
+    uint8_t urb_completed = 0;
+    uint8_t idx = 0;
+    // URBs of an endpoint are completed in submission order.
+    while (idx < usbd_usbip_ctx.urb_queue_count) {
+        if ((nak_mask & (1 << usbd_usbip_ctx.urb_queue[idx].endpoint_number)) != 0) {
+            idx++;
+            continue;
+        }
+        status = _USBD_USBIP_poll_urb(&(usbd_usbip_ctx.urb_queue[idx]), &urb_completed);
+        if (status != USB_SUCCESS) goto errors;
+        if (urb_completed != 0) {
+            _USBD_USBIP_remove_urb(idx);
+        }
+        else {
+            nak_mask |= (uint16_t) (1 << usbd_usbip_ctx.urb_queue[idx].endpoint_number);
+            idx++;
+        }
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_discard(uint32_t size_bytes) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint32_t chunk_size_bytes = 0;
+    // Flush unexpected data.
+    while (size_bytes > 0) {
+        chunk_size_bytes = (size_bytes > USBD_USBIP_TRANSFER_BUFFER_SIZE_BYTES) ? USBD_USBIP_TRANSFER_BUFFER_SIZE_BYTES : size_bytes;
+        status = _USBD_USBIP_receive(usbd_usbip_ctx.transfer_buffer, chunk_size_bytes);
+        if (status != USB_SUCCESS) goto errors;
+        size_bytes -= chunk_size_bytes;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_submit(USBD_USBIP_header_t* header) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_USBIP_cmd_submit_t cmd_submit;
+    USBD_USBIP_urb_t* urb_ptr = NULL;
+    uint8_t iso = 0;
+    // Read command.
+    status = _USBD_USBIP_receive((uint8_t*) &cmd_submit, sizeof(USBD_USBIP_cmd_submit_t));
+    if (status != USB_SUCCESS) goto errors;
+    iso = (((cmd_submit.number_of_packets) != 0) && ((cmd_submit.number_of_packets) != USBD_USBIP_NUMBER_OF_PACKETS_NONE)) ? 1 : 0;
+    // Check parameters.
+    if (((header->ep) >= USBD_USBIP_NUMBER_OF_ENDPOINTS) || ((iso != 0) && ((cmd_submit.number_of_packets) > USBD_USBIP_ISO_PACKETS_MAX))) {
+        status = USB_ERROR_USBIP_PROTOCOL;
+        goto errors;
+    }
+    if ((cmd_submit.transfer_buffer_length) > USBD_USBIP_TRANSFER_BUFFER_SIZE_BYTES) {
+        // OUT data is still on the socket.
+        if ((header->direction) != USBD_USBIP_DIRECTION_IN) {
+            status = _USBD_USBIP_discard(cmd_submit.transfer_buffer_length);
+            if (status != USB_SUCCESS) goto errors;
+        }
+        if (iso != 0) {
+            status = _USBD_USBIP_discard((cmd_submit.number_of_packets) * sizeof(USBD_USBIP_iso_packet_t));
+            if (status != USB_SUCCESS) goto errors;
+        }
+        status = _USBD_USBIP_send_ret_submit((header->seqnum), (-ENOMEM), 0, 0, NULL);
+        goto errors;
+    }
+    // OUT data.
+    if ((header->direction) != USBD_USBIP_DIRECTION_IN) {
+        status = _USBD_USBIP_receive(usbd_usbip_ctx.transfer_buffer, cmd_submit.transfer_buffer_length);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    // Select transfer.
+    if ((header->ep) == 0) {
+        status = _USBD_USBIP_control_transfer(header, &cmd_submit);
+    }
+    else if (iso != 0) {
+        status = _USBD_USBIP_isochronous_transfer(header, &cmd_submit);
+    }
+    else if ((header->direction) != USBD_USBIP_DIRECTION_IN) {
+        status = _USBD_USBIP_bulk_out_transfer(header, &cmd_submit);
+    }
+    else {
+        // Bulk and interrupt IN transfers wait for the device.
+        if (usbd_usbip_ctx.urb_queue_count >= USBD_USBIP_URB_QUEUE_SIZE) {
+            status = _USBD_USBIP_send_ret_submit((header->seqnum), (-ENOMEM), 0, (cmd_submit.number_of_packets), NULL);
+            goto errors;
+        }
+        urb_ptr = &(usbd_usbip_ctx.urb_queue[usbd_usbip_ctx.urb_queue_count]);
+        urb_ptr->seqnum = (header->seqnum);
+        urb_ptr->transfer_buffer_length = (cmd_submit.transfer_buffer_length);
+        urb_ptr->number_of_packets = (cmd_submit.number_of_packets);
+        urb_ptr->endpoint_number = (uint8_t) (header->ep);
+        usbd_usbip_ctx.urb_queue_count++;
+    }
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_unlink(USBD_USBIP_header_t* header) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_USBIP_cmd_unlink_t cmd_unlink;
+    USBD_USBIP_ret_unlink_t ret_unlink;
+    uint8_t idx = 0;
+    // Read command.
+    status = _USBD_USBIP_receive((uint8_t*) &cmd_unlink, sizeof(USBD_USBIP_cmd_unlink_t));
+    if (status != USB_SUCCESS) goto errors;
+    // Build answer (status is 0 when the URB has already been completed).
+    ret_unlink.header.command = USBD_USBIP_RET_UNLINK;
+    ret_unlink.header.seqnum = (header->seqnum);
+    ret_unlink.header.devid = 0;
+    ret_unlink.header.direction = 0;
+    ret_unlink.header.ep = 0;
+    ret_unlink.status = 0;
+    for (idx = 0; idx < sizeof(ret_unlink.padding); idx++) {
+        ret_unlink.padding[idx] = 0;
+    }
+    // Search URB.
+    for (idx = 0; idx < usbd_usbip_ctx.urb_queue_count; idx++) {
+        if (usbd_usbip_ctx.urb_queue[idx].seqnum == (cmd_unlink.unlink_seqnum)) {
+            _USBD_USBIP_remove_urb(idx);
+            ret_unlink.status = (uint32_t) (-ECONNRESET);
+            break;
+        }
+    }
+    status = _USBD_USBIP_send((uint8_t*) &ret_unlink, sizeof(USBD_USBIP_ret_unlink_t));
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_USBIP_process_command(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_USBIP_header_t header;
+    // Read header.
+    status = _USBD_USBIP_receive((uint8_t*) &header, sizeof(USBD_USBIP_header_t));
+    if (status != USB_SUCCESS) goto errors;
+    switch (header.command) {
+    case USBD_USBIP_CMD_SUBMIT:
+        status = _USBD_USBIP_submit(&header);
+        break;
+    case USBD_USBIP_CMD_UNLINK:
+        status = _USBD_USBIP_unlink(&header);
+        break;
+    default:
+        status = USB_ERROR_USBIP_PROTOCOL;
+        break;
+    }
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*** USBD USBIP functions ***/
+
+/*******************************************************************/
+USB_status_t USBD_USBIP_init(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    struct sockaddr_in address;
+    int option = 1;
+    // Check state.
+    if (usbd_usbip_ctx.flags.init != 0) {
+        status = USB_ERROR_ALREADY_INITIALIZED;
+        goto errors;
+    }
+    // Reset context.
+    usbd_usbip_ctx.flags.all = 0;
+    usbd_usbip_ctx.client_socket = USBD_USBIP_SOCKET_NONE;
+    usbd_usbip_ctx.urb_queue_count = 0;
+    // Open server socket on the loopback interface.
+    usbd_usbip_ctx.server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (usbd_usbip_ctx.server_socket < 0) {
+        usbd_usbip_ctx.server_socket = USBD_USBIP_SOCKET_NONE;
+        status = USB_ERROR_USBIP_SOCKET;
+        goto errors;
+    }
+    address.sin_family = AF_INET;
+    address.sin_port = htons(USBD_USBIP_TCP_PORT);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((setsockopt(usbd_usbip_ctx.server_socket, SOL_SOCKET, SO_REUSEADDR, &option, sizeof(option)) < 0) || (bind(usbd_usbip_ctx.server_socket, (struct sockaddr*) &address, sizeof(address)) < 0) || (listen(usbd_usbip_ctx.server_socket, 1) < 0)) {
+        close(usbd_usbip_ctx.server_socket);
+        usbd_usbip_ctx.server_socket = USBD_USBIP_SOCKET_NONE;
+        status = USB_ERROR_USBIP_SOCKET;
+        goto errors;
+    }
+    // Update initialization flag.
+    usbd_usbip_ctx.flags.init = 1;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_USBIP_de_init(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check state.
+    if (usbd_usbip_ctx.flags.init == 0) {
+        status = USB_ERROR_UNINITIALIZED;
+        goto errors;
+    }
+    // Close sockets.
+    _USBD_USBIP_close_client();
+    close(usbd_usbip_ctx.server_socket);
+    usbd_usbip_ctx.server_socket = USBD_USBIP_SOCKET_NONE;
+    // Update initialization flag.
+    usbd_usbip_ctx.flags.init = 0;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_USBIP_process(uint32_t timeout_ms) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    struct pollfd socket_poll;
+    int poll_result = 0;
+    // Check state.
+    if (usbd_usbip_ctx.flags.init == 0) {
+        status = USB_ERROR_UNINITIALIZED;
+        goto errors;
+    }
+    // Do not sleep while IN transfers are waiting for the device.
+    if (usbd_usbip_ctx.urb_queue_count != 0) {
+        timeout_ms = 0;
+    }
+    // Wait for a connection or a request.
+    socket_poll.fd = (usbd_usbip_ctx.client_socket == USBD_USBIP_SOCKET_NONE) ? usbd_usbip_ctx.server_socket : usbd_usbip_ctx.client_socket;
+    socket_poll.events = POLLIN;
+    socket_poll.revents = 0;
+    poll_result = poll(&socket_poll, 1, (int) timeout_ms);
+    if ((poll_result < 0) && (errno != EINTR)) {
+        status = USB_ERROR_USBIP_SOCKET;
+        goto errors;
+    }
+    if ((poll_result > 0) && ((socket_poll.revents & (POLLIN | POLLHUP | POLLERR)) != 0)) {
+        if (usbd_usbip_ctx.client_socket == USBD_USBIP_SOCKET_NONE) {
+            // Single client at a time.
+            usbd_usbip_ctx.client_socket = accept(usbd_usbip_ctx.server_socket, NULL, NULL);
+            if (usbd_usbip_ctx.client_socket < 0) {
+                usbd_usbip_ctx.client_socket = USBD_USBIP_SOCKET_NONE;
+                status = USB_ERROR_USBIP_SOCKET;
+                goto errors;
+            }
+        }
+        else if (usbd_usbip_ctx.flags.imported == 0) {
+            status = _USBD_USBIP_process_operation();
+        }
+        else {
+            status = _USBD_USBIP_process_command();
+        }
+    }
+    // Serve queued IN transfers.
+    if ((status == USB_SUCCESS) && (usbd_usbip_ctx.flags.imported != 0)) {
+        status = _USBD_USBIP_poll_urb_queue();
+    }
+    // A client leaving is not an error.
+    if (status == USB_ERROR_USBIP_DISCONNECTED) {
+        status = USB_SUCCESS;
+        _USBD_USBIP_close_client();
+    }
+    // Drop the connection on protocol errors.
+    if (status != USB_SUCCESS) {
+        _USBD_USBIP_close_client();
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+#endif /* USB_LIB_DISABLE */
@@ -16,23 +16,50 @@
 #include "common/usb_types.h"
 #include "device/usbd.h"
 #include "device/usbd_hw.h"
+#include "device/usbd_pma.h"
 #include "error.h"
-#include "strings.h"
 #include "types.h"
 
 #ifndef USB_LIB_DISABLE
 
 /*** USBD CONTROL local macros ***/
 
-#define USBD_CONTROL_PACKET_SIZE_BYTES              64
+#define USBD_CONTROL_PACKET_SIZE_BYTES                      64
 
-#define USBD_CONTROL_DESCRIPTOR_BUFFER_SIZE_BYTES   1024
-#define USBD_CONTROL_DESCRIPTOR_TOTAL_LENGTH_INDEX  2
+#define USBD_CONTROL_DESCRIPTOR_TYPE_INDEX                  1
+#define USBD_CONTROL_DESCRIPTOR_TOTAL_LENGTH_INDEX          2
+#define USBD_CONTROL_DESCRIPTOR_TOTAL_LENGTH_MAX            0xFFFF
+
+#if ((USBD_CONTROL_ROUTING_INTERFACES_MAX < 1) || (USBD_CONTROL_ROUTING_INTERFACES_MAX > 255))
+#error "USB library: USBD_CONTROL_ROUTING_INTERFACES_MAX must be between 1 and 255"
+#endif
+
+#define USBD_CONTROL_ROUTING_ENDPOINT_NUMBERS_MAX           16
+#define USBD_CONTROL_ROUTING_ENDPOINTS_MAX                  (USBD_CONTROL_ROUTING_ENDPOINT_NUMBERS_MAX << 1)
+
+#define USBD_CONTROL_STANDARD_DATA_IN_SIZE_BYTES            2
+
+#define USBD_CONTROL_DEVICE_ADDRESS_MAX                     127
+
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+#define USBD_CONTROL_LATENCY_ENTRY_INDEX_NONE               0xFF
+#define USBD_CONTROL_LATENCY_BIN_COUNT_MAX                  0xFFFF
+#endif
+
+#define USBD_CONTROL_STRING_LANGUAGES_MAX                   8
+#define USBD_CONTROL_LANGID_DESCRIPTOR_SIZE_BYTES           (sizeof(USB_string_descriptor_t) + (USBD_CONTROL_STRING_LANGUAGES_MAX << 1))
+
+#define USBD_CONTROL_UNIQUE_ID_SIZE_MAX_BYTES               16
+#define USBD_CONTROL_SERIAL_NUMBER_DESCRIPTOR_SIZE_BYTES    (sizeof(USB_string_descriptor_t) + (USBD_CONTROL_UNIQUE_ID_SIZE_MAX_BYTES << 2))
+
+#define USBD_CONTROL_MAX(a, b)                              (((a) > (b)) ? (a) : (b))
+// Single buffer shared by OUT data stages, string descriptors encoding and configuration descriptor packets (which never overlap).
+#define USBD_CONTROL_EP0_BUFFER_SIZE_BYTES                  USBD_CONTROL_MAX(USBD_CONTROL_DATA_OUT_BUFFER_SIZE_BYTES, USBD_CONTROL_MAX(USBD_CONTROL_PACKET_SIZE_BYTES, USBD_CONTROL_MAX(USBD_CONTROL_LANGID_DESCRIPTOR_SIZE_BYTES, USBD_CONTROL_SERIAL_NUMBER_DESCRIPTOR_SIZE_BYTES)))
 
 /*** USBD CONTROL local functions declaration ***/
 
-static void _USBD_CONTROL_endpoint_out_callback(void);
-static void _USBD_CONTROL_endpoint_in_callback(void);
+static void _USBD_CONTROL_endpoint_out_callback(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number);
+static void _USBD_CONTROL_endpoint_in_callback(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number);
 
 static USB_status_t _USBD_CONTROL_standard_request_callback(USB_request_t* request, USB_data_t* data_out, USB_data_t* data_in);
 
@@ -45,28 +72,121 @@ typedef enum {
     USBD_CONTROL_ENDPOINT_INDEX_LAST
 } USBD_CONTROL_endpoint_index_t;
 
+/*******************************************************************/
+typedef enum {
+    USBD_CONTROL_STAGE_IDLE = 0,
+    USBD_CONTROL_STAGE_DATA_OUT,
+    USBD_CONTROL_STAGE_DATA_IN,
+    USBD_CONTROL_STAGE_DEFERRED,
+    USBD_CONTROL_STAGE_STATUS_OUT,
+    USBD_CONTROL_STAGE_STATUS_IN,
+    USBD_CONTROL_STAGE_STALL,
+    USBD_CONTROL_STAGE_LAST
+} USBD_CONTROL_stage_t;
+
 /*******************************************************************/
 typedef union {
     uint8_t all;
     struct {
-        uint8_t in_request_pending :1;
-        uint8_t out_request_pending :1;
+        uint8_t zlp_pending :1;
+        uint8_t data_in_serialized :1;
+        uint8_t configuration_descriptor_valid :1;
+        uint8_t remote_wakeup_enabled :1;
+        uint8_t address_pending :1;
+        uint8_t data_in_other_speed :1;
+        uint8_t request_callback :1;
         uint8_t init :1;
     } __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed));
 } USBD_CONTROL_flags_t;
 
+#ifndef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+/*******************************************************************/
+typedef enum {
+    USBD_CONTROL_SERIALIZER_STEP_CONFIGURATION = 0,
+    USBD_CONTROL_SERIALIZER_STEP_INTERFACE,
+    USBD_CONTROL_SERIALIZER_STEP_INTERFACE_ASSOCIATION,
+    USBD_CONTROL_SERIALIZER_STEP_INTERFACE_ASSOCIATION_INTERFACE,
+    USBD_CONTROL_SERIALIZER_STEP_END
+} USBD_CONTROL_serializer_step_t;
+
+/*******************************************************************/
+typedef struct {
+    const USB_configuration_t* configuration;
+    USB_speed_t speed;
+    USBD_CONTROL_serializer_step_t step;
+    uint8_t interface_association_index;
+    uint8_t interface_index;
+    uint8_t element_index;
+    const uint8_t* segment;
+    uint32_t segment_size_bytes;
+    uint32_t segment_index;
+    uint32_t total_index;
+} USBD_CONTROL_serializer_t;
+#endif
+
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+/*******************************************************************/
+typedef struct {
+    USB_request_type_t request_type;
+    uint8_t bRequest;
+    USBD_CONTROL_latency_histogram_t histogram[USBD_CONTROL_LATENCY_STAGE_LAST];
+} USBD_CONTROL_latency_entry_t;
+
+/*******************************************************************/
+typedef struct {
+    USBD_CONTROL_latency_entry_t entry[USBD_CONTROL_LATENCY_HISTOGRAM_NUMBER_OF_REQUESTS];
+    uint8_t number_of_entries;
+    uint8_t current_entry_index;
+    uint8_t setup_cycle_count_valid;
+    uint32_t setup_cycle_count;
+} USBD_CONTROL_latency_t;
+#endif
+
+/*******************************************************************/
+typedef struct {
+    const USB_interface_t* interface;
+    const USB_endpoint_t* endpoint;
+} USBD_CONTROL_endpoint_route_t;
+
+/*******************************************************************/
+typedef struct {
+    const USB_interface_t* interface[USBD_CONTROL_ROUTING_INTERFACES_MAX];
+    USBD_CONTROL_endpoint_route_t endpoint[USBD_CONTROL_ROUTING_ENDPOINTS_MAX];
+} USBD_CONTROL_routing_table_t;
+
 /*******************************************************************/
 typedef struct {
     volatile USBD_CONTROL_flags_t flags;
+    volatile USBD_CONTROL_stage_t stage;
     const USB_device_t* device;
     USBD_CONTROL_callbacks_t* callbacks;
     USB_request_operation_t request_operation;
+    uint32_t request_tag;
+    uint8_t device_address;
     uint8_t current_configuration_index;
-    uint8_t full_configuration_descriptor[USBD_CONTROL_DESCRIPTOR_BUFFER_SIZE_BYTES];
-    uint8_t string_descriptor[USBD_CONTROL_DESCRIPTOR_BUFFER_SIZE_BYTES];
+    uint8_t configuration_value;
+    USBD_CONTROL_routing_table_t routing_table;
+    const USBD_CONTROL_vendor_request_t* vendor_request_table[USBD_CONTROL_VENDOR_REQUESTS_MAX];
+    uint8_t number_of_vendor_requests;
+    const USBD_CONTROL_vendor_request_t* vendor_request;
+    uint8_t alternate_setting[USBD_CONTROL_ROUTING_INTERFACES_MAX];
+    uint32_t endpoint_halt_mask;
+    uint8_t standard_data_in[USBD_CONTROL_STANDARD_DATA_IN_SIZE_BYTES];
+#ifndef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+    USBD_CONTROL_serializer_t serializer;
+    uint8_t configuration_descriptor_index;
+    uint32_t configuration_descriptor_size_bytes;
+#endif
+    uint8_t ep0_buffer[USBD_CONTROL_EP0_BUFFER_SIZE_BYTES];
     USB_data_t setup_out;
+    USB_request_t request;
+    uint32_t data_out_index;
     USB_data_t data_out;
     USB_data_t data_in;
+    uint32_t data_in_index;
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+    USBD_CONTROL_latency_t latency;
+#endif
 } USBD_CONTROL_context_t;
 
 /*** USBD CONTROL local global variables ***/
@@ -78,6 +198,7 @@ static const USB_physical_endpoint_t USBD_CONTROL_EP_PHY_OUT = {
     .synchronization_type = USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE,
     .usage_type = USB_ENDPOINT_USAGE_TYPE_DATA,
     .max_packet_size_bytes = USBD_CONTROL_PACKET_SIZE_BYTES,
+    .buffer_mode = USB_ENDPOINT_BUFFER_MODE_SINGLE,
     .callback = &_USBD_CONTROL_endpoint_out_callback
 };
 
@@ -88,6 +209,7 @@ static const USB_physical_endpoint_t USBD_CONTROL_EP_PHY_IN = {
     .synchronization_type = USB_ENDPOINT_SYNCHRONIZATION_TYPE_NONE,
     .usage_type = USB_ENDPOINT_USAGE_TYPE_DATA,
     .max_packet_size_bytes = USBD_CONTROL_PACKET_SIZE_BYTES,
+    .buffer_mode = USB_ENDPOINT_BUFFER_MODE_SINGLE,
     .callback = &_USBD_CONTROL_endpoint_in_callback
 };
 
@@ -151,10 +273,23 @@ static const USB_interface_descriptor_t USBD_CONTROL_INTERFACE_DESCRIPTOR = {
 
 static USBD_CONTROL_context_t usbd_control_ctx = {
     .flags.all = 0,
+    .stage = USBD_CONTROL_STAGE_IDLE,
     .device = NULL,
     .callbacks = NULL,
     .request_operation = USB_REQUEST_OPERATION_NOT_SUPPORTED,
-    .current_configuration_index = 0
+    .request_tag = 0,
+    .device_address = 0,
+    .current_configuration_index = 0,
+    .configuration_value = 0,
+    .endpoint_halt_mask = 0,
+    .number_of_vendor_requests = 0,
+    .vendor_request = NULL,
+#ifndef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+    .configuration_descriptor_index = 0,
+    .configuration_descriptor_size_bytes = 0,
+#endif
+    .data_out_index = 0,
+    .data_in_index = 0
 };
 
 /*** USBD CONTROL global variables ***/
@@ -170,224 +305,224 @@ const USB_interface_t USBD_CONTROL_INTERFACE = {
 
 /*** USBD CONTROL local functions ***/
 
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+/*******************************************************************/
+#define _USBD_CONTROL_latency_setup()           _USBD_CONTROL_latency_start()
+#define _USBD_CONTROL_latency_select_request()  _USBD_CONTROL_latency_select_entry()
+#define _USBD_CONTROL_latency_record(stage)     _USBD_CONTROL_latency_record_stage(stage)
+#else
+/*******************************************************************/
+#define _USBD_CONTROL_latency_setup()
+#define _USBD_CONTROL_latency_select_request()
+#define _USBD_CONTROL_latency_record(stage)
+#endif
+
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
 /*******************************************************************/
-#define _USBD_CONTROL_full_configuration_descriptor_add_byte(new_byte) { \
-    /* Add byte */ \
-    usbd_control_ctx.full_configuration_descriptor[full_idx++] = new_byte; \
-    /* Check length */ \
-    if (full_idx >= USBD_CONTROL_DESCRIPTOR_BUFFER_SIZE_BYTES) { \
-        status = USB_ERROR_CONFIGURATION_DESCRIPTOR_SIZE; \
-        goto errors; \
-    } \
+static void _USBD_CONTROL_latency_start(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Reset current measurement.
+    usbd_control_ctx.latency.current_entry_index = USBD_CONTROL_LATENCY_ENTRY_INDEX_NONE;
+    // Timestamp setup reception.
+    status = USBD_HW_get_cycle_count(&(usbd_control_ctx.latency.setup_cycle_count));
+    usbd_control_ctx.latency.setup_cycle_count_valid = (status == USB_SUCCESS) ? 1 : 0;
 }
 
 /*******************************************************************/
-static USB_status_t _USBD_CONTROL_update_configuration_index(uint8_t bConfigurationValue) {
+static void _USBD_CONTROL_latency_select_entry(void) {
     // Local variables.
-    USB_status_t status = USB_ERROR_CONFIGURATION_VALUE;
+    USBD_CONTROL_latency_entry_t* entry_ptr = NULL;
+    USB_request_type_t request_type = usbd_control_ctx.request.bmRequestType.type;
     uint8_t idx = 0;
-    // Configurations loop.
-    for (idx = 0; idx < (usbd_control_ctx.device->number_of_configurations); idx++) {
-        // Check if configuration number matches.
-        if (usbd_control_ctx.device->configuration_list[idx]->descriptor->bConfigurationValue == bConfigurationValue) {
-            // Update index.
-            usbd_control_ctx.current_configuration_index = idx;
-            // Exit loop.
-            status = USB_SUCCESS;
-            break;
+    // Check setup timestamp.
+    if (usbd_control_ctx.latency.setup_cycle_count_valid == 0) goto errors;
+    // Search request in table.
+    for (idx = 0; idx < (usbd_control_ctx.latency.number_of_entries); idx++) {
+        entry_ptr = &(usbd_control_ctx.latency.entry[idx]);
+        if (((entry_ptr->request_type) == request_type) && ((entry_ptr->bRequest) == (usbd_control_ctx.request.bRequest))) {
+            usbd_control_ctx.latency.current_entry_index = idx;
+            goto errors;
         }
     }
-    return status;
+    // Allocate new entry (request is not instrumented if the table is full).
+    if ((usbd_control_ctx.latency.number_of_entries) >= USBD_CONTROL_LATENCY_HISTOGRAM_NUMBER_OF_REQUESTS) goto errors;
+    entry_ptr = &(usbd_control_ctx.latency.entry[usbd_control_ctx.latency.number_of_entries]);
+    entry_ptr->request_type = request_type;
+    entry_ptr->bRequest = usbd_control_ctx.request.bRequest;
+    usbd_control_ctx.latency.current_entry_index = (usbd_control_ctx.latency.number_of_entries)++;
+errors:
+    return;
 }
 
 /*******************************************************************/
-static USB_status_t _USBD_CONTROL_build_full_interface_descriptor(const USB_interface_t* interface_ptr, uint32_t* full_idx_ptr) {
+static void _USBD_CONTROL_latency_record_stage(USBD_CONTROL_latency_stage_t stage) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
-    const USB_endpoint_t* endpoint_ptr = NULL;
-    uint8_t* descriptor_ptr = NULL;
-    uint8_t endpoint_idx = 0;
-    uint32_t full_idx = 0;
+    USBD_CONTROL_latency_histogram_t* histogram_ptr = NULL;
+    uint32_t cycle_count = 0;
+    uint32_t duration_cycles = 0;
+    uint8_t bin_index = 0;
+    // Check current request.
+    if (usbd_control_ctx.latency.current_entry_index == USBD_CONTROL_LATENCY_ENTRY_INDEX_NONE) goto errors;
+    // Read counter.
+    status = USBD_HW_get_cycle_count(&cycle_count);
+    if (status != USB_SUCCESS) goto errors;
+    // Counter roll-over is handled by the unsigned subtraction.
+    duration_cycles = (cycle_count - usbd_control_ctx.latency.setup_cycle_count);
+    histogram_ptr = &(usbd_control_ctx.latency.entry[usbd_control_ctx.latency.current_entry_index].histogram[stage]);
+    // Update statistics.
+    (histogram_ptr->count)++;
+    if (duration_cycles > (histogram_ptr->max_cycles)) {
+        histogram_ptr->max_cycles = duration_cycles;
+    }
+    // Compute logarithmic bin index.
+    while ((duration_cycles > 1) && (bin_index < (USBD_CONTROL_LATENCY_HISTOGRAM_NUMBER_OF_BINS - 1))) {
+        duration_cycles >>= 1;
+        bin_index++;
+    }
+    if ((histogram_ptr->bin[bin_index]) < USBD_CONTROL_LATENCY_BIN_COUNT_MAX) {
+        (histogram_ptr->bin[bin_index])++;
+    }
+errors:
+    return;
+}
+#endif
+
+/*******************************************************************/
+#define _USBD_CONTROL_get_endpoint_routing_index(number, direction) ((uint8_t) (((direction) * USBD_CONTROL_ROUTING_ENDPOINT_NUMBERS_MAX) + (number)))
+
+/*******************************************************************/
+static void _USBD_CONTROL_reset_routing_table(void) {
+    // Local variables.
     uint8_t idx = 0;
-    // Check parameter.
-    if ((interface_ptr == NULL) || (full_idx_ptr == NULL)) {
-        status = USB_ERROR_NULL_PARAMETER;
-        goto errors;
+    // Reset all entries.
+    for (idx = 0; idx < USBD_CONTROL_ROUTING_INTERFACES_MAX; idx++) {
+        usbd_control_ctx.routing_table.interface[idx] = NULL;
+        usbd_control_ctx.alternate_setting[idx] = 0;
     }
-    full_idx = (*full_idx_ptr);
-    // Descriptor.
-    descriptor_ptr = (uint8_t*) (interface_ptr->descriptor);
-    for (idx = 0; idx < (interface_ptr->descriptor)->bLength; idx++) {
-        _USBD_CONTROL_full_configuration_descriptor_add_byte(descriptor_ptr[idx]);
+    for (idx = 0; idx < USBD_CONTROL_ROUTING_ENDPOINTS_MAX; idx++) {
+        usbd_control_ctx.routing_table.endpoint[idx].interface = NULL;
+        usbd_control_ctx.routing_table.endpoint[idx].endpoint = NULL;
     }
-    // Check class specific descriptors.
-    if ((interface_ptr->cs_descriptor != NULL) && (interface_ptr->cs_descriptor_length != NULL)) {
-        // Update pointer.
-        descriptor_ptr = (uint8_t*) (interface_ptr->cs_descriptor);
-        // Append class specific descriptors.
-        for (idx = 0; idx < (*(interface_ptr->cs_descriptor_length)); idx++) {
-            _USBD_CONTROL_full_configuration_descriptor_add_byte(descriptor_ptr[idx]);
-        }
+    usbd_control_ctx.endpoint_halt_mask = 0;
+}
+
+/*******************************************************************/
+static const USB_interface_t* _USBD_CONTROL_get_alternate_setting(const USB_interface_t* interface_ptr, uint8_t alternate_setting) {
+    // Alternate setting 0 is the interface itself.
+    return ((alternate_setting == 0) ? interface_ptr : interface_ptr->alternate_setting_list[alternate_setting - 1]);
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_add_interface_route(const USB_interface_t* interface_ptr) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    const USB_interface_t* alternate_setting_ptr = NULL;
+    const USB_endpoint_descriptor_t* endpoint_descriptor_ptr = NULL;
+    USBD_CONTROL_endpoint_route_t* endpoint_route_ptr = NULL;
+    uint8_t interface_number = (interface_ptr->descriptor)->bInterfaceNumber;
+    uint8_t alternate_idx = 0;
+    uint8_t idx = 0;
+    // Check interface number.
+    if (interface_number >= USBD_CONTROL_ROUTING_INTERFACES_MAX) {
+        status = USB_ERROR_INTERFACE_NUMBER;
+        goto errors;
     }
-    // Endpoints loop.
-    for (endpoint_idx = 0; endpoint_idx < (interface_ptr->number_of_endpoints); endpoint_idx++) {
-        // Update pointer.
-        endpoint_ptr = interface_ptr->endpoint_list[endpoint_idx];
-        descriptor_ptr = (uint8_t*) (endpoint_ptr->descriptor);
-        // Append endpoint descriptor.
-        for (idx = 0; idx < (endpoint_ptr->descriptor)->bLength; idx++) {
-            _USBD_CONTROL_full_configuration_descriptor_add_byte(descriptor_ptr[idx]);
+    usbd_control_ctx.routing_table.interface[interface_number] = interface_ptr;
+    // Endpoints of all alternate settings are routed to their parent interface.
+    for (alternate_idx = 0; alternate_idx <= (interface_ptr->number_of_alternate_settings); alternate_idx++) {
+        alternate_setting_ptr = _USBD_CONTROL_get_alternate_setting(interface_ptr, alternate_idx);
+        for (idx = 0; idx < (alternate_setting_ptr->number_of_endpoints); idx++) {
+            endpoint_descriptor_ptr = (alternate_setting_ptr->endpoint_list[idx])->descriptor;
+            endpoint_route_ptr = &(usbd_control_ctx.routing_table.endpoint[_USBD_CONTROL_get_endpoint_routing_index(endpoint_descriptor_ptr->bEndpointAddress.number, endpoint_descriptor_ptr->bEndpointAddress.direction)]);
+            endpoint_route_ptr->interface = interface_ptr;
+            endpoint_route_ptr->endpoint = alternate_setting_ptr->endpoint_list[idx];
         }
     }
-    (*full_idx_ptr) = full_idx;
 errors:
     return status;
 }
 
 /*******************************************************************/
-static USB_status_t _USBD_CONTROL_build_full_configuration_descriptor(uint8_t index) {
+static USB_status_t _USBD_CONTROL_check_routing_table(uint8_t configuration_index) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
-    const USB_configuration_t* configuration_ptr = NULL;
-    const USB_interface_t* interface_ptr = NULL;
-    uint8_t* descriptor_ptr = NULL;
-    uint8_t interface_idx = 0;
-    uint8_t interface_association_idx = 0;
-    uint32_t full_idx = 0;
-    uint32_t idx = 0;
-    // Check index.
-    if (index >= (usbd_control_ctx.device->number_of_configurations)) {
-        status = USB_ERROR_CONFIGURATION_INDEX;
-        goto errors;
-    }
-    // Set configuration pointer.
-    configuration_ptr = usbd_control_ctx.device->configuration_list[index];
-    // Build full configuration descriptor.
-    descriptor_ptr = (uint8_t*) (configuration_ptr->descriptor);
-    for (idx = 0; idx < (configuration_ptr->descriptor->bLength); idx++) {
-        _USBD_CONTROL_full_configuration_descriptor_add_byte(descriptor_ptr[idx]);
-    }
-    // Interfaces loop.
-    for (interface_idx = (USBD_CONTROL_INTERFACE_INDEX + 1); interface_idx < (configuration_ptr->number_of_interfaces); interface_idx++) {
-        // Update pointer.
-        interface_ptr = configuration_ptr->interface_list[interface_idx];
-        // Build interface descriptor.
-        status = _USBD_CONTROL_build_full_interface_descriptor(interface_ptr, &full_idx);
-        if (status != USB_SUCCESS) goto errors;
+    const USB_configuration_t* configuration_ptr = usbd_control_ctx.device->configuration_list[configuration_index];
+    const USB_interface_association_t* interface_association_ptr = NULL;
+    uint8_t association_idx = 0;
+    uint8_t idx = 0;
+    // Interfaces loop (endpoint numbers are 4 bits wide so only interface numbers can be out of the table).
+    for (idx = (USBD_CONTROL_INTERFACE_INDEX + 1); idx < (configuration_ptr->number_of_interfaces); idx++) {
+        if (((configuration_ptr->interface_list[idx])->descriptor->bInterfaceNumber) >= USBD_CONTROL_ROUTING_INTERFACES_MAX) {
+            status = USB_ERROR_INTERFACE_NUMBER;
+            goto errors;
+        }
     }
     // Interface associations loop.
-    for (interface_association_idx = 0; interface_association_idx < (configuration_ptr->number_of_interfaces_associations); interface_association_idx++) {
-        // Descriptor.
-        descriptor_ptr = (uint8_t*) configuration_ptr->interface_association_list[interface_association_idx]->descriptor;
-        for (idx = 0; idx < (configuration_ptr->interface_association_list[interface_association_idx]->descriptor->bLength); idx++) {
-            _USBD_CONTROL_full_configuration_descriptor_add_byte(descriptor_ptr[idx]);
-        }
-        // Interfaces loop.
-        for (interface_idx = 0; interface_idx < (configuration_ptr->interface_association_list[interface_association_idx]->number_of_interfaces); interface_idx++) {
-            // Update pointer.
-            interface_ptr = configuration_ptr->interface_association_list[interface_association_idx]->interface_list[interface_idx];
-            // Build interface descriptor.
-            status = _USBD_CONTROL_build_full_interface_descriptor(interface_ptr, &full_idx);
-            if (status != USB_SUCCESS) goto errors;
+    for (association_idx = 0; association_idx < (configuration_ptr->number_of_interfaces_associations); association_idx++) {
+        interface_association_ptr = configuration_ptr->interface_association_list[association_idx];
+        for (idx = 0; idx < (interface_association_ptr->number_of_interfaces); idx++) {
+            if (((interface_association_ptr->interface_list[idx])->descriptor->bInterfaceNumber) >= USBD_CONTROL_ROUTING_INTERFACES_MAX) {
+                status = USB_ERROR_INTERFACE_NUMBER;
+                goto errors;
+            }
         }
     }
-    // Update total length field.
-    usbd_control_ctx.full_configuration_descriptor[USBD_CONTROL_DESCRIPTOR_TOTAL_LENGTH_INDEX] = full_idx;
 errors:
     return status;
 }
 
 /*******************************************************************/
-static USB_status_t _USBD_CONTROL_get_descriptor(USB_descriptor_type_t type, uint8_t index, uint8_t** descriptor_ptr, uint32_t* descriptor_size_bytes) {
+static USB_status_t _USBD_CONTROL_build_routing_table(uint8_t configuration_index) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
-    STRING_status_t string_status = STRING_SUCCESS;
-    uint32_t str_size = 0;
-    uint32_t full_idx = 0;
-    uint32_t idx = 0;
-    // Reset output.
-    (*descriptor_ptr) = NULL;
-    (*descriptor_size_bytes) = 0;
-    // Check type.
-    switch (type) {
-    case USB_DESCRIPTOR_TYPE_DEVICE:
-        (*descriptor_ptr) = (uint8_t*) (usbd_control_ctx.device->descriptor);
-        (*descriptor_size_bytes) = usbd_control_ctx.device->descriptor->bLength;
-        break;
-    case USB_DESCRIPTOR_TYPE_DEVICE_QUALIFIER:
-        (*descriptor_ptr) = (uint8_t*) (usbd_control_ctx.device->qualifier_descriptor);
-        (*descriptor_size_bytes) = usbd_control_ctx.device->qualifier_descriptor->bLength;
-        break;
-    case USB_DESCRIPTOR_TYPE_CONFIGURATION:
-    case USB_DESCRIPTOR_TYPE_OTHER_SPEED_CONFIGURATION:
-        // Build configuration descriptor.
-        status = _USBD_CONTROL_build_full_configuration_descriptor(index);
+    const USB_configuration_t* configuration_ptr = usbd_control_ctx.device->configuration_list[configuration_index];
+    const USB_interface_association_t* interface_association_ptr = NULL;
+    const USB_interface_t* interface_ptr = NULL;
+    uint8_t association_idx = 0;
+    uint8_t idx = 0;
+    // Reset table.
+    _USBD_CONTROL_reset_routing_table();
+    // Interfaces loop (control interface is handled by the standard request callback).
+    for (idx = (USBD_CONTROL_INTERFACE_INDEX + 1); idx < (configuration_ptr->number_of_interfaces); idx++) {
+        status = _USBD_CONTROL_add_interface_route(configuration_ptr->interface_list[idx]);
         if (status != USB_SUCCESS) goto errors;
-        // Update pointers.
-        (*descriptor_ptr) = (uint8_t*) &(usbd_control_ctx.full_configuration_descriptor);
-        (*descriptor_size_bytes) = usbd_control_ctx.full_configuration_descriptor[USBD_CONTROL_DESCRIPTOR_TOTAL_LENGTH_INDEX];
-        break;
-    case USB_DESCRIPTOR_TYPE_STRING:
-        // Check index.
-        if (index >= usbd_control_ctx.device->number_of_string_descriptors) {
-            status = USB_ERROR_STRING_DESCRIPTOR_INDEX;
-            goto errors;
+    }
+    // Interface associations loop.
+    for (association_idx = 0; association_idx < (configuration_ptr->number_of_interfaces_associations); association_idx++) {
+        interface_association_ptr = configuration_ptr->interface_association_list[association_idx];
+        for (idx = 0; idx < (interface_association_ptr->number_of_interfaces); idx++) {
+            status = _USBD_CONTROL_add_interface_route(interface_association_ptr->interface_list[idx]);
+            if (status != USB_SUCCESS) goto errors;
         }
-        // Get string length.
-        string_status = STRING_get_size((char_t*) (usbd_control_ctx.device->string_descriptor_list[index]), &str_size);
-        STRING_exit_error(USB_ERROR_BASE_STRING);
-        // Build string descriptor.
-        usbd_control_ctx.string_descriptor[full_idx++] = (sizeof(USB_string_descriptor_t) + (str_size << ((index == USB_STRING_DESCRIPTOR_INDEX_LANGID) ? 0 : 1)));
-        usbd_control_ctx.string_descriptor[full_idx++] = USB_DESCRIPTOR_TYPE_STRING;
-        // Append string.
-        for (idx = 0; idx < str_size; idx++) {
-            usbd_control_ctx.string_descriptor[full_idx++] = usbd_control_ctx.device->string_descriptor_list[index][idx];
-            // Specific case of language ID.
-            if (index != USB_STRING_DESCRIPTOR_INDEX_LANGID) {
-                usbd_control_ctx.string_descriptor[full_idx++] = 0x00;
-            }
+    }
+    // All interfaces start in their default alternate setting.
+    for (idx = 0; idx < USBD_CONTROL_ROUTING_INTERFACES_MAX; idx++) {
+        interface_ptr = usbd_control_ctx.routing_table.interface[idx];
+        if ((interface_ptr != NULL) && (interface_ptr->set_alternate_setting_callback != NULL)) {
+            status = interface_ptr->set_alternate_setting_callback(0);
+            if (status != USB_SUCCESS) goto errors;
         }
-        (*descriptor_ptr) = (uint8_t*) &(usbd_control_ctx.string_descriptor);
-        (*descriptor_size_bytes) = usbd_control_ctx.string_descriptor[0];
-        break;
-    default:
-        status = USB_ERROR_DESCRIPTOR_TYPE;
-        goto errors;
     }
 errors:
+    // Do not keep a partial table.
+    if (status != USB_SUCCESS) {
+        _USBD_CONTROL_reset_routing_table();
+    }
     return status;
 }
 
 /*******************************************************************/
-static USB_status_t _USBD_CONTROL_standard_request_callback(USB_request_t* request, USB_data_t* data_out, USB_data_t* data_in) {
+static USB_status_t _USBD_CONTROL_get_endpoint_route(uint8_t endpoint_address, USBD_CONTROL_endpoint_route_t** endpoint_route, uint8_t* endpoint_route_index) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
-    uint8_t wValue_high = (uint8_t) ((request->wValue >> 8) & 0xFF);
-    uint8_t wValue_low = (uint8_t) ((request->wValue >> 0) & 0xFF);
-    // Unused parameter.
-    UNUSED(data_out);
-    // Check request.
-    switch (request->bRequest) {
-    case USB_REQUEST_GET_DESCRIPTOR:
-        // Read descriptor.
-        status = _USBD_CONTROL_get_descriptor(wValue_high, wValue_low, &(data_in->data), &(data_in->size_bytes));
-        if (status != USB_SUCCESS) goto errors;
-        break;
-    case USB_REQUEST_SET_ADDRESS:
-        // Set address on hardware side.
-        status = USBD_HW_set_address(wValue_low);
-        if (status != USB_SUCCESS) goto errors;
-        break;
-    case USB_REQUEST_SET_CONFIGURATION:
-        // Set configuration.
-        status = usbd_control_ctx.callbacks->set_configuration_request(wValue_low);
-        if (status != USB_SUCCESS) goto errors;
-        // Update local context.
-        status = _USBD_CONTROL_update_configuration_index(wValue_low);
-        if (status != USB_SUCCESS) goto errors;
-        break;
-    default:
-        status = USB_ERROR_STANDARD_REQUEST;
+    // Endpoint number is 4 bits wide so the index is always in range.
+    (*endpoint_route_index) = _USBD_CONTROL_get_endpoint_routing_index((endpoint_address & 0x0F), (endpoint_address >> 7));
+    (*endpoint_route) = &(usbd_control_ctx.routing_table.endpoint[*endpoint_route_index]);
+    // Check route.
+    if (((*endpoint_route)->endpoint) == NULL) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
         goto errors;
     }
 errors:
@@ -395,100 +530,1123 @@ errors:
 }
 
 /*******************************************************************/
-static void _USBD_CONTROL_update_request_operation(void) {
+static USB_status_t _USBD_CONTROL_get_configuration_index(uint8_t bConfigurationValue, uint8_t* configuration_index) {
     // Local variables.
-    USB_request_t* request_ptr;
-    // Reset setup request operation.
-    usbd_control_ctx.request_operation = USB_REQUEST_OPERATION_NOT_SUPPORTED;
-    // Cast frame.
-    request_ptr = (USB_request_t*) (usbd_control_ctx.setup_out.data);
-    // Compute transfer type.
-    if ((request_ptr->wLength) == 0) {
-        usbd_control_ctx.request_operation = USB_REQUEST_OPERATION_WRITE_NO_DATA;
+    USB_status_t status = USB_ERROR_CONFIGURATION_VALUE;
+    uint8_t idx = 0;
+    // Configurations loop.
+    for (idx = 0; idx < (usbd_control_ctx.device->number_of_configurations); idx++) {
+        // Check if configuration number matches.
+        if (usbd_control_ctx.device->configuration_list[idx]->descriptor->bConfigurationValue == bConfigurationValue) {
+            // Update index.
+            (*configuration_index) = idx;
+            // Exit loop.
+            status = USB_SUCCESS;
+            break;
+        }
     }
-    else {
-        if (((request_ptr->bmRequestType).direction) == USB_REQUEST_DIRECTION_HOST_TO_DEVICE) {
-            usbd_control_ctx.request_operation = USB_REQUEST_OPERATION_WRITE;
+    return status;
+}
+
+#ifndef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+/*******************************************************************/
+static uint8_t _USBD_CONTROL_get_interface_segment(const USB_interface_t* interface_ptr, USB_speed_t speed, uint8_t element_index, const uint8_t** segment, uint32_t* segment_size_bytes) {
+    // Local variables.
+    uint8_t segment_found = 0;
+    const USB_interface_t* alternate_setting_ptr = NULL;
+    const USB_endpoint_descriptor_t* endpoint_descriptor_ptr = NULL;
+    uint8_t alternate_idx = 0;
+    // Each alternate setting is made of its interface descriptor, class specific descriptors and endpoint descriptors.
+    for (alternate_idx = 0; alternate_idx <= (interface_ptr->number_of_alternate_settings); alternate_idx++) {
+        alternate_setting_ptr = _USBD_CONTROL_get_alternate_setting(interface_ptr, alternate_idx);
+        if (element_index < (2 + (alternate_setting_ptr->number_of_endpoints))) {
+            segment_found = 1;
+            break;
         }
-        else {
-            usbd_control_ctx.request_operation = USB_REQUEST_OPERATION_READ;
+        element_index -= (2 + (alternate_setting_ptr->number_of_endpoints));
+    }
+    if (segment_found == 0) goto end;
+    // Check element.
+    if (element_index == 0) {
+        // Interface descriptor.
+        (*segment) = (const uint8_t*) (alternate_setting_ptr->descriptor);
+        (*segment_size_bytes) = (alternate_setting_ptr->descriptor)->bLength;
+    }
+    else if (element_index == 1) {
+        // Optional class specific descriptors.
+        if ((alternate_setting_ptr->cs_descriptor != NULL) && (alternate_setting_ptr->cs_descriptor_length != NULL)) {
+            (*segment) = alternate_setting_ptr->cs_descriptor;
+            (*segment_size_bytes) = (*(alternate_setting_ptr->cs_descriptor_length));
         }
     }
+    else {
+        // Endpoint descriptors of the requested speed.
+        endpoint_descriptor_ptr = USB_ENDPOINT_GET_DESCRIPTOR(alternate_setting_ptr->endpoint_list[element_index - 2], speed);
+        (*segment) = (const uint8_t*) endpoint_descriptor_ptr;
+        (*segment_size_bytes) = endpoint_descriptor_ptr->bLength;
+    }
+end:
+    return segment_found;
 }
 
 /*******************************************************************/
-static USB_status_t _USBD_CONTROL_decode_request(void) {
+static void _USBD_CONTROL_serializer_next_segment(void) {
+    // Local variables.
+    USBD_CONTROL_serializer_t* serializer_ptr = &(usbd_control_ctx.serializer);
+    const USB_configuration_t* configuration_ptr = serializer_ptr->configuration;
+    const USB_interface_association_t* interface_association_ptr = NULL;
+    // Reset segment.
+    serializer_ptr->segment = NULL;
+    serializer_ptr->segment_size_bytes = 0;
+    serializer_ptr->segment_index = 0;
+    // Walk the configuration tree until a non-empty segment is found.
+    while ((serializer_ptr->segment_size_bytes == 0) && (serializer_ptr->step != USBD_CONTROL_SERIALIZER_STEP_END)) {
+        switch (serializer_ptr->step) {
+        case USBD_CONTROL_SERIALIZER_STEP_CONFIGURATION:
+            // Configuration descriptor.
+            serializer_ptr->segment = (const uint8_t*) (configuration_ptr->descriptor);
+            serializer_ptr->segment_size_bytes = (configuration_ptr->descriptor)->bLength;
+            // Control interface is not part of the configuration descriptor.
+            serializer_ptr->step = USBD_CONTROL_SERIALIZER_STEP_INTERFACE;
+            serializer_ptr->interface_index = (USBD_CONTROL_INTERFACE_INDEX + 1);
+            serializer_ptr->element_index = 0;
+            break;
+        case USBD_CONTROL_SERIALIZER_STEP_INTERFACE:
+            // Check interface index.
+            if ((serializer_ptr->interface_index) >= (configuration_ptr->number_of_interfaces)) {
+                serializer_ptr->step = USBD_CONTROL_SERIALIZER_STEP_INTERFACE_ASSOCIATION;
+                serializer_ptr->interface_association_index = 0;
+                break;
+            }
+            // Interface elements.
+            if (_USBD_CONTROL_get_interface_segment(configuration_ptr->interface_list[serializer_ptr->interface_index], serializer_ptr->speed, (serializer_ptr->element_index)++, &(serializer_ptr->segment), &(serializer_ptr->segment_size_bytes)) == 0) {
+                (serializer_ptr->interface_index)++;
+                serializer_ptr->element_index = 0;
+            }
+            break;
+        case USBD_CONTROL_SERIALIZER_STEP_INTERFACE_ASSOCIATION:
+            // Check interface association index.
+            if ((serializer_ptr->interface_association_index) >= (configuration_ptr->number_of_interfaces_associations)) {
+                serializer_ptr->step = USBD_CONTROL_SERIALIZER_STEP_END;
+                break;
+            }
+            // Interface association descriptor.
+            interface_association_ptr = configuration_ptr->interface_association_list[serializer_ptr->interface_association_index];
+            serializer_ptr->segment = (const uint8_t*) (interface_association_ptr->descriptor);
+            serializer_ptr->segment_size_bytes = (interface_association_ptr->descriptor)->bLength;
+            serializer_ptr->step = USBD_CONTROL_SERIALIZER_STEP_INTERFACE_ASSOCIATION_INTERFACE;
+            serializer_ptr->interface_index = 0;
+            serializer_ptr->element_index = 0;
+            break;
+        case USBD_CONTROL_SERIALIZER_STEP_INTERFACE_ASSOCIATION_INTERFACE:
+            interface_association_ptr = configuration_ptr->interface_association_list[serializer_ptr->interface_association_index];
+            // Check interface index.
+            if ((serializer_ptr->interface_index) >= (interface_association_ptr->number_of_interfaces)) {
+                serializer_ptr->step = USBD_CONTROL_SERIALIZER_STEP_INTERFACE_ASSOCIATION;
+                (serializer_ptr->interface_association_index)++;
+                break;
+            }
+            // Interface elements.
+            if (_USBD_CONTROL_get_interface_segment(interface_association_ptr->interface_list[serializer_ptr->interface_index], serializer_ptr->speed, (serializer_ptr->element_index)++, &(serializer_ptr->segment), &(serializer_ptr->segment_size_bytes)) == 0) {
+                (serializer_ptr->interface_index)++;
+                serializer_ptr->element_index = 0;
+            }
+            break;
+        default:
+            serializer_ptr->step = USBD_CONTROL_SERIALIZER_STEP_END;
+            break;
+        }
+    }
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_serializer_start(uint8_t index, USB_speed_t speed) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
-    const USB_configuration_t* configuration_ptr = NULL;
-    const USB_interface_t* interface_ptr = NULL;
-    USB_request_t* request_ptr;
-    // Check data size.
-    if ((usbd_control_ctx.setup_out.size_bytes) < sizeof(USB_request_t)) {
-        status = USB_ERROR_REQUEST_SIZE;
+    // Check index.
+    if (index >= (usbd_control_ctx.device->number_of_configurations)) {
+        status = USB_ERROR_CONFIGURATION_INDEX;
         goto errors;
     }
-    // Reset output data.
-    usbd_control_ctx.data_in.data = NULL;
-    usbd_control_ctx.data_in.size_bytes = 0;
-    // Cast frame.
-    request_ptr = (USB_request_t*) (usbd_control_ctx.setup_out.data);
-    // Check type.
-    switch (request_ptr->bmRequestType.type) {
-    case USB_REQUEST_TYPE_STANDARD:
-        // Decode standard request.
-        status = _USBD_CONTROL_standard_request_callback(request_ptr, &usbd_control_ctx.data_out, &(usbd_control_ctx.data_in));
-        if (status != USB_SUCCESS) goto errors;
-        break;
-    case USB_REQUEST_TYPE_CLASS:
-        // Search corresponding interface.
-        configuration_ptr = usbd_control_ctx.device->configuration_list[usbd_control_ctx.current_configuration_index];
-        interface_ptr = configuration_ptr->interface_list[request_ptr->wIndex];
-        // Check request callback.
-        if (interface_ptr->request_callback == NULL) {
-            status = USB_ERROR_CLASS_REQUEST;
-            goto errors;
+    // Reset serializer.
+    usbd_control_ctx.serializer.configuration = usbd_control_ctx.device->configuration_list[index];
+    usbd_control_ctx.serializer.speed = speed;
+    usbd_control_ctx.serializer.step = USBD_CONTROL_SERIALIZER_STEP_CONFIGURATION;
+    usbd_control_ctx.serializer.total_index = 0;
+    // Load first segment.
+    _USBD_CONTROL_serializer_next_segment();
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_serializer_read(uint8_t* data, uint32_t size_bytes) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_CONTROL_serializer_t* serializer_ptr = &(usbd_control_ctx.serializer);
+    uint8_t new_byte = 0;
+    uint32_t idx = 0;
+    // Bytes loop.
+    for (idx = 0; idx < size_bytes; idx++) {
+        // Go to next segment if needed.
+        if ((serializer_ptr->segment_index) >= (serializer_ptr->segment_size_bytes)) {
+            _USBD_CONTROL_serializer_next_segment();
         }
-        // Execute class specific callback.
-        status = interface_ptr->request_callback(request_ptr, &usbd_control_ctx.data_out, &(usbd_control_ctx.data_in));
-        if (status != USB_SUCCESS) goto errors;
-        break;
-    case USB_REQUEST_TYPE_VENDOR:
-        // Check vendor callback.
-        if (usbd_control_ctx.callbacks->vendor_request == NULL) {
-            status = USB_ERROR_VENDOR_REQUEST;
+        if ((serializer_ptr->segment) == NULL) {
+            status = USB_ERROR_CONFIGURATION_DESCRIPTOR_SIZE;
             goto errors;
         }
-        // Execute external callback.
-        status = usbd_control_ctx.callbacks->vendor_request(request_ptr, &usbd_control_ctx.data_out, &(usbd_control_ctx.data_in));
-        if (status != USB_SUCCESS) goto errors;
-        break;
-    default:
-        status = USB_ERROR_REQUEST_TYPE;
-        goto errors;
-    }
-    // Clamp data size according to request.
-    if ((usbd_control_ctx.data_in.size_bytes) > (request_ptr->wLength)) {
-        usbd_control_ctx.data_in.size_bytes = (request_ptr->wLength);
+        new_byte = serializer_ptr->segment[(serializer_ptr->segment_index)++];
+        // Patch total length field.
+        if ((serializer_ptr->total_index) == USBD_CONTROL_DESCRIPTOR_TOTAL_LENGTH_INDEX) {
+            new_byte = (uint8_t) ((usbd_control_ctx.configuration_descriptor_size_bytes >> 0) & 0xFF);
+        }
+        if ((serializer_ptr->total_index) == (USBD_CONTROL_DESCRIPTOR_TOTAL_LENGTH_INDEX + 1)) {
+            new_byte = (uint8_t) ((usbd_control_ctx.configuration_descriptor_size_bytes >> 8) & 0xFF);
+        }
+        data[idx] = new_byte;
+        (serializer_ptr->total_index)++;
     }
 errors:
     return status;
 }
 
 /*******************************************************************/
-static USB_status_t _USBD_CONTROL_process_request(void) {
+static USB_status_t _USBD_CONTROL_update_configuration_descriptor_size(uint8_t index) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
-    // Decode request.
-    status = _USBD_CONTROL_decode_request();
+    uint32_t size_bytes = 0;
+    // Invalidate cache.
+    usbd_control_ctx.flags.configuration_descriptor_valid = 0;
+    // Walk the whole tree without copying any byte (endpoint descriptors have the same length at both speeds).
+    status = _USBD_CONTROL_serializer_start(index, USB_SPEED_FULL);
     if (status != USB_SUCCESS) goto errors;
-    // Check if there is IN data to send.
-    if ((usbd_control_ctx.data_in.data != NULL) && (usbd_control_ctx.data_in.size_bytes != 0)) {
-        // Send data to host.
-        status = USBD_HW_write_data((USB_physical_endpoint_t*) &USBD_CONTROL_EP_PHY_IN, &usbd_control_ctx.data_in);
-        if (status != USB_SUCCESS) goto errors;
-        // Update flag.
-        usbd_control_ctx.flags.in_request_pending = 1;
+    while (usbd_control_ctx.serializer.segment != NULL) {
+        size_bytes += usbd_control_ctx.serializer.segment_size_bytes;
+        _USBD_CONTROL_serializer_next_segment();
+    }
+    // Check size.
+    if (size_bytes > USBD_CONTROL_DESCRIPTOR_TOTAL_LENGTH_MAX) {
+        status = USB_ERROR_CONFIGURATION_DESCRIPTOR_SIZE;
+        goto errors;
+    }
+    // Update cache.
+    usbd_control_ctx.configuration_descriptor_index = index;
+    usbd_control_ctx.configuration_descriptor_size_bytes = size_bytes;
+    usbd_control_ctx.flags.configuration_descriptor_valid = 1;
+errors:
+    return status;
+}
+#else
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_check_static_descriptors(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    const USB_configuration_t* configuration_ptr = NULL;
+    uint8_t idx = 0;
+    // Configurations loop.
+    for (idx = 0; idx < (usbd_control_ctx.device->number_of_configurations); idx++) {
+        configuration_ptr = usbd_control_ctx.device->configuration_list[idx];
+        // Check descriptors.
+        if ((configuration_ptr->static_descriptor) == NULL) {
+            status = USB_ERROR_NULL_PARAMETER;
+            goto errors;
+        }
+        if (((configuration_ptr->static_descriptor)->wTotalLength) < sizeof(USB_configuration_descriptor_t)) {
+            status = USB_ERROR_CONFIGURATION_DESCRIPTOR_SIZE;
+            goto errors;
+        }
+        if (((configuration_ptr->static_hs_descriptor) != NULL) && (((configuration_ptr->static_hs_descriptor)->wTotalLength) < sizeof(USB_configuration_descriptor_t))) {
+            status = USB_ERROR_CONFIGURATION_DESCRIPTOR_SIZE;
+            goto errors;
+        }
+    }
+errors:
+    return status;
+}
+#endif
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_build_langid_descriptor(uint32_t* descriptor_size_bytes) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint16_t langid = 0;
+    uint8_t full_idx = 0;
+    uint8_t idx = 0;
+    // Reset size.
+    (*descriptor_size_bytes) = 0;
+    // Check number of languages (devices without language do not have any string descriptor).
+    if (usbd_control_ctx.device->number_of_languages == 0) {
+        status = USB_ERROR_STRING_DESCRIPTOR_INDEX;
+        goto errors;
+    }
+    if (usbd_control_ctx.device->number_of_languages > USBD_CONTROL_STRING_LANGUAGES_MAX) {
+        status = USB_ERROR_STRING_DESCRIPTOR_LANGUAGE;
+        goto errors;
+    }
+    // Header.
+    usbd_control_ctx.ep0_buffer[full_idx++] = (sizeof(USB_string_descriptor_t) + ((usbd_control_ctx.device->number_of_languages) << 1));
+    usbd_control_ctx.ep0_buffer[full_idx++] = USB_DESCRIPTOR_TYPE_STRING;
+    // Languages loop.
+    for (idx = 0; idx < (usbd_control_ctx.device->number_of_languages); idx++) {
+        langid = usbd_control_ctx.device->language_list[idx]->langid;
+        usbd_control_ctx.ep0_buffer[full_idx++] = (uint8_t) ((langid >> 0) & 0xFF);
+        usbd_control_ctx.ep0_buffer[full_idx++] = (uint8_t) ((langid >> 8) & 0xFF);
+    }
+    (*descriptor_size_bytes) = full_idx;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_build_serial_number_descriptor(uint32_t* descriptor_size_bytes) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_data_t unique_id;
+    uint8_t iSerialNumber = usbd_control_ctx.device->descriptor->iSerialNumber;
+    const USB_string_descriptor_language_t* language_ptr = NULL;
+    uint8_t nibble = 0;
+    uint8_t full_idx = 0;
+    uint8_t idx = 0;
+    // Reset size (descriptor is not generated).
+    (*descriptor_size_bytes) = 0;
+    // Check if the serial number has to be generated.
+    if ((iSerialNumber == 0) || (usbd_control_ctx.device->number_of_languages == 0)) goto errors;
+    language_ptr = usbd_control_ctx.device->language_list[0];
+    if ((iSerialNumber < (language_ptr->number_of_string_descriptors)) && ((language_ptr->string_descriptor_list[iSerialNumber]) != NULL)) goto errors;
+    // Read unique ID.
+    status = USBD_HW_get_unique_id(&unique_id);
+    // Device has no serial number if the peripheral does not provide any unique ID.
+    if (status == USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED) {
+        status = USB_SUCCESS;
+        goto errors;
+    }
+    if (status != USB_SUCCESS) goto errors;
+    // Check size.
+    if ((unique_id.data == NULL) || (unique_id.size_bytes == 0) || (unique_id.size_bytes > USBD_CONTROL_UNIQUE_ID_SIZE_MAX_BYTES)) {
+        status = USB_ERROR_SERIAL_NUMBER_SIZE;
+        goto errors;
+    }
+    // Header.
+    usbd_control_ctx.ep0_buffer[full_idx++] = (sizeof(USB_string_descriptor_t) + ((unique_id.size_bytes) << 2));
+    usbd_control_ctx.ep0_buffer[full_idx++] = USB_DESCRIPTOR_TYPE_STRING;
+    // Encode each nibble as an UTF-16LE hexadecimal character.
+    for (idx = 0; idx < (unique_id.size_bytes << 1); idx++) {
+        nibble = (unique_id.data[idx >> 1] >> (((idx & 0x01) == 0) ? 4 : 0)) & 0x0F;
+        usbd_control_ctx.ep0_buffer[full_idx++] = (nibble < 10) ? ('0' + nibble) : ('A' + nibble - 10);
+        usbd_control_ctx.ep0_buffer[full_idx++] = 0x00;
+    }
+    (*descriptor_size_bytes) = full_idx;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_get_string_descriptor(uint8_t index, uint16_t langid, uint8_t** descriptor_ptr, uint32_t* descriptor_size_bytes) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    const USB_string_descriptor_language_t* language_ptr = NULL;
+    const USB_string_descriptor_t* string_descriptor_ptr = NULL;
+    uint8_t idx = 0;
+    // Specific case of language ID.
+    if (index == USB_STRING_DESCRIPTOR_INDEX_LANGID) {
+        status = _USBD_CONTROL_build_langid_descriptor(descriptor_size_bytes);
+        if (status != USB_SUCCESS) goto errors;
+        (*descriptor_ptr) = usbd_control_ctx.ep0_buffer;
+        goto errors;
+    }
+    // Check number of languages.
+    if (usbd_control_ctx.device->number_of_languages == 0) {
+        status = USB_ERROR_STRING_DESCRIPTOR_INDEX;
+        goto errors;
+    }
+    language_ptr = usbd_control_ctx.device->language_list[0];
+    // Search language (first one is used if the requested language is not supported).
+    for (idx = 0; idx < (usbd_control_ctx.device->number_of_languages); idx++) {
+        if ((usbd_control_ctx.device->language_list[idx]->langid) == langid) {
+            language_ptr = usbd_control_ctx.device->language_list[idx];
+            break;
+        }
+    }
+    // Read pre-encoded descriptor.
+    if (index < (language_ptr->number_of_string_descriptors)) {
+        string_descriptor_ptr = language_ptr->string_descriptor_list[index];
+    }
+    if (string_descriptor_ptr != NULL) {
+        (*descriptor_ptr) = (uint8_t*) string_descriptor_ptr;
+        (*descriptor_size_bytes) = string_descriptor_ptr->bLength;
+        goto errors;
+    }
+    // Generate serial number.
+    if (index == usbd_control_ctx.device->descriptor->iSerialNumber) {
+        status = _USBD_CONTROL_build_serial_number_descriptor(descriptor_size_bytes);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    if ((*descriptor_size_bytes) == 0) {
+        status = USB_ERROR_STRING_DESCRIPTOR_INDEX;
+        goto errors;
+    }
+    (*descriptor_ptr) = usbd_control_ctx.ep0_buffer;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_get_descriptor(USB_descriptor_type_t type, uint8_t index, uint16_t langid, uint8_t** descriptor_ptr, uint32_t* descriptor_size_bytes) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_speed_t speed = USB_SPEED_FULL;
+#ifdef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+    const USB_configuration_t* configuration_ptr = NULL;
+    const USB_configuration_descriptor_t* static_descriptor_ptr = NULL;
+#endif
+    // Reset output.
+    (*descriptor_ptr) = NULL;
+    (*descriptor_size_bytes) = 0;
+    // Check type.
+    switch (type) {
+    case USB_DESCRIPTOR_TYPE_DEVICE:
+        (*descriptor_ptr) = (uint8_t*) (usbd_control_ctx.device->descriptor);
+        (*descriptor_size_bytes) = usbd_control_ctx.device->descriptor->bLength;
+        break;
+    case USB_DESCRIPTOR_TYPE_DEVICE_QUALIFIER:
+        // Full speed only devices do not have qualifier.
+        if (usbd_control_ctx.device->qualifier_descriptor == NULL) {
+            status = USB_ERROR_DESCRIPTOR_TYPE;
+            goto errors;
+        }
+        (*descriptor_ptr) = (uint8_t*) (usbd_control_ctx.device->qualifier_descriptor);
+        (*descriptor_size_bytes) = usbd_control_ctx.device->qualifier_descriptor->bLength;
+        break;
+    case USB_DESCRIPTOR_TYPE_CONFIGURATION:
+    case USB_DESCRIPTOR_TYPE_OTHER_SPEED_CONFIGURATION:
+        // Select descriptor set.
+        status = USBD_CONTROL_get_speed(&speed);
+        if (status != USB_SUCCESS) goto errors;
+        if (type == USB_DESCRIPTOR_TYPE_OTHER_SPEED_CONFIGURATION) {
+            // Full speed only devices do not have other speed configuration.
+            if (usbd_control_ctx.device->qualifier_descriptor == NULL) {
+                status = USB_ERROR_DESCRIPTOR_TYPE;
+                goto errors;
+            }
+            speed = (speed == USB_SPEED_HIGH) ? USB_SPEED_FULL : USB_SPEED_HIGH;
+            usbd_control_ctx.flags.data_in_other_speed = 1;
+        }
+#ifdef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+        // Check index.
+        if (index >= (usbd_control_ctx.device->number_of_configurations)) {
+            status = USB_ERROR_CONFIGURATION_INDEX;
+            goto errors;
+        }
+        // Select the descriptor built by the application.
+        configuration_ptr = usbd_control_ctx.device->configuration_list[index];
+        static_descriptor_ptr = ((speed == USB_SPEED_HIGH) && ((configuration_ptr->static_hs_descriptor) != NULL)) ? (configuration_ptr->static_hs_descriptor) : (configuration_ptr->static_descriptor);
+        // Update pointers.
+        (*descriptor_ptr) = (uint8_t*) static_descriptor_ptr;
+        (*descriptor_size_bytes) = (static_descriptor_ptr->wTotalLength);
+#else
+        // Compute total length only if the cached one does not match.
+        if ((usbd_control_ctx.flags.configuration_descriptor_valid == 0) || (usbd_control_ctx.configuration_descriptor_index != index)) {
+            status = _USBD_CONTROL_update_configuration_descriptor_size(index);
+            if (status != USB_SUCCESS) goto errors;
+        }
+        // Bytes will be produced packet per packet during the data stage.
+        status = _USBD_CONTROL_serializer_start(index, speed);
+        if (status != USB_SUCCESS) goto errors;
+        usbd_control_ctx.flags.data_in_serialized = 1;
+        // Update pointers.
+        (*descriptor_ptr) = NULL;
+        (*descriptor_size_bytes) = usbd_control_ctx.configuration_descriptor_size_bytes;
+#endif
+        break;
+    case USB_DESCRIPTOR_TYPE_STRING:
+        // Read pre-encoded string descriptor.
+        status = _USBD_CONTROL_get_string_descriptor(index, langid, descriptor_ptr, descriptor_size_bytes);
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    default:
+        status = USB_ERROR_DESCRIPTOR_TYPE;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_get_status(USB_request_t* request, USB_data_t* data_in) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    const USB_configuration_descriptor_t* configuration_descriptor_ptr = NULL;
+    USBD_CONTROL_endpoint_route_t* endpoint_route_ptr = NULL;
+    uint8_t endpoint_route_index = 0;
+    uint8_t wIndex_low = (uint8_t) ((request->wIndex >> 0) & 0xFF);
+    uint16_t device_status = 0;
+    // Check recipient.
+    switch (request->bmRequestType.recipient) {
+    case USB_REQUEST_RECIPIENT_DEVICE:
+        configuration_descriptor_ptr = (usbd_control_ctx.device->configuration_list[usbd_control_ctx.current_configuration_index])->descriptor;
+        device_status |= (uint16_t) ((configuration_descriptor_ptr->bmAttributes.self_powered) << 0);
+        device_status |= (uint16_t) ((usbd_control_ctx.flags.remote_wakeup_enabled) << 1);
+        break;
+    case USB_REQUEST_RECIPIENT_INTERFACE:
+        // Interface status is reserved.
+        if ((wIndex_low >= USBD_CONTROL_ROUTING_INTERFACES_MAX) || (usbd_control_ctx.routing_table.interface[wIndex_low] == NULL)) {
+            status = USB_ERROR_INTERFACE_NUMBER;
+            goto errors;
+        }
+        break;
+    case USB_REQUEST_RECIPIENT_ENDPOINT:
+        // Control endpoint is never halted.
+        if ((wIndex_low & 0x0F) == 0) break;
+        status = _USBD_CONTROL_get_endpoint_route(wIndex_low, &endpoint_route_ptr, &endpoint_route_index);
+        if (status != USB_SUCCESS) goto errors;
+        device_status = (uint16_t) ((usbd_control_ctx.endpoint_halt_mask >> endpoint_route_index) & 0x01);
+        break;
+    default:
+        status = USB_ERROR_REQUEST_RECIPIENT;
+        goto errors;
+    }
+    // Update output data.
+    usbd_control_ctx.standard_data_in[0] = (uint8_t) ((device_status >> 0) & 0xFF);
+    usbd_control_ctx.standard_data_in[1] = (uint8_t) ((device_status >> 8) & 0xFF);
+    data_in->data = usbd_control_ctx.standard_data_in;
+    data_in->size_bytes = USBD_CONTROL_STANDARD_DATA_IN_SIZE_BYTES;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_set_feature(USB_request_t* request, uint8_t feature_state) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    const USB_configuration_descriptor_t* configuration_descriptor_ptr = NULL;
+    USBD_CONTROL_endpoint_route_t* endpoint_route_ptr = NULL;
+    USB_physical_endpoint_t* physical_endpoint_ptr = NULL;
+    uint8_t endpoint_route_index = 0;
+    uint8_t wIndex_low = (uint8_t) ((request->wIndex >> 0) & 0xFF);
+    // Check recipient and feature.
+    if ((request->bmRequestType.recipient == USB_REQUEST_RECIPIENT_DEVICE) && (request->wValue == USB_REQUEST_FEATURE_SELECTOR_DEVICE_REMOTE_WAKEUP)) {
+        // Check if remote wakeup is supported by the configuration.
+        configuration_descriptor_ptr = (usbd_control_ctx.device->configuration_list[usbd_control_ctx.current_configuration_index])->descriptor;
+        if (configuration_descriptor_ptr->bmAttributes.remote_wakeup == 0) {
+            status = USB_ERROR_STANDARD_REQUEST;
+            goto errors;
+        }
+        usbd_control_ctx.flags.remote_wakeup_enabled = (feature_state == 0) ? 0 : 1;
+    }
+    else if ((request->bmRequestType.recipient == USB_REQUEST_RECIPIENT_ENDPOINT) && (request->wValue == USB_REQUEST_FEATURE_SELECTOR_ENDPOINT_HALT)) {
+        // Control endpoint halt is automatically cleared by the next setup packet.
+        if ((wIndex_low & 0x0F) != 0) {
+            status = _USBD_CONTROL_get_endpoint_route(wIndex_low, &endpoint_route_ptr, &endpoint_route_index);
+            if (status != USB_SUCCESS) goto errors;
+            physical_endpoint_ptr = (USB_physical_endpoint_t*) ((endpoint_route_ptr->endpoint)->physical_endpoint);
+            // Update hardware.
+            if (feature_state == 0) {
+                status = USBD_HW_clear_stall(physical_endpoint_ptr);
+                if (status != USB_SUCCESS) goto errors;
+                usbd_control_ctx.endpoint_halt_mask &= ~(((uint32_t) 1) << endpoint_route_index);
+            }
+            else {
+                status = USBD_HW_set_stall(physical_endpoint_ptr);
+                if (status != USB_SUCCESS) goto errors;
+                usbd_control_ctx.endpoint_halt_mask |= (((uint32_t) 1) << endpoint_route_index);
+            }
+        }
+    }
+    else {
+        // Test mode is not supported.
+        status = USB_ERROR_STANDARD_REQUEST;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_set_configuration(uint8_t bConfigurationValue) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint8_t configuration_index = 0;
+    // Configuration value 0 returns to the address state.
+    if (bConfigurationValue != 0) {
+        status = _USBD_CONTROL_get_configuration_index(bConfigurationValue, &configuration_index);
+        if (status != USB_SUCCESS) goto errors;
+        // Check class requests routing before the application switches to the new configuration.
+        status = _USBD_CONTROL_check_routing_table(configuration_index);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    // Set configuration (the current one is kept if the application rejects the request).
+    status = usbd_control_ctx.callbacks->set_configuration_request(bConfigurationValue);
+    if (status != USB_SUCCESS) goto errors;
+    // Update class requests routing.
+    usbd_control_ctx.configuration_value = 0;
+    _USBD_CONTROL_reset_routing_table();
+    if (bConfigurationValue != 0) {
+        status = _USBD_CONTROL_build_routing_table(configuration_index);
+        if (status != USB_SUCCESS) {
+            // Return to the address state if a class driver rejects its default alternate setting.
+            usbd_control_ctx.callbacks->set_configuration_request(0);
+            goto errors;
+        }
+        usbd_control_ctx.current_configuration_index = configuration_index;
+    }
+    usbd_control_ctx.configuration_value = bConfigurationValue;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_set_interface(uint8_t interface_number, uint8_t alternate_setting) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    const USB_interface_t* interface_ptr = NULL;
+    USBD_CONTROL_endpoint_route_t* endpoint_route_ptr = NULL;
+    uint8_t idx = 0;
+    // Check interface.
+    if ((interface_number >= USBD_CONTROL_ROUTING_INTERFACES_MAX) || (usbd_control_ctx.routing_table.interface[interface_number] == NULL)) {
+        status = USB_ERROR_INTERFACE_NUMBER;
+        goto errors;
+    }
+    interface_ptr = usbd_control_ctx.routing_table.interface[interface_number];
+    // Check alternate setting.
+    if (alternate_setting > (interface_ptr->number_of_alternate_settings)) {
+        status = USB_ERROR_ALTERNATE_SETTING;
+        goto errors;
+    }
+    // Let the class driver allocate or release the bandwidth.
+    if ((interface_ptr->set_alternate_setting_callback) != NULL) {
+        status = interface_ptr->set_alternate_setting_callback(alternate_setting);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    usbd_control_ctx.alternate_setting[interface_number] = alternate_setting;
+    // Selecting an alternate setting clears the halt feature of the interface endpoints.
+    for (idx = 0; idx < USBD_CONTROL_ROUTING_ENDPOINTS_MAX; idx++) {
+        endpoint_route_ptr = &(usbd_control_ctx.routing_table.endpoint[idx]);
+        if (((endpoint_route_ptr->interface) == interface_ptr) && (((usbd_control_ctx.endpoint_halt_mask >> idx) & 0x01) != 0)) {
+            status = USBD_HW_clear_stall((USB_physical_endpoint_t*) ((endpoint_route_ptr->endpoint)->physical_endpoint));
+            if (status != USB_SUCCESS) goto errors;
+            usbd_control_ctx.endpoint_halt_mask &= ~(((uint32_t) 1) << idx);
+        }
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_standard_request_callback(USB_request_t* request, USB_data_t* data_out, USB_data_t* data_in) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint8_t wValue_high = (uint8_t) ((request->wValue >> 8) & 0xFF);
+    uint8_t wValue_low = (uint8_t) ((request->wValue >> 0) & 0xFF);
+    uint8_t wIndex_low = (uint8_t) ((request->wIndex >> 0) & 0xFF);
+    // Unused parameter.
+    UNUSED(data_out);
+    // Check request.
+    switch (request->bRequest) {
+    case USB_REQUEST_GET_STATUS:
+        status = _USBD_CONTROL_get_status(request, data_in);
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    case USB_REQUEST_CLEAR_FEATURE:
+        status = _USBD_CONTROL_set_feature(request, 0);
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    case USB_REQUEST_SET_FEATURE:
+        status = _USBD_CONTROL_set_feature(request, 1);
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    case USB_REQUEST_GET_DESCRIPTOR:
+        // Read descriptor.
+        status = _USBD_CONTROL_get_descriptor(wValue_high, wValue_low, (request->wIndex), &(data_in->data), &(data_in->size_bytes));
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    case USB_REQUEST_SET_ADDRESS:
+        // Check address.
+        if (wValue_low > USBD_CONTROL_DEVICE_ADDRESS_MAX) {
+            status = USB_ERROR_STANDARD_REQUEST;
+            goto errors;
+        }
+        // Address is applied on hardware side once the status stage is complete.
+        usbd_control_ctx.device_address = wValue_low;
+        usbd_control_ctx.flags.address_pending = 1;
+        break;
+    case USB_REQUEST_GET_CONFIGURATION:
+        usbd_control_ctx.standard_data_in[0] = usbd_control_ctx.configuration_value;
+        data_in->data = usbd_control_ctx.standard_data_in;
+        data_in->size_bytes = 1;
+        break;
+    case USB_REQUEST_SET_CONFIGURATION:
+        status = _USBD_CONTROL_set_configuration(wValue_low);
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    case USB_REQUEST_GET_INTERFACE:
+        // Check interface.
+        if ((wIndex_low >= USBD_CONTROL_ROUTING_INTERFACES_MAX) || (usbd_control_ctx.routing_table.interface[wIndex_low] == NULL)) {
+            status = USB_ERROR_INTERFACE_NUMBER;
+            goto errors;
+        }
+        usbd_control_ctx.standard_data_in[0] = usbd_control_ctx.alternate_setting[wIndex_low];
+        data_in->data = usbd_control_ctx.standard_data_in;
+        data_in->size_bytes = 1;
+        break;
+    case USB_REQUEST_SET_INTERFACE:
+        status = _USBD_CONTROL_set_interface(wIndex_low, wValue_low);
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    default:
+        status = USB_ERROR_STANDARD_REQUEST;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static void _USBD_CONTROL_update_request_operation(void) {
+    // Local variables.
+    USB_request_t* request_ptr;
+    // Reset setup request operation.
+    usbd_control_ctx.request_operation = USB_REQUEST_OPERATION_NOT_SUPPORTED;
+    // Cast frame.
+    request_ptr = &(usbd_control_ctx.request);
+    // Compute transfer type.
+    if ((request_ptr->wLength) == 0) {
+        usbd_control_ctx.request_operation = USB_REQUEST_OPERATION_WRITE_NO_DATA;
+    }
+    else {
+        if (((request_ptr->bmRequestType).direction) == USB_REQUEST_DIRECTION_HOST_TO_DEVICE) {
+            usbd_control_ctx.request_operation = USB_REQUEST_OPERATION_WRITE;
+        }
+        else {
+            usbd_control_ctx.request_operation = USB_REQUEST_OPERATION_READ;
+        }
+    }
+}
+
+/*******************************************************************/
+#define _USBD_CONTROL_get_vendor_request_key(bRequest, recipient, direction) ((uint16_t) (((bRequest) << 8) | ((recipient) << 1) | (direction)))
+
+/*******************************************************************/
+static uint8_t _USBD_CONTROL_search_vendor_request(uint16_t key, uint8_t* index) {
+    // Local variables.
+    uint8_t found = 0;
+    uint8_t low = 0;
+    uint8_t high = usbd_control_ctx.number_of_vendor_requests;
+    uint8_t middle = 0;
+    uint16_t middle_key = 0;
+    const USBD_CONTROL_vendor_request_t* vendor_request_ptr = NULL;
+    // Binary search in the sorted table.
+    while (low < high) {
+        middle = (uint8_t) ((low + high) >> 1);
+        vendor_request_ptr = usbd_control_ctx.vendor_request_table[middle];
+        middle_key = _USBD_CONTROL_get_vendor_request_key(vendor_request_ptr->bRequest, vendor_request_ptr->recipient, vendor_request_ptr->direction);
+        if (middle_key == key) {
+            found = 1;
+            low = middle;
+            break;
+        }
+        if (middle_key < key) {
+            low = (uint8_t) (middle + 1);
+        }
+        else {
+            high = middle;
+        }
+    }
+    // Index of the handler, or insertion index when not found.
+    (*index) = low;
+    return found;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_select_vendor_request(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    const USBD_CONTROL_vendor_request_t* vendor_request_ptr = NULL;
+    USB_request_t* request_ptr = &(usbd_control_ctx.request);
+    uint16_t key = 0;
+    uint8_t index = 0;
+    // Reset handler.
+    usbd_control_ctx.vendor_request = NULL;
+    // Check type.
+    if ((request_ptr->bmRequestType.type) != USB_REQUEST_TYPE_VENDOR) goto errors;
+    // Search handler (requests without handler are given to the generic vendor callback).
+    key = _USBD_CONTROL_get_vendor_request_key(request_ptr->bRequest, request_ptr->bmRequestType.recipient, request_ptr->bmRequestType.direction);
+    if (_USBD_CONTROL_search_vendor_request(key, &index) == 0) goto errors;
+    vendor_request_ptr = usbd_control_ctx.vendor_request_table[index];
+    // Reject oversize request before any data stage.
+    if ((request_ptr->wLength) > (vendor_request_ptr->max_length)) {
+        status = USB_ERROR_REQUEST_SIZE;
+        goto errors;
+    }
+    usbd_control_ctx.vendor_request = vendor_request_ptr;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_decode_request(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_request_cb_t request_callback = NULL;
+    USBD_CONTROL_endpoint_route_t* endpoint_route_ptr = NULL;
+    uint8_t endpoint_route_index = 0;
+    uint8_t wIndex_low = 0;
+    USB_request_t* request_ptr;
+    // Reset output data.
+    usbd_control_ctx.data_in.data = NULL;
+    usbd_control_ctx.data_in.size_bytes = 0;
+    usbd_control_ctx.flags.data_in_serialized = 0;
+    usbd_control_ctx.flags.data_in_other_speed = 0;
+    // Cast frame.
+    request_ptr = &(usbd_control_ctx.request);
+    // Check type.
+    switch (request_ptr->bmRequestType.type) {
+    case USB_REQUEST_TYPE_STANDARD:
+        // Decode standard request.
+        status = _USBD_CONTROL_standard_request_callback(request_ptr, &usbd_control_ctx.data_out, &(usbd_control_ctx.data_in));
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    case USB_REQUEST_TYPE_CLASS:
+        wIndex_low = (uint8_t) ((request_ptr->wIndex) & 0x00FF);
+        // Search corresponding callback in routing table.
+        switch (request_ptr->bmRequestType.recipient) {
+        case USB_REQUEST_RECIPIENT_INTERFACE:
+            if (wIndex_low >= USBD_CONTROL_ROUTING_INTERFACES_MAX) {
+                status = USB_ERROR_INTERFACE_NUMBER;
+                goto errors;
+            }
+            if (usbd_control_ctx.routing_table.interface[wIndex_low] != NULL) {
+                request_callback = (usbd_control_ctx.routing_table.interface[wIndex_low])->request_callback;
+            }
+            break;
+        case USB_REQUEST_RECIPIENT_ENDPOINT:
+            status = _USBD_CONTROL_get_endpoint_route(wIndex_low, &endpoint_route_ptr, &endpoint_route_index);
+            if (status != USB_SUCCESS) goto errors;
+            request_callback = (endpoint_route_ptr->interface)->request_callback;
+            break;
+        default:
+            status = USB_ERROR_REQUEST_RECIPIENT;
+            goto errors;
+        }
+        // Check request callback.
+        if (request_callback == NULL) {
+            status = USB_ERROR_CLASS_REQUEST;
+            goto errors;
+        }
+        // Execute class specific callback.
+        status = request_callback(request_ptr, &usbd_control_ctx.data_out, &(usbd_control_ctx.data_in));
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    case USB_REQUEST_TYPE_VENDOR:
+        // Execute registered handler.
+        if (usbd_control_ctx.vendor_request != NULL) {
+            status = usbd_control_ctx.vendor_request->callback(request_ptr, &usbd_control_ctx.data_out, &(usbd_control_ctx.data_in));
+            if (status != USB_SUCCESS) goto errors;
+            break;
+        }
+        // Check vendor callback.
+        if (usbd_control_ctx.callbacks->vendor_request == NULL) {
+            status = USB_ERROR_VENDOR_REQUEST;
+            goto errors;
+        }
+        // Execute external callback.
+        status = usbd_control_ctx.callbacks->vendor_request(request_ptr, &usbd_control_ctx.data_out, &(usbd_control_ctx.data_in));
+        if (status != USB_SUCCESS) goto errors;
+        break;
+    default:
+        status = USB_ERROR_REQUEST_TYPE;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_write_next_packet(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_data_t packet;
+    uint32_t remaining_size_bytes = ((usbd_control_ctx.data_in.size_bytes) - (usbd_control_ctx.data_in_index));
+    uint32_t idx = 0;
+#ifndef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+    USBD_CONTROL_serializer_t serializer_backup = usbd_control_ctx.serializer;
+#endif
+    // Compute packet size.
+    packet.data = (usbd_control_ctx.data_in.data == NULL) ? NULL : &(usbd_control_ctx.data_in.data[usbd_control_ctx.data_in_index]);
+    packet.size_bytes = (remaining_size_bytes > USBD_CONTROL_PACKET_SIZE_BYTES) ? USBD_CONTROL_PACKET_SIZE_BYTES : remaining_size_bytes;
+#ifndef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+    // Produce serialized bytes on the fly (the serializer position is restored if the packet is not sent).
+    if (usbd_control_ctx.flags.data_in_serialized != 0) {
+        status = _USBD_CONTROL_serializer_read(usbd_control_ctx.ep0_buffer, packet.size_bytes);
+        if (status != USB_SUCCESS) goto errors;
+        packet.data = usbd_control_ctx.ep0_buffer;
+    }
+#endif
+    // Other speed configuration only differs from the configuration descriptor by its type.
+    if ((usbd_control_ctx.flags.data_in_other_speed != 0) && (usbd_control_ctx.data_in_index == 0) && ((packet.size_bytes) > USBD_CONTROL_DESCRIPTOR_TYPE_INDEX)) {
+        if (packet.data != usbd_control_ctx.ep0_buffer) {
+            for (idx = 0; idx < (packet.size_bytes); idx++) {
+                usbd_control_ctx.ep0_buffer[idx] = packet.data[idx];
+            }
+            packet.data = usbd_control_ctx.ep0_buffer;
+        }
+        usbd_control_ctx.ep0_buffer[USBD_CONTROL_DESCRIPTOR_TYPE_INDEX] = USB_DESCRIPTOR_TYPE_OTHER_SPEED_CONFIGURATION;
+    }
+    // Send packet.
+    status = USBD_write_data((USB_physical_endpoint_t*) &USBD_CONTROL_EP_PHY_IN, &packet);
+    if (status != USB_SUCCESS) {
+#ifndef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+        usbd_control_ctx.serializer = serializer_backup;
+#endif
+        goto errors;
+    }
+    // Update index.
+    usbd_control_ctx.data_in_index += (packet.size_bytes);
+    // Zero length packet is sent only once.
+    if ((packet.size_bytes) == 0) {
+        usbd_control_ctx.flags.zlp_pending = 0;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_stall(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Drop any pending action of the aborted transfer.
+    usbd_control_ctx.stage = USBD_CONTROL_STAGE_STALL;
+    usbd_control_ctx.flags.address_pending = 0;
+    // Stall both directions of the control pipe until the next setup packet.
+    status = USBD_HW_set_stall((USB_physical_endpoint_t*) &USBD_CONTROL_EP_PHY_IN);
+    if (status != USB_SUCCESS) goto errors;
+    status = USBD_HW_set_stall((USB_physical_endpoint_t*) &USBD_CONTROL_EP_PHY_OUT);
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_abort_transfer(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Release protocol stall.
+    if (usbd_control_ctx.stage == USBD_CONTROL_STAGE_STALL) {
+        status = USBD_HW_clear_stall((USB_physical_endpoint_t*) &USBD_CONTROL_EP_PHY_IN);
+        if (status != USB_SUCCESS) goto errors;
+        status = USBD_HW_clear_stall((USB_physical_endpoint_t*) &USBD_CONTROL_EP_PHY_OUT);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    // Reset transfer state.
+    usbd_control_ctx.stage = USBD_CONTROL_STAGE_IDLE;
+    usbd_control_ctx.flags.zlp_pending = 0;
+    usbd_control_ctx.flags.data_in_serialized = 0;
+    usbd_control_ctx.flags.data_in_other_speed = 0;
+    usbd_control_ctx.flags.address_pending = 0;
+    usbd_control_ctx.data_in_index = 0;
+    usbd_control_ctx.data_out_index = 0;
+    usbd_control_ctx.data_out.data = NULL;
+    usbd_control_ctx.data_out.size_bytes = 0;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_notify_bus_event(USB_bus_event_t bus_event) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_status_t interface_status = USB_SUCCESS;
+    const USB_interface_t* interface_ptr = NULL;
+    uint8_t idx = 0;
+    // Notify all configured interfaces even if one of them fails.
+    for (idx = 0; idx < USBD_CONTROL_ROUTING_INTERFACES_MAX; idx++) {
+        interface_ptr = usbd_control_ctx.routing_table.interface[idx];
+        if ((interface_ptr != NULL) && (interface_ptr->bus_event_callback != NULL)) {
+            interface_status = interface_ptr->bus_event_callback(bus_event);
+            // Keep first error.
+            if (status == USB_SUCCESS) {
+                status = interface_status;
+            }
+        }
+    }
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_reset_device(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint8_t configuration_value = usbd_control_ctx.configuration_value;
+    // Pending transfer is lost and the protocol stall has already been released by the peripheral.
+    usbd_control_ctx.stage = USBD_CONTROL_STAGE_IDLE;
+    status = _USBD_CONTROL_abort_transfer();
+    if (status != USB_SUCCESS) goto errors;
+    // Return to the default state.
+    usbd_control_ctx.device_address = 0;
+    usbd_control_ctx.flags.remote_wakeup_enabled = 0;
+    usbd_control_ctx.configuration_value = 0;
+    _USBD_CONTROL_reset_routing_table();
+    // Notify the application that the configuration has been dropped.
+    if (configuration_value != 0) {
+        status = usbd_control_ctx.callbacks->set_configuration_request(0);
+        if (status != USB_SUCCESS) goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_answer_request(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_data_t status_packet;
+    uint32_t size_bytes = 0;
+    // Clamp data size according to request.
+    if ((usbd_control_ctx.data_in.size_bytes) > (usbd_control_ctx.request.wLength)) {
+        usbd_control_ctx.data_in.size_bytes = (usbd_control_ctx.request.wLength);
+    }
+    _USBD_CONTROL_latency_record(USBD_CONTROL_LATENCY_STAGE_CALLBACK);
+    // Check if there is an IN data stage.
+    if (usbd_control_ctx.request_operation == USB_REQUEST_OPERATION_READ) {
+        size_bytes = usbd_control_ctx.data_in.size_bytes;
+        // A zero length packet ends the data stage when it is shorter than requested and ends on a packet boundary.
+        usbd_control_ctx.flags.zlp_pending = ((size_bytes < (usbd_control_ctx.request.wLength)) && ((size_bytes % USBD_CONTROL_PACKET_SIZE_BYTES) == 0)) ? 1 : 0;
+        usbd_control_ctx.data_in_index = 0;
+        usbd_control_ctx.stage = USBD_CONTROL_STAGE_DATA_IN;
+        // Send first packet.
+        status = _USBD_CONTROL_write_next_packet();
+        if (status != USB_SUCCESS) goto errors;
+    }
+    else {
+        // Acknowledge request with a zero length packet.
+        usbd_control_ctx.stage = USBD_CONTROL_STAGE_STATUS_IN;
+        status_packet.data = NULL;
+        status_packet.size_bytes = 0;
+        status = USBD_write_data((USB_physical_endpoint_t*) &USBD_CONTROL_EP_PHY_IN, &status_packet);
+        if (status != USB_SUCCESS) goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_process_request(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Decode request.
+    usbd_control_ctx.flags.request_callback = 1;
+    status = _USBD_CONTROL_decode_request();
+    usbd_control_ctx.flags.request_callback = 0;
+    if (status != USB_SUCCESS) goto errors;
+    // Check if the callback will complete the request later.
+    if (usbd_control_ctx.stage == USBD_CONTROL_STAGE_DEFERRED) {
+        // Hold the data or status stage until completion.
+        status = USBD_HW_set_control_status_pending();
+        goto errors;
+    }
+    // Start data or status stage.
+    status = _USBD_CONTROL_answer_request();
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    // Do not keep a deferred request that the peripheral cannot hold.
+    if ((status != USB_SUCCESS) && (usbd_control_ctx.stage == USBD_CONTROL_STAGE_DEFERRED)) {
+        usbd_control_ctx.stage = USBD_CONTROL_STAGE_IDLE;
+    }
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_enter_critical(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Prevent a new setup packet from being processed.
+    status = USBD_HW_enter_critical();
+    // Peripherals without critical section run the whole stack in a single context.
+    if (status == USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED) {
+        status = USB_SUCCESS;
+    }
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_exit_critical(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Allow setup packets processing.
+    status = USBD_HW_exit_critical();
+    if (status == USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED) {
+        status = USB_SUCCESS;
+    }
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_insert_vendor_request(const USBD_CONTROL_vendor_request_t* vendor_request) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint16_t key = 0;
+    uint8_t index = 0;
+    uint8_t idx = 0;
+    // Check table.
+    if ((usbd_control_ctx.number_of_vendor_requests) >= USBD_CONTROL_VENDOR_REQUESTS_MAX) {
+        status = USB_ERROR_VENDOR_REQUEST_TABLE_FULL;
+        goto errors;
+    }
+    // Search insertion index.
+    key = _USBD_CONTROL_get_vendor_request_key(vendor_request->bRequest, vendor_request->recipient, vendor_request->direction);
+    if (_USBD_CONTROL_search_vendor_request(key, &index) != 0) {
+        status = USB_ERROR_VENDOR_REQUEST_ALREADY_REGISTERED;
+        goto errors;
+    }
+    // Keep table sorted.
+    for (idx = (usbd_control_ctx.number_of_vendor_requests); idx > index; idx--) {
+        usbd_control_ctx.vendor_request_table[idx] = usbd_control_ctx.vendor_request_table[idx - 1];
+    }
+    usbd_control_ctx.vendor_request_table[index] = vendor_request;
+    usbd_control_ctx.number_of_vendor_requests++;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_remove_vendor_request(const USBD_CONTROL_vendor_request_t* vendor_request) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint16_t key = 0;
+    uint8_t index = 0;
+    uint8_t idx = 0;
+    // Search handler.
+    key = _USBD_CONTROL_get_vendor_request_key(vendor_request->bRequest, vendor_request->recipient, vendor_request->direction);
+    if ((_USBD_CONTROL_search_vendor_request(key, &index) == 0) || ((usbd_control_ctx.vendor_request_table[index]) != vendor_request)) {
+        status = USB_ERROR_VENDOR_REQUEST_NOT_REGISTERED;
+        goto errors;
+    }
+    // The handler of a transfer in progress will still be called.
+    if ((usbd_control_ctx.vendor_request == vendor_request) && (usbd_control_ctx.stage != USBD_CONTROL_STAGE_IDLE) && (usbd_control_ctx.stage != USBD_CONTROL_STAGE_STALL)) {
+        status = USB_ERROR_VENDOR_REQUEST_ACTIVE;
+        goto errors;
+    }
+    // Keep table sorted.
+    usbd_control_ctx.number_of_vendor_requests--;
+    for (idx = index; idx < (usbd_control_ctx.number_of_vendor_requests); idx++) {
+        usbd_control_ctx.vendor_request_table[idx] = usbd_control_ctx.vendor_request_table[idx + 1];
+    }
+    // Drop selection of the last request.
+    if (usbd_control_ctx.vendor_request == vendor_request) {
+        usbd_control_ctx.vendor_request = NULL;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_CONTROL_check_deferred_request(uint32_t request_tag) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // The request must still be the deferred one (a new setup packet aborts it) and its callback must have returned.
+    if ((usbd_control_ctx.stage != USBD_CONTROL_STAGE_DEFERRED) || (usbd_control_ctx.flags.request_callback != 0) || (usbd_control_ctx.request_tag != request_tag)) {
+        status = USB_ERROR_NO_DEFERRED_REQUEST;
+        goto errors;
     }
 errors:
     return status;
@@ -498,17 +1656,32 @@ errors:
 static void _USBD_CONTROL_setup_callback(USB_request_operation_t* setup_request_type) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
+    // Timestamp setup reception.
+    _USBD_CONTROL_latency_setup();
     // Check parameter.
     if (setup_request_type == NULL) goto errors;
     // Reset request type.
     (*setup_request_type) = USB_REQUEST_OPERATION_NOT_SUPPORTED;
-    // Check if there is no pending request.
-    if ((usbd_control_ctx.flags.in_request_pending != 0) || (usbd_control_ctx.flags.out_request_pending != 0)) goto errors;
+    // A new setup packet aborts any transfer in progress (including deferred requests).
+    status = _USBD_CONTROL_abort_transfer();
+    if (status != USB_SUCCESS) goto errors;
+    usbd_control_ctx.request_tag++;
     // Read setup bytes.
-    status = USBD_HW_read_setup(&usbd_control_ctx.setup_out);
+    status = USBD_read_setup(&usbd_control_ctx.setup_out);
     if (status != USB_SUCCESS) goto errors;
+    // Check data size.
+    if ((usbd_control_ctx.setup_out.size_bytes) < sizeof(USB_request_t)) {
+        status = USB_ERROR_REQUEST_SIZE;
+        goto errors;
+    }
+    // Copy request since the hardware setup buffer can be overwritten during the data stage.
+    usbd_control_ctx.request = *((USB_request_t*) (usbd_control_ctx.setup_out.data));
+    _USBD_CONTROL_latency_select_request();
     // Update request operation.
     _USBD_CONTROL_update_request_operation();
+    // Find vendor handler before any data stage.
+    status = _USBD_CONTROL_select_vendor_request();
+    if (status != USB_SUCCESS) goto errors;
     // Check request type.
     switch (usbd_control_ctx.request_operation) {
     case USB_REQUEST_OPERATION_READ:
@@ -518,41 +1691,134 @@ static void _USBD_CONTROL_setup_callback(USB_request_operation_t* setup_request_
         if (status != USB_SUCCESS) goto errors;
         break;
     case USB_REQUEST_OPERATION_WRITE:
+        // Check OUT data size.
+        if ((usbd_control_ctx.request.wLength) > USBD_CONTROL_DATA_OUT_BUFFER_SIZE_BYTES) {
+            status = USB_ERROR_REQUEST_SIZE;
+            goto errors;
+        }
         // Wait for OUT data before processing request.
-        usbd_control_ctx.flags.out_request_pending = 1;
+        usbd_control_ctx.stage = USBD_CONTROL_STAGE_DATA_OUT;
         break;
     default:
-        break;
+        status = USB_ERROR_REQUEST_TYPE;
+        goto errors;
     }
     // Update output parameter.
     (*setup_request_type) = usbd_control_ctx.request_operation;
 errors:
+    // Protocol stall on unsupported or failed request.
+    if (status != USB_SUCCESS) {
+        _USBD_CONTROL_stall();
+    }
     return;
 }
 
 /*******************************************************************/
-static void _USBD_CONTROL_endpoint_out_callback(void) {
+static void _USBD_CONTROL_endpoint_out_callback(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
-    // Check flag.
-    if (usbd_control_ctx.flags.out_request_pending != 0) {
-        // Read OUT data bytes.
-        status = USBD_HW_read_data((USB_physical_endpoint_t*) &USBD_CONTROL_EP_PHY_OUT, &usbd_control_ctx.data_out);
+    USB_data_t packet;
+    uint32_t idx = 0;
+    // Unused parameter.
+    UNUSED(frame_number);
+    // Check stage.
+    switch (usbd_control_ctx.stage) {
+    case USBD_CONTROL_STAGE_DATA_IN:
+        // The host can end the IN data stage early by starting the status stage.
+    case USBD_CONTROL_STAGE_STATUS_OUT:
+        // Release the zero length packet.
+        status = USBD_read_data(physical_endpoint, &packet);
+        if (status != USB_SUCCESS) goto errors;
+        _USBD_CONTROL_latency_record(USBD_CONTROL_LATENCY_STAGE_STATUS);
+        usbd_control_ctx.stage = USBD_CONTROL_STAGE_IDLE;
+        break;
+    case USBD_CONTROL_STAGE_DATA_OUT:
+        // Read OUT packet.
+        status = USBD_read_data(physical_endpoint, &packet);
         if (status != USB_SUCCESS) goto errors;
+        // Check transfer status.
+        if ((transfer_status == USB_ENDPOINT_TRANSFER_STATUS_OVERRUN) || (transfer_status == USB_ENDPOINT_TRANSFER_STATUS_ERROR)) {
+            status = USB_ERROR_ENDPOINT_TRANSFER;
+            goto errors;
+        }
+        // Check size (given by the completion event).
+        if (size_bytes > (packet.size_bytes)) {
+            status = USB_ERROR_ENDPOINT_PACKET_SIZE;
+            goto errors;
+        }
+        if (((usbd_control_ctx.data_out_index) + size_bytes) > (usbd_control_ctx.request.wLength)) {
+            status = USB_ERROR_REQUEST_SIZE;
+            goto errors;
+        }
+        // Append packet.
+        for (idx = 0; idx < size_bytes; idx++) {
+            usbd_control_ctx.ep0_buffer[usbd_control_ctx.data_out_index++] = packet.data[idx];
+        }
+        // Wait for next packet until all bytes or a short packet are received.
+        if ((size_bytes == USBD_CONTROL_PACKET_SIZE_BYTES) && ((usbd_control_ctx.data_out_index) < (usbd_control_ctx.request.wLength))) goto errors;
+        // Update OUT data.
+        usbd_control_ctx.data_out.data = usbd_control_ctx.ep0_buffer;
+        usbd_control_ctx.data_out.size_bytes = usbd_control_ctx.data_out_index;
+        _USBD_CONTROL_latency_record(USBD_CONTROL_LATENCY_STAGE_DATA);
         // Process request.
         status = _USBD_CONTROL_process_request();
         if (status != USB_SUCCESS) goto errors;
+        break;
+    default:
+        // Packet does not belong to any transfer.
+        break;
     }
 errors:
-    // Clear flag.
-    usbd_control_ctx.flags.out_request_pending = 0;
+    // Abort transfer on error.
+    if (status != USB_SUCCESS) {
+        _USBD_CONTROL_stall();
+    }
     return;
 }
 
 /*******************************************************************/
-static void _USBD_CONTROL_endpoint_in_callback(void) {
-    // Clear flag.
-    usbd_control_ctx.flags.in_request_pending = 0;
+static void _USBD_CONTROL_endpoint_in_callback(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Unused parameters.
+    UNUSED(physical_endpoint);
+    UNUSED(size_bytes);
+    UNUSED(transfer_status);
+    UNUSED(frame_number);
+    // Check stage.
+    switch (usbd_control_ctx.stage) {
+    case USBD_CONTROL_STAGE_DATA_IN:
+        // Check if there are remaining bytes or a zero length packet to send.
+        if (((usbd_control_ctx.data_in_index) < (usbd_control_ctx.data_in.size_bytes)) || (usbd_control_ctx.flags.zlp_pending != 0)) {
+            status = _USBD_CONTROL_write_next_packet();
+            if (status != USB_SUCCESS) goto errors;
+        }
+        else {
+            // Data stage is complete.
+            _USBD_CONTROL_latency_record(USBD_CONTROL_LATENCY_STAGE_DATA);
+            usbd_control_ctx.stage = USBD_CONTROL_STAGE_STATUS_OUT;
+        }
+        break;
+    case USBD_CONTROL_STAGE_STATUS_IN:
+        _USBD_CONTROL_latency_record(USBD_CONTROL_LATENCY_STAGE_STATUS);
+        usbd_control_ctx.stage = USBD_CONTROL_STAGE_IDLE;
+        // The new address must only be used after the status stage of the SET_ADDRESS request.
+        if (usbd_control_ctx.flags.address_pending != 0) {
+            usbd_control_ctx.flags.address_pending = 0;
+            status = USBD_HW_set_address(usbd_control_ctx.device_address);
+            if (status != USB_SUCCESS) goto errors;
+        }
+        break;
+    default:
+        // Packet does not belong to any transfer.
+        break;
+    }
+errors:
+    // Abort transfer on error.
+    if (status != USB_SUCCESS) {
+        _USBD_CONTROL_stall();
+    }
+    return;
 }
 
 /*** USB functions ***/
@@ -561,6 +1827,7 @@ static void _USBD_CONTROL_endpoint_in_callback(void) {
 USB_status_t USBD_CONTROL_init(const USB_device_t* device, USBD_CONTROL_callbacks_t* control_callbacks) {
     // Local variables.
     USB_status_t status = USB_SUCCESS;
+    uint32_t descriptor_size_bytes = 0;
     uint8_t idx = 0;
     // Check parameter.
     if ((device == NULL) || (control_callbacks == NULL)) {
@@ -574,9 +1841,32 @@ USB_status_t USBD_CONTROL_init(const USB_device_t* device, USBD_CONTROL_callback
     }
     // Reset flags.
     usbd_control_ctx.flags.all = 0;
+    usbd_control_ctx.stage = USBD_CONTROL_STAGE_IDLE;
+    // Class requests are not routed until a configuration is selected.
+    usbd_control_ctx.configuration_value = 0;
+    _USBD_CONTROL_reset_routing_table();
+    usbd_control_ctx.number_of_vendor_requests = 0;
+    usbd_control_ctx.vendor_request = NULL;
     // Register device and callbacks.
     usbd_control_ctx.device = device;
     usbd_control_ctx.callbacks = control_callbacks;
+    // Check string descriptors which are encoded on request.
+    if ((device->number_of_languages) != 0) {
+        status = _USBD_CONTROL_build_langid_descriptor(&descriptor_size_bytes);
+        if (status != USB_SUCCESS) goto errors;
+        status = _USBD_CONTROL_build_serial_number_descriptor(&descriptor_size_bytes);
+        if (status != USB_SUCCESS) goto errors;
+    }
+#ifdef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+    // Check the descriptors built by the application.
+    status = _USBD_CONTROL_check_static_descriptors();
+    if (status != USB_SUCCESS) goto errors;
+#endif
+#ifdef USBD_PMA
+    // Lay out packet memory before any endpoint registration.
+    status = USBD_PMA_allocate(device);
+    if (status != USB_SUCCESS) goto errors;
+#endif
     // Register endpoints.
     for (idx = 0; idx < (USBD_CONTROL_INTERFACE.number_of_endpoints); idx++) {
         status = USBD_HW_register_endpoint((USB_physical_endpoint_t*) ((USBD_CONTROL_INTERFACE.endpoint_list)[idx]->physical_endpoint));
@@ -603,8 +1893,13 @@ USB_status_t USBD_CONTROL_de_init(void) {
     }
     // Reset context.
     usbd_control_ctx.flags.all = 0;
+    usbd_control_ctx.stage = USBD_CONTROL_STAGE_IDLE;
     usbd_control_ctx.device = NULL;
     usbd_control_ctx.callbacks = NULL;
+    usbd_control_ctx.configuration_value = 0;
+    _USBD_CONTROL_reset_routing_table();
+    usbd_control_ctx.number_of_vendor_requests = 0;
+    usbd_control_ctx.vendor_request = NULL;
     // Unregister endpoints.
     for (idx = 0; idx < (USBD_CONTROL_INTERFACE.number_of_endpoints); idx++) {
         status = USBD_HW_unregister_endpoint((USB_physical_endpoint_t*) ((USBD_CONTROL_INTERFACE.endpoint_list)[idx]->physical_endpoint));
@@ -616,4 +1911,278 @@ errors:
     return status;
 }
 
+/*******************************************************************/
+USB_status_t USBD_CONTROL_defer_request(uint32_t* request_tag) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (request_tag == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Check state.
+    if (usbd_control_ctx.flags.request_callback == 0) {
+        status = USB_ERROR_NO_DEFERRED_REQUEST;
+        goto errors;
+    }
+    // Data or status stage will be started by the completion.
+    usbd_control_ctx.stage = USBD_CONTROL_STAGE_DEFERRED;
+    (*request_tag) = usbd_control_ctx.request_tag;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CONTROL_complete_request(uint32_t request_tag, USB_data_t* data_in) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_status_t critical_status = USB_SUCCESS;
+    // Check parameter.
+    if ((usbd_control_ctx.request_operation == USB_REQUEST_OPERATION_READ) && (data_in == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // A new setup packet must not be processed between the check and the data stage start.
+    status = _USBD_CONTROL_enter_critical();
+    if (status != USB_SUCCESS) goto errors;
+    status = _USBD_CONTROL_check_deferred_request(request_tag);
+    if (status == USB_SUCCESS) {
+        // Check if there is an IN data stage.
+        if (usbd_control_ctx.request_operation == USB_REQUEST_OPERATION_READ) {
+            usbd_control_ctx.data_in.data = (data_in->data);
+            usbd_control_ctx.data_in.size_bytes = (data_in->size_bytes);
+        }
+        // Start data or status stage.
+        status = _USBD_CONTROL_answer_request();
+        if (status != USB_SUCCESS) {
+            _USBD_CONTROL_stall();
+        }
+    }
+    critical_status = _USBD_CONTROL_exit_critical();
+    if (status == USB_SUCCESS) {
+        status = critical_status;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CONTROL_fail_request(uint32_t request_tag) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_status_t critical_status = USB_SUCCESS;
+    // A new setup packet must not be stalled by an old completion.
+    status = _USBD_CONTROL_enter_critical();
+    if (status != USB_SUCCESS) goto errors;
+    status = _USBD_CONTROL_check_deferred_request(request_tag);
+    if (status == USB_SUCCESS) {
+        // Stall both directions of the control pipe until the next setup packet.
+        status = _USBD_CONTROL_stall();
+    }
+    critical_status = _USBD_CONTROL_exit_critical();
+    if (status == USB_SUCCESS) {
+        status = critical_status;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CONTROL_register_vendor_request(const USBD_CONTROL_vendor_request_t* vendor_request) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_status_t critical_status = USB_SUCCESS;
+    // Check parameters.
+    if ((vendor_request == NULL) || ((vendor_request->callback) == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if ((vendor_request->recipient) >= USB_REQUEST_RECIPIENT_LAST) {
+        status = USB_ERROR_REQUEST_RECIPIENT;
+        goto errors;
+    }
+    if ((vendor_request->direction) >= USB_REQUEST_DIRECTION_LAST) {
+        status = USB_ERROR_REQUEST_TYPE;
+        goto errors;
+    }
+    // Check state.
+    if (usbd_control_ctx.flags.init == 0) {
+        status = USB_ERROR_UNINITIALIZED;
+        goto errors;
+    }
+    // The table must not be searched by the setup callback while it is shifted.
+    status = _USBD_CONTROL_enter_critical();
+    if (status != USB_SUCCESS) goto errors;
+    status = _USBD_CONTROL_insert_vendor_request(vendor_request);
+    critical_status = _USBD_CONTROL_exit_critical();
+    if (status == USB_SUCCESS) {
+        status = critical_status;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CONTROL_unregister_vendor_request(const USBD_CONTROL_vendor_request_t* vendor_request) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_status_t critical_status = USB_SUCCESS;
+    // Check parameter.
+    if (vendor_request == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // The table must not be searched by the setup callback while it is shifted.
+    status = _USBD_CONTROL_enter_critical();
+    if (status != USB_SUCCESS) goto errors;
+    status = _USBD_CONTROL_remove_vendor_request(vendor_request);
+    critical_status = _USBD_CONTROL_exit_critical();
+    if (status == USB_SUCCESS) {
+        status = critical_status;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CONTROL_get_speed(USB_speed_t* speed) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (speed == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Read speed negotiated during last bus reset.
+    status = USBD_HW_get_speed(speed);
+    // Peripherals which do not report the speed are full speed.
+    if (status == USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED) {
+        (*speed) = USB_SPEED_FULL;
+        status = USB_SUCCESS;
+    }
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CONTROL_bus_event(USB_bus_event_t bus_event) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_status_t reset_status = USB_SUCCESS;
+    // Check parameter.
+    if (bus_event >= USB_BUS_EVENT_LAST) {
+        status = USB_ERROR_BUS_EVENT;
+        goto errors;
+    }
+    // Check state.
+    if (usbd_control_ctx.flags.init == 0) {
+        status = USB_ERROR_UNINITIALIZED;
+        goto errors;
+    }
+    // Let classes stop or restore their streams while the routes are still valid.
+    // Configuration and alternate settings are kept across suspend so that streaming restarts without enumeration.
+    status = _USBD_CONTROL_notify_bus_event(bus_event);
+    // Reset always returns the device to the default state.
+    if (bus_event == USB_BUS_EVENT_RESET) {
+        reset_status = _USBD_CONTROL_reset_device();
+        if (status == USB_SUCCESS) {
+            status = reset_status;
+        }
+    }
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CONTROL_sof(uint16_t frame_number) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_status_t interface_status = USB_SUCCESS;
+    const USB_interface_t* interface_ptr = NULL;
+    uint8_t idx = 0;
+    // Check state.
+    if (usbd_control_ctx.flags.init == 0) {
+        status = USB_ERROR_UNINITIALIZED;
+        goto errors;
+    }
+    // Notify all configured interfaces even if one of them fails.
+    for (idx = 0; idx < USBD_CONTROL_ROUTING_INTERFACES_MAX; idx++) {
+        interface_ptr = usbd_control_ctx.routing_table.interface[idx];
+        if ((interface_ptr != NULL) && (interface_ptr->sof_callback != NULL)) {
+            interface_status = interface_ptr->sof_callback(frame_number);
+            // Keep first error.
+            if (status == USB_SUCCESS) {
+                status = interface_status;
+            }
+        }
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CONTROL_invalidate_descriptor_cache(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+#ifndef USBD_CONTROL_STATIC_CONFIGURATION_DESCRIPTOR
+    // Force configuration descriptor to be rebuilt on next request.
+    usbd_control_ctx.flags.configuration_descriptor_valid = 0;
+#endif
+    return status;
+}
+
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+/*******************************************************************/
+USB_status_t USBD_CONTROL_get_latency_histogram(USB_request_type_t request_type, uint8_t bRequest, USBD_CONTROL_latency_stage_t stage, const USBD_CONTROL_latency_histogram_t** histogram) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_LATENCY_HISTOGRAM_NOT_FOUND;
+    USBD_CONTROL_latency_entry_t* entry_ptr = NULL;
+    uint8_t idx = 0;
+    // Check parameters.
+    if (histogram == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if (stage >= USBD_CONTROL_LATENCY_STAGE_LAST) {
+        status = USB_ERROR_LATENCY_STAGE;
+        goto errors;
+    }
+    // Search request in table.
+    for (idx = 0; idx < (usbd_control_ctx.latency.number_of_entries); idx++) {
+        entry_ptr = &(usbd_control_ctx.latency.entry[idx]);
+        if (((entry_ptr->request_type) == request_type) && ((entry_ptr->bRequest) == bRequest)) {
+            (*histogram) = &(entry_ptr->histogram[stage]);
+            status = USB_SUCCESS;
+            break;
+        }
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CONTROL_reset_latency_histograms(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    uint8_t idx = 0;
+    uint8_t stage_idx = 0;
+    uint8_t bin_idx = 0;
+    // Entries loop.
+    for (idx = 0; idx < USBD_CONTROL_LATENCY_HISTOGRAM_NUMBER_OF_REQUESTS; idx++) {
+        for (stage_idx = 0; stage_idx < USBD_CONTROL_LATENCY_STAGE_LAST; stage_idx++) {
+            usbd_control_ctx.latency.entry[idx].histogram[stage_idx].count = 0;
+            usbd_control_ctx.latency.entry[idx].histogram[stage_idx].max_cycles = 0;
+            for (bin_idx = 0; bin_idx < USBD_CONTROL_LATENCY_HISTOGRAM_NUMBER_OF_BINS; bin_idx++) {
+                usbd_control_ctx.latency.entry[idx].histogram[stage_idx].bin[bin_idx] = 0;
+            }
+        }
+    }
+    usbd_control_ctx.latency.number_of_entries = 0;
+    usbd_control_ctx.latency.current_entry_index = USBD_CONTROL_LATENCY_ENTRY_INDEX_NONE;
+    return status;
+}
+#endif
+
 #endif /* USB_LIB_DISABLE */
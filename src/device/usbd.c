@@ -10,12 +10,22 @@
 #ifndef USB_LIB_DISABLE_FLAGS_FILE
 #include "usb_lib_flags.h"
 #endif
+#include "common/usb_endpoint.h"
 #include "common/usb_types.h"
+#include "device/standard/usbd_control.h"
+#include "device/usbd_capture.h"
+#include "device/usbd_event.h"
 #include "device/usbd_hw.h"
 #include "types.h"
 
 #ifndef USB_LIB_DISABLE
 
+/*** USBD local macros ***/
+
+#if ((defined USBD_SOF) && ((USBD_SOF_DECIMATION < 1) || (USBD_SOF_DECIMATION > USB_FRAME_NUMBER_MASK)))
+#error "USB library: USBD_SOF_DECIMATION must be between 1 and 2047 frames"
+#endif
+
 /*** USBD local structures ***/
 
 /*******************************************************************/
@@ -23,20 +33,75 @@ typedef union {
     uint8_t all;
     struct {
         uint8_t init :1;
+        uint8_t sof_notified :1;
     } __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed));
 } USBD_flags_t;
 
 /*******************************************************************/
 typedef struct {
     volatile USBD_flags_t flags;
+    USB_bus_event_cb_t bus_event_callback;
+    USB_status_t bus_event_status;
+    uint32_t bus_event_error_count;
+#ifdef USBD_SOF
+    USB_sof_cb_t sof_callback;
+    uint16_t sof_frame_number;
+#endif
 } USBD_context_t;
 
 /*** USBD local global variables ***/
 
 static USBD_context_t usbd_ctx = {
-    .flags.all = 0
+    .flags.all = 0,
+    .bus_event_callback = NULL,
+    .bus_event_status = USB_SUCCESS,
+    .bus_event_error_count = 0,
+#ifdef USBD_SOF
+    .sof_callback = NULL,
+    .sof_frame_number = 0
+#endif
 };
 
+/*** USBD local functions ***/
+
+/*******************************************************************/
+static void _USBD_bus_event_callback(USB_bus_event_t bus_event) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Application powers peripherals up before the classes restore their pipelines.
+    if ((bus_event == USB_BUS_EVENT_RESUME) && (usbd_ctx.bus_event_callback != NULL)) {
+        usbd_ctx.bus_event_callback(bus_event);
+    }
+    // Forward event to the control pipe and the configured classes.
+    status = USBD_CONTROL_bus_event(bus_event);
+    // Failures cannot be returned to the peripheral driver, keep them for the application.
+    if (status != USB_SUCCESS) {
+        usbd_ctx.bus_event_status = status;
+        usbd_ctx.bus_event_error_count++;
+    }
+    // Application powers peripherals down once the classes are quiesced.
+    if ((bus_event != USB_BUS_EVENT_RESUME) && (usbd_ctx.bus_event_callback != NULL)) {
+        usbd_ctx.bus_event_callback(bus_event);
+    }
+}
+
+#ifdef USBD_SOF
+/*******************************************************************/
+static void _USBD_sof_callback(uint16_t frame_number) {
+    // Decimation is computed on the frame number so that microframes and coalesced notifications are counted once.
+    if ((usbd_ctx.flags.sof_notified != 0) && (((frame_number - usbd_ctx.sof_frame_number) & USB_FRAME_NUMBER_MASK) < USBD_SOF_DECIMATION)) goto errors;
+    usbd_ctx.flags.sof_notified = 1;
+    usbd_ctx.sof_frame_number = frame_number;
+    // Forward notification to the configured classes then to the application.
+    USBD_CONTROL_sof(frame_number);
+    if (usbd_ctx.sof_callback != NULL) {
+        usbd_ctx.sof_callback(frame_number);
+    }
+errors:
+    return;
+}
+#endif
+
 /*** USBD functions ***/
 
 /*******************************************************************/
@@ -51,8 +116,28 @@ USB_status_t USBD_init(void) {
     // Init hardware interface.
     status = USBD_HW_init();
     if (status != USB_SUCCESS) goto errors;
+    // Register bus events (optional on peripherals which do not report them).
+    status = USBD_HW_register_bus_event_callback(&_USBD_bus_event_callback);
+    if (status == USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED) {
+        status = USB_SUCCESS;
+    }
+    if (status != USB_SUCCESS) goto errors;
+#ifdef USBD_SOF
+    // Register start of frame notifications (optional on peripherals which do not report them).
+    status = USBD_HW_register_sof_callback(&_USBD_sof_callback);
+    if (status == USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED) {
+        status = USB_SUCCESS;
+    }
+    if (status != USB_SUCCESS) goto errors;
+#endif
     // Init context.
     usbd_ctx.flags.all = 0;
+    usbd_ctx.bus_event_status = USB_SUCCESS;
+    usbd_ctx.bus_event_error_count = 0;
+#ifdef USBD_EVENT_QUEUE
+    status = USBD_EVENT_flush();
+    if (status != USB_SUCCESS) goto errors;
+#endif
     // Update initialization flag.
     usbd_ctx.flags.init = 1;
 errors:
@@ -109,4 +194,129 @@ errors:
     return status;
 }
 
+#ifdef USBD_EVENT_QUEUE
+/*******************************************************************/
+USB_status_t USBD_process(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check state.
+    if (usbd_ctx.flags.init == 0) {
+        status = USB_ERROR_UNINITIALIZED;
+        goto errors;
+    }
+    // Dispatch queued events.
+    status = USBD_EVENT_process(NULL);
+    if (status != USB_SUCCESS) goto errors;
+errors:
+    return status;
+}
+#endif
+
+/*******************************************************************/
+USB_status_t USBD_register_bus_event_callback(USB_bus_event_cb_t bus_event_callback) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Register callback (NULL to unregister).
+    usbd_ctx.bus_event_callback = bus_event_callback;
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_get_bus_event_status(USB_status_t* last_error, uint32_t* error_count) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameters.
+    if ((last_error == NULL) || (error_count == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    (*last_error) = usbd_ctx.bus_event_status;
+    (*error_count) = usbd_ctx.bus_event_error_count;
+errors:
+    return status;
+}
+
+#ifdef USBD_SOF
+/*******************************************************************/
+USB_status_t USBD_register_sof_callback(USB_sof_cb_t sof_callback) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Register callback (NULL to unregister).
+    usbd_ctx.sof_callback = sof_callback;
+    return status;
+}
+#endif
+
+/*******************************************************************/
+USB_status_t USBD_read_setup(USB_data_t* usb_setup_out) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Read setup packet.
+    status = USBD_HW_read_setup(usb_setup_out);
+    if (status != USB_SUCCESS) goto errors;
+    USBD_CAPTURE_transaction(USBD_CAPTURE_TRANSACTION_SETUP, NULL, usb_setup_out, 1);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_read_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Read endpoint.
+    status = USBD_HW_read_data(endpoint, usb_data_out);
+    if (status != USB_SUCCESS) goto errors;
+    USBD_CAPTURE_transaction(USBD_CAPTURE_TRANSACTION_DATA, endpoint, usb_data_out, 1);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_write_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Write endpoint.
+    status = USBD_HW_write_data(endpoint, usb_data_in);
+    if (status != USB_SUCCESS) goto errors;
+    USBD_CAPTURE_transaction(USBD_CAPTURE_TRANSACTION_DATA, endpoint, usb_data_in, 1);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_write_data_vector(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in_list, uint8_t number_of_segments) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Write endpoint.
+    status = USBD_HW_write_data_vector(endpoint, usb_data_in_list, number_of_segments);
+    if (status != USB_SUCCESS) goto errors;
+    USBD_CAPTURE_transaction(USBD_CAPTURE_TRANSACTION_DATA, endpoint, usb_data_in_list, number_of_segments);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_submit_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Hand buffer over to the peripheral.
+    status = USBD_HW_submit_data(endpoint, usb_data_in);
+    if (status != USB_SUCCESS) goto errors;
+    USBD_CAPTURE_transaction(USBD_CAPTURE_TRANSACTION_DATA, endpoint, usb_data_in, 1);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_acquire_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Take buffer back from the peripheral.
+    status = USBD_HW_acquire_data(endpoint, usb_data_out);
+    if (status != USB_SUCCESS) goto errors;
+    USBD_CAPTURE_transaction(USBD_CAPTURE_TRANSACTION_DATA, endpoint, usb_data_out, 1);
+errors:
+    return status;
+}
+
 #endif /* USB_LIB_DISABLE */
@@ -0,0 +1,343 @@
+/*
+ * usbd_capture.c
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#include "device/usbd_capture.h"
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_endpoint.h"
+#include "common/usb_types.h"
+#include "device/usbd_hw.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_CAPTURE))
+
+/*** USBD CAPTURE local macros ***/
+
+#if (USBD_CAPTURE_SNAPLEN_BYTES < USB_SETUP_PACKET_SIZE_BYTES)
+#error "USB library: USBD_CAPTURE_SNAPLEN_BYTES must be greater or equal to the setup packet size"
+#endif
+
+#define USBD_CAPTURE_PCAP_MAGIC_NUMBER          0xA1B2C3D4
+#define USBD_CAPTURE_PCAP_VERSION_MAJOR         2
+#define USBD_CAPTURE_PCAP_VERSION_MINOR         4
+#define USBD_CAPTURE_PCAP_LINKTYPE_USBMON       220
+
+#define USBD_CAPTURE_USBMON_TYPE_SUBMISSION     'S'
+#define USBD_CAPTURE_USBMON_TYPE_CALLBACK       'C'
+#define USBD_CAPTURE_USBMON_FLAG_PRESENT        0
+#define USBD_CAPTURE_USBMON_FLAG_SETUP_ABSENT   '-'
+#define USBD_CAPTURE_USBMON_FLAG_DATA_IN        '<'
+#define USBD_CAPTURE_USBMON_FLAG_DATA_OUT       '>'
+#define USBD_CAPTURE_USBMON_BUSNUM              1
+#define USBD_CAPTURE_USBMON_DEVNUM              1
+#define USBD_CAPTURE_USBMON_DIRECTION_IN        0x80
+
+#define USBD_CAPTURE_US_PER_S                   1000000
+
+/*** USBD CAPTURE local structures ***/
+
+/*******************************************************************/
+typedef union {
+    uint8_t all;
+    struct {
+        uint8_t running :1;
+        uint8_t control_direction_in :1;
+    } __attribute__((scalar_storage_order("big-endian"))) __attribute__((packed));
+} USBD_CAPTURE_flags_t;
+
+/*******************************************************************/
+typedef struct {
+    uint64_t timestamp_us;
+    uint64_t id;
+    uint32_t length;
+    uint32_t captured_length;
+    uint8_t type;
+    uint8_t xfer_type;
+    uint8_t epnum;
+    uint8_t setup_present;
+    uint8_t data[USBD_CAPTURE_SNAPLEN_BYTES];
+} USBD_CAPTURE_record_t;
+
+/*******************************************************************/
+typedef struct {
+    uint32_t magic_number;
+    uint16_t version_major;
+    uint16_t version_minor;
+    int32_t thiszone;
+    uint32_t sigfigs;
+    uint32_t snaplen;
+    uint32_t network;
+} __attribute__((packed)) USBD_CAPTURE_pcap_header_t;
+
+/*******************************************************************/
+typedef struct {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t incl_len;
+    uint32_t orig_len;
+} __attribute__((packed)) USBD_CAPTURE_pcap_record_header_t;
+
+/*******************************************************************/
+typedef struct {
+    uint64_t id;
+    uint8_t type;
+    uint8_t xfer_type;
+    uint8_t epnum;
+    uint8_t devnum;
+    uint16_t busnum;
+    uint8_t flag_setup;
+    uint8_t flag_data;
+    int64_t ts_sec;
+    int32_t ts_usec;
+    int32_t status;
+    uint32_t length;
+    uint32_t len_cap;
+    uint8_t setup[USB_SETUP_PACKET_SIZE_BYTES];
+    int32_t interval;
+    int32_t start_frame;
+    uint32_t xfer_flags;
+    uint32_t ndesc;
+} __attribute__((packed)) USBD_CAPTURE_usbmon_header_t;
+
+/*******************************************************************/
+typedef struct {
+    USBD_CAPTURE_flags_t flags;
+    USBD_CAPTURE_record_t records[USBD_CAPTURE_DEPTH];
+    uint32_t write_index;
+    uint32_t count;
+    uint64_t id;
+    uint64_t control_id;
+} USBD_CAPTURE_context_t;
+
+/*** USBD CAPTURE local global variables ***/
+
+// Linux usbmon transfer types indexed by USB_endpoint_transfer_type_t.
+static const uint8_t USBD_CAPTURE_USBMON_XFER_TYPE[USB_ENDPOINT_TRANSFER_TYPE_LAST] = { 2, 0, 3, 1 };
+
+static USBD_CAPTURE_context_t usbd_capture_ctx = {
+    .flags.all = 0,
+    .write_index = 0,
+    .count = 0,
+    .id = 0,
+    .control_id = 0
+};
+
+/*** USBD CAPTURE local functions ***/
+
+/*******************************************************************/
+static USB_status_t _USBD_CAPTURE_export_record(USBD_CAPTURE_record_t* record, USBD_CAPTURE_write_cb_t write_callback) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_CAPTURE_pcap_record_header_t pcap_record_header;
+    USBD_CAPTURE_usbmon_header_t usbmon_header;
+    uint8_t* payload = (record->data);
+    uint32_t payload_size_bytes = (record->captured_length);
+    uint8_t idx = 0;
+    // Build usbmon header.
+    usbmon_header.id = (record->id);
+    usbmon_header.type = (record->type);
+    usbmon_header.xfer_type = (record->xfer_type);
+    usbmon_header.epnum = (record->epnum);
+    usbmon_header.devnum = USBD_CAPTURE_USBMON_DEVNUM;
+    usbmon_header.busnum = USBD_CAPTURE_USBMON_BUSNUM;
+    usbmon_header.flag_setup = USBD_CAPTURE_USBMON_FLAG_SETUP_ABSENT;
+    usbmon_header.flag_data = USBD_CAPTURE_USBMON_FLAG_PRESENT;
+    usbmon_header.ts_sec = (int64_t) ((record->timestamp_us) / USBD_CAPTURE_US_PER_S);
+    usbmon_header.ts_usec = (int32_t) ((record->timestamp_us) % USBD_CAPTURE_US_PER_S);
+    usbmon_header.status = 0;
+    usbmon_header.length = (record->length);
+    usbmon_header.len_cap = (record->captured_length);
+    usbmon_header.interval = 0;
+    usbmon_header.start_frame = 0;
+    usbmon_header.xfer_flags = 0;
+    usbmon_header.ndesc = 0;
+    for (idx = 0; idx < USB_SETUP_PACKET_SIZE_BYTES; idx++) {
+        usbmon_header.setup[idx] = 0;
+    }
+    // Setup packet is carried by the header, the data stage is not part of the submission.
+    if ((record->setup_present) != 0) {
+        usbmon_header.flag_setup = USBD_CAPTURE_USBMON_FLAG_PRESENT;
+        for (idx = 0; idx < USB_SETUP_PACKET_SIZE_BYTES; idx++) {
+            usbmon_header.setup[idx] = (record->data)[idx];
+        }
+        usbmon_header.len_cap = 0;
+        payload_size_bytes = 0;
+    }
+    if (payload_size_bytes == 0) {
+        usbmon_header.flag_data = ((((record->epnum) & USBD_CAPTURE_USBMON_DIRECTION_IN) != 0) ? USBD_CAPTURE_USBMON_FLAG_DATA_IN : USBD_CAPTURE_USBMON_FLAG_DATA_OUT);
+    }
+    // Build pcap record header.
+    pcap_record_header.ts_sec = (uint32_t) (usbmon_header.ts_sec);
+    pcap_record_header.ts_usec = (uint32_t) (usbmon_header.ts_usec);
+    pcap_record_header.incl_len = (uint32_t) (sizeof(USBD_CAPTURE_usbmon_header_t) + payload_size_bytes);
+    pcap_record_header.orig_len = (uint32_t) (sizeof(USBD_CAPTURE_usbmon_header_t) + (((record->setup_present) != 0) ? 0 : (record->length)));
+    // Write record.
+    status = write_callback((uint8_t*) &pcap_record_header, sizeof(USBD_CAPTURE_pcap_record_header_t));
+    if (status != USB_SUCCESS) goto errors;
+    status = write_callback((uint8_t*) &usbmon_header, sizeof(USBD_CAPTURE_usbmon_header_t));
+    if (status != USB_SUCCESS) goto errors;
+    if (payload_size_bytes != 0) {
+        status = write_callback(payload, payload_size_bytes);
+        if (status != USB_SUCCESS) goto errors;
+    }
+errors:
+    return status;
+}
+
+/*** USBD CAPTURE functions ***/
+
+/*******************************************************************/
+USB_status_t USBD_CAPTURE_start(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check state.
+    if (usbd_capture_ctx.flags.running != 0) {
+        status = USB_ERROR_CAPTURE_RUNNING;
+        goto errors;
+    }
+    // Enable recording.
+    usbd_capture_ctx.flags.running = 1;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CAPTURE_stop(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Disable recording.
+    usbd_capture_ctx.flags.running = 0;
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CAPTURE_clear(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check state.
+    if (usbd_capture_ctx.flags.running != 0) {
+        status = USB_ERROR_CAPTURE_RUNNING;
+        goto errors;
+    }
+    // Reset ring buffer.
+    usbd_capture_ctx.write_index = 0;
+    usbd_capture_ctx.count = 0;
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_CAPTURE_export_pcap(USBD_CAPTURE_write_cb_t write_callback) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_CAPTURE_pcap_header_t pcap_header;
+    uint32_t read_index = 0;
+    uint32_t idx = 0;
+    // Check parameter.
+    if (write_callback == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Check state.
+    if (usbd_capture_ctx.flags.running != 0) {
+        status = USB_ERROR_CAPTURE_RUNNING;
+        goto errors;
+    }
+    // Write global header.
+    pcap_header.magic_number = USBD_CAPTURE_PCAP_MAGIC_NUMBER;
+    pcap_header.version_major = USBD_CAPTURE_PCAP_VERSION_MAJOR;
+    pcap_header.version_minor = USBD_CAPTURE_PCAP_VERSION_MINOR;
+    pcap_header.thiszone = 0;
+    pcap_header.sigfigs = 0;
+    pcap_header.snaplen = (uint32_t) (sizeof(USBD_CAPTURE_usbmon_header_t) + USBD_CAPTURE_SNAPLEN_BYTES);
+    pcap_header.network = USBD_CAPTURE_PCAP_LINKTYPE_USBMON;
+    status = write_callback((uint8_t*) &pcap_header, sizeof(USBD_CAPTURE_pcap_header_t));
+    if (status != USB_SUCCESS) goto errors;
+    // Write records from the oldest one.
+    read_index = ((usbd_capture_ctx.write_index + USBD_CAPTURE_DEPTH - usbd_capture_ctx.count) % USBD_CAPTURE_DEPTH);
+    for (idx = 0; idx < usbd_capture_ctx.count; idx++) {
+        status = _USBD_CAPTURE_export_record(&(usbd_capture_ctx.records[read_index]), write_callback);
+        if (status != USB_SUCCESS) goto errors;
+        read_index = ((read_index + 1) % USBD_CAPTURE_DEPTH);
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+void USBD_CAPTURE_record(USBD_CAPTURE_transaction_t transaction, USB_physical_endpoint_t* endpoint, USB_data_t* data_list, uint8_t number_of_segments) {
+    // Local variables.
+    USBD_CAPTURE_record_t* record = NULL;
+    USB_endpoint_transfer_type_t transfer_type = USB_ENDPOINT_TRANSFER_TYPE_CONTROL;
+    uint64_t timestamp_us = 0;
+    uint32_t length = 0;
+    uint32_t captured_length = 0;
+    uint8_t endpoint_number = 0;
+    uint8_t direction_in = 0;
+    uint8_t segment_idx = 0;
+    uint32_t idx = 0;
+    // Check state and parameters.
+    if ((usbd_capture_ctx.flags.running == 0) || (data_list == NULL) || (transaction >= USBD_CAPTURE_TRANSACTION_LAST)) goto errors;
+    // Setup packets are always received on the control endpoint.
+    if (endpoint != NULL) {
+        transfer_type = (endpoint->transfer_type);
+        endpoint_number = (endpoint->number);
+    }
+    if ((transfer_type >= USB_ENDPOINT_TRANSFER_TYPE_LAST) || ((endpoint == NULL) && (transaction != USBD_CAPTURE_TRANSACTION_SETUP))) goto errors;
+    for (segment_idx = 0; segment_idx < number_of_segments; segment_idx++) {
+        if (((data_list[segment_idx].size_bytes) != 0) && ((data_list[segment_idx].data) == NULL)) goto errors;
+        length += (data_list[segment_idx].size_bytes);
+    }
+    // Records are still captured without timestamp when the clock is not available.
+    if (USBD_HW_get_time_us(&timestamp_us) != USB_SUCCESS) {
+        timestamp_us = 0;
+    }
+    // Select record (the oldest one is overwritten when the buffer is full).
+    record = &(usbd_capture_ctx.records[usbd_capture_ctx.write_index]);
+    usbd_capture_ctx.write_index = ((usbd_capture_ctx.write_index + 1) % USBD_CAPTURE_DEPTH);
+    if (usbd_capture_ctx.count < USBD_CAPTURE_DEPTH) {
+        usbd_capture_ctx.count++;
+    }
+    // Gather the segments up to the snapshot length.
+    for (segment_idx = 0; segment_idx < number_of_segments; segment_idx++) {
+        for (idx = 0; (idx < (data_list[segment_idx].size_bytes)) && (captured_length < USBD_CAPTURE_SNAPLEN_BYTES); idx++) {
+            (record->data)[captured_length++] = (data_list[segment_idx].data)[idx];
+        }
+    }
+    record->timestamp_us = timestamp_us;
+    record->xfer_type = USBD_CAPTURE_USBMON_XFER_TYPE[transfer_type];
+    record->length = length;
+    record->captured_length = captured_length;
+    record->setup_present = 0;
+    if (transaction == USBD_CAPTURE_TRANSACTION_SETUP) {
+        // Setup packet opens a new control transfer whose direction applies to the following data stage.
+        record->setup_present = (captured_length >= USB_SETUP_PACKET_SIZE_BYTES) ? 1 : 0;
+        usbd_capture_ctx.flags.control_direction_in = (((record->setup_present) != 0) && (((record->data)[0] & USBD_CAPTURE_USBMON_DIRECTION_IN) != 0)) ? 1 : 0;
+        usbd_capture_ctx.control_id = (usbd_capture_ctx.id)++;
+    }
+    if (endpoint_number == 0) {
+        record->id = usbd_capture_ctx.control_id;
+        direction_in = usbd_capture_ctx.flags.control_direction_in;
+    }
+    else {
+        record->id = (usbd_capture_ctx.id)++;
+        direction_in = ((endpoint->direction) == USB_ENDPOINT_DIRECTION_IN) ? 1 : 0;
+    }
+    record->epnum = (uint8_t) (endpoint_number | ((direction_in != 0) ? USBD_CAPTURE_USBMON_DIRECTION_IN : 0));
+    // Host submits OUT data and setup packets, IN data completes the transfer.
+    record->type = ((transaction == USBD_CAPTURE_TRANSACTION_DATA) && ((endpoint->direction) == USB_ENDPOINT_DIRECTION_IN)) ? USBD_CAPTURE_USBMON_TYPE_CALLBACK : USBD_CAPTURE_USBMON_TYPE_SUBMISSION;
+    if ((record->setup_present) != 0) {
+        // Length of a submission is the requested data stage size (wLength).
+        record->length = (uint32_t) ((record->data)[6] | ((record->data)[7] << 8));
+    }
+errors:
+    return;
+}
+
+#endif /* USB_LIB_DISABLE */
@@ -0,0 +1,239 @@
+/*
+ * usbd_event.c
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#include "device/usbd_event.h"
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_endpoint.h"
+#include "common/usb_request.h"
+#include "common/usb_types.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_EVENT_QUEUE))
+
+/*** USBD EVENT local macros ***/
+
+#if ((USBD_EVENT_QUEUE_SIZE < 2) || ((USBD_EVENT_QUEUE_SIZE & (USBD_EVENT_QUEUE_SIZE - 1)) != 0))
+#error "USB library: USBD_EVENT_QUEUE_SIZE must be a power of 2"
+#endif
+
+#define USBD_EVENT_QUEUE_INDEX_MASK     (USBD_EVENT_QUEUE_SIZE - 1)
+
+/*** USBD EVENT local structures ***/
+
+/*******************************************************************/
+typedef struct {
+    USBD_EVENT_t queue[USBD_EVENT_QUEUE_SIZE];
+    // Free running indexes: the write index is only updated by the interrupt and the read index by the task.
+    volatile uint32_t write_index;
+    volatile uint32_t read_index;
+    volatile uint32_t overflow_count;
+    // Start of frames are coalesced in a single slot to keep the queue for transfers.
+    USB_sof_cb_t sof_callback;
+    volatile uint16_t sof_frame_number;
+    volatile uint8_t sof_pending;
+} USBD_EVENT_context_t;
+
+/*** USBD EVENT local global variables ***/
+
+static USBD_EVENT_context_t usbd_event_ctx = {
+    .write_index = 0,
+    .read_index = 0,
+    .overflow_count = 0,
+    .sof_callback = NULL,
+    .sof_frame_number = 0,
+    .sof_pending = 0
+};
+
+/*** USBD EVENT local functions ***/
+
+/*******************************************************************/
+static USBD_EVENT_t* _USBD_EVENT_reserve(void) {
+    // Local variables.
+    USBD_EVENT_t* event = NULL;
+    uint32_t write_index = usbd_event_ctx.write_index;
+    // Check free space.
+    if ((write_index - __atomic_load_n(&(usbd_event_ctx.read_index), __ATOMIC_ACQUIRE)) >= USBD_EVENT_QUEUE_SIZE) {
+        usbd_event_ctx.overflow_count++;
+        goto errors;
+    }
+    event = &(usbd_event_ctx.queue[write_index & USBD_EVENT_QUEUE_INDEX_MASK]);
+errors:
+    return event;
+}
+
+/*******************************************************************/
+static void _USBD_EVENT_commit(void) {
+    // Publish the record once it is completely written.
+    __atomic_store_n(&(usbd_event_ctx.write_index), (usbd_event_ctx.write_index + 1), __ATOMIC_RELEASE);
+}
+
+/*** USBD EVENT functions ***/
+
+/*******************************************************************/
+USB_status_t USBD_EVENT_push_setup(USB_setup_cb_t setup_callback) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_EVENT_t* event = NULL;
+    // Check parameter.
+    if (setup_callback == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Get free record.
+    event = _USBD_EVENT_reserve();
+    if (event == NULL) {
+        status = USB_ERROR_EVENT_QUEUE_FULL;
+        goto errors;
+    }
+    event->type = USBD_EVENT_TYPE_SETUP;
+    event->setup.callback = setup_callback;
+    _USBD_EVENT_commit();
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_EVENT_push_endpoint(USB_physical_endpoint_t* physical_endpoint, uint32_t size_bytes, USB_endpoint_transfer_status_t transfer_status, uint16_t frame_number) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_EVENT_t* event = NULL;
+    // Check parameter.
+    if (physical_endpoint == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Get free record.
+    event = _USBD_EVENT_reserve();
+    if (event == NULL) {
+        status = USB_ERROR_EVENT_QUEUE_FULL;
+        goto errors;
+    }
+    event->type = USBD_EVENT_TYPE_ENDPOINT;
+    event->endpoint.physical_endpoint = physical_endpoint;
+    event->endpoint.size_bytes = size_bytes;
+    event->endpoint.transfer_status = transfer_status;
+    event->endpoint.frame_number = frame_number;
+    _USBD_EVENT_commit();
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_EVENT_push_bus_event(USB_bus_event_cb_t bus_event_callback, USB_bus_event_t bus_event) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_EVENT_t* event = NULL;
+    // Check parameter.
+    if (bus_event_callback == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Get free record.
+    event = _USBD_EVENT_reserve();
+    if (event == NULL) {
+        status = USB_ERROR_EVENT_QUEUE_FULL;
+        goto errors;
+    }
+    event->type = USBD_EVENT_TYPE_BUS;
+    event->bus.callback = bus_event_callback;
+    event->bus.bus_event = bus_event;
+    _USBD_EVENT_commit();
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_EVENT_push_sof(USB_sof_cb_t sof_callback, uint16_t frame_number) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (sof_callback == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Overwrite the previous frame if it has not been processed yet.
+    usbd_event_ctx.sof_callback = sof_callback;
+    usbd_event_ctx.sof_frame_number = frame_number;
+    __atomic_store_n(&(usbd_event_ctx.sof_pending), 1, __ATOMIC_RELEASE);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_EVENT_process(uint32_t* number_of_events) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_EVENT_t* event = NULL;
+    USB_request_operation_t request_operation = USB_REQUEST_OPERATION_NOT_SUPPORTED;
+    uint32_t read_index = usbd_event_ctx.read_index;
+    uint32_t write_index = __atomic_load_n(&(usbd_event_ctx.write_index), __ATOMIC_ACQUIRE);
+    uint32_t count = 0;
+    // Process last start of frame.
+    if (__atomic_exchange_n(&(usbd_event_ctx.sof_pending), 0, __ATOMIC_ACQ_REL) != 0) {
+        usbd_event_ctx.sof_callback(usbd_event_ctx.sof_frame_number);
+        count++;
+    }
+    // Events queued during the processing are left for the next call to bound the task duration.
+    while (read_index != write_index) {
+        event = &(usbd_event_ctx.queue[read_index & USBD_EVENT_QUEUE_INDEX_MASK]);
+        // Execute callback.
+        switch (event->type) {
+        case USBD_EVENT_TYPE_SETUP:
+            event->setup.callback(&request_operation);
+            break;
+        case USBD_EVENT_TYPE_ENDPOINT:
+            if ((event->endpoint.physical_endpoint->callback) != NULL) {
+                event->endpoint.physical_endpoint->callback(event->endpoint.physical_endpoint, event->endpoint.size_bytes, event->endpoint.transfer_status, event->endpoint.frame_number);
+            }
+            break;
+        case USBD_EVENT_TYPE_BUS:
+            event->bus.callback(event->bus.bus_event);
+            break;
+        default:
+            status = USB_ERROR_EVENT_TYPE;
+            break;
+        }
+        // Give the record back to the interrupt.
+        read_index++;
+        __atomic_store_n(&(usbd_event_ctx.read_index), read_index, __ATOMIC_RELEASE);
+        count++;
+    }
+    if (number_of_events != NULL) {
+        (*number_of_events) = count;
+    }
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_EVENT_flush(void) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Reset queue.
+    usbd_event_ctx.read_index = usbd_event_ctx.write_index;
+    usbd_event_ctx.overflow_count = 0;
+    usbd_event_ctx.sof_pending = 0;
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_EVENT_get_overflow_count(uint32_t* overflow_count) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (overflow_count == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    (*overflow_count) = usbd_event_ctx.overflow_count;
+errors:
+    return status;
+}
+
+#endif /* USB_LIB_DISABLE */
@@ -16,6 +16,18 @@
 
 #ifndef USB_LIB_DISABLE
 
+/*** USBD HW local macros ***/
+
+#if ((defined USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES) && (USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES < 1))
+#error "USB library: USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES must be greater than 0"
+#endif
+
+/*** USBD HW local global variables ***/
+
+#ifdef USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES
+static uint8_t usbd_hw_packet[USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES];
+#endif
+
 /*** USBD HW functions ***/
 
 /*******************************************************************/
@@ -43,6 +55,24 @@ USB_status_t __attribute__((weak)) USBD_HW_register_setup_callback(USB_setup_cb_
     return status;
 }
 
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_register_bus_event_callback(USB_bus_event_cb_t bus_event_callback) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(bus_event_callback);
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_register_sof_callback(USB_sof_cb_t sof_callback) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(sof_callback);
+    return status;
+}
+
 /*******************************************************************/
 USB_status_t __attribute__((weak)) USBD_HW_register_endpoint(USB_physical_endpoint_t* endpoint) {
     // Local variables.
@@ -61,6 +91,24 @@ USB_status_t __attribute__((weak)) USBD_HW_unregister_endpoint(USB_physical_endp
     return status;
 }
 
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_set_stall(USB_physical_endpoint_t* endpoint) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(endpoint);
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_clear_stall(USB_physical_endpoint_t* endpoint) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(endpoint);
+    return status;
+}
+
 /*******************************************************************/
 USB_status_t __attribute__((weak)) USBD_HW_set_address(uint8_t device_address) {
     // Local variables.
@@ -70,6 +118,30 @@ USB_status_t __attribute__((weak)) USBD_HW_set_address(uint8_t device_address) {
     return status;
 }
 
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_set_control_status_pending(void) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_enter_critical(void) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_exit_critical(void) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    return status;
+}
+
 /*******************************************************************/
 USB_status_t __attribute__((weak)) USBD_HW_start(void) {
     // Local variables.
@@ -96,6 +168,70 @@ USB_status_t __attribute__((weak)) USBD_HW_write_data(USB_physical_endpoint_t* e
     return status;
 }
 
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_write_data_vector(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in_list, uint8_t number_of_segments) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USB_data_t usb_data_in;
+#ifdef USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES
+    USB_status_t critical_status = USB_SUCCESS;
+    uint32_t idx = 0;
+    uint8_t segment_idx = 0;
+#endif
+    // Check parameter.
+    if ((usb_data_in_list == NULL) && (number_of_segments != 0)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Single segments and zero length packets are written without copy.
+    if (number_of_segments <= 1) {
+        usb_data_in.data = (number_of_segments != 0) ? (usb_data_in_list[0].data) : NULL;
+        usb_data_in.size_bytes = (number_of_segments != 0) ? (usb_data_in_list[0].size_bytes) : 0;
+        status = USBD_HW_write_data(endpoint, &usb_data_in);
+        goto errors;
+    }
+#ifdef USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES
+    // The gather buffer is shared by all endpoints.
+    status = USBD_HW_enter_critical();
+    if (status == USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED) {
+        status = USB_SUCCESS;
+    }
+    if (status != USB_SUCCESS) goto errors;
+    usb_data_in.data = usbd_hw_packet;
+    usb_data_in.size_bytes = 0;
+    // Segments loop.
+    for (segment_idx = 0; segment_idx < number_of_segments; segment_idx++) {
+        // Check segment.
+        if (((usb_data_in_list[segment_idx].data) == NULL) && ((usb_data_in_list[segment_idx].size_bytes) != 0)) {
+            status = USB_ERROR_NULL_PARAMETER;
+            break;
+        }
+        if ((usb_data_in_list[segment_idx].size_bytes) > (USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES - (usb_data_in.size_bytes))) {
+            status = USB_ERROR_ENDPOINT_PACKET_SIZE;
+            break;
+        }
+        // Gather segment.
+        for (idx = 0; idx < (usb_data_in_list[segment_idx].size_bytes); idx++) {
+            usbd_hw_packet[usb_data_in.size_bytes++] = usb_data_in_list[segment_idx].data[idx];
+        }
+    }
+    // Write packet.
+    if (status == USB_SUCCESS) {
+        status = USBD_HW_write_data(endpoint, &usb_data_in);
+    }
+    critical_status = USBD_HW_exit_critical();
+    if ((status == USB_SUCCESS) && (critical_status != USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED)) {
+        status = critical_status;
+    }
+#else
+    // Gathering requires the USBD_HW_WRITE_DATA_VECTOR_BUFFER_SIZE_BYTES buffer or a driver implementation.
+    UNUSED(endpoint);
+    status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+#endif
+errors:
+    return status;
+}
+
 /*******************************************************************/
 USB_status_t __attribute__((weak)) USBD_HW_read_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out) {
     // Local variables.
@@ -106,6 +242,35 @@ USB_status_t __attribute__((weak)) USBD_HW_read_data(USB_physical_endpoint_t* en
     return status;
 }
 
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_submit_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_in) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(endpoint);
+    UNUSED(usb_data_in);
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_acquire_data(USB_physical_endpoint_t* endpoint, USB_data_t* usb_data_out) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(endpoint);
+    UNUSED(usb_data_out);
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_release_data(USB_physical_endpoint_t* endpoint) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(endpoint);
+    return status;
+}
+
 USB_status_t __attribute__((weak)) USBD_HW_read_setup(USB_data_t* usb_setup_out) {
     // Local variables.
     USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
@@ -114,4 +279,53 @@ USB_status_t __attribute__((weak)) USBD_HW_read_setup(USB_data_t* usb_setup_out)
     return status;
 }
 
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_get_unique_id(USB_data_t* unique_id) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(unique_id);
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_get_speed(USB_speed_t* speed) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(speed);
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_get_frame_number(uint16_t* frame_number) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(frame_number);
+    return status;
+}
+
+#ifdef USBD_CONTROL_LATENCY_HISTOGRAM
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_get_cycle_count(uint32_t* cycle_count) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(cycle_count);
+    return status;
+}
+#endif
+
+#ifdef USBD_CAPTURE
+/*******************************************************************/
+USB_status_t __attribute__((weak)) USBD_HW_get_time_us(uint64_t* time_us) {
+    // Local variables.
+    USB_status_t status = USB_ERROR_HW_FUNCTION_NOT_IMPLEMENTED;
+    /* To be implemented */
+    UNUSED(time_us);
+    return status;
+}
+#endif
+
 #endif /* USB_LIB_DISABLE */
@@ -0,0 +1,262 @@
+/*
+ * usbd_pma.c
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: Ludo
+ */
+
+#include "device/usbd_pma.h"
+
+#ifndef USB_LIB_DISABLE_FLAGS_FILE
+#include "usb_lib_flags.h"
+#endif
+#include "common/usb_configuration.h"
+#include "common/usb_device.h"
+#include "common/usb_endpoint.h"
+#include "common/usb_interface.h"
+#include "common/usb_types.h"
+#include "device/standard/usbd_control.h"
+#include "types.h"
+
+#if (!(defined USB_LIB_DISABLE) && (defined USBD_PMA))
+
+/*** USBD PMA local macros ***/
+
+#define USBD_PMA_NUMBER_OF_ENDPOINTS    16
+
+#define USBD_PMA_ALIGN(size)            ((((size) + USBD_PMA_ALIGNMENT_BYTES - 1) / USBD_PMA_ALIGNMENT_BYTES) * USBD_PMA_ALIGNMENT_BYTES)
+#define USBD_PMA_MAX(a, b)              (((a) > (b)) ? (a) : (b))
+
+// Worst case footprint of the library endpoints (largest packet size of both speeds).
+#define USBD_PMA_CONTROL_BYTES          (2 * USBD_PMA_ALIGN(USB_HS_CONTROL_PACKET_SIZE_MAX))
+
+#ifdef USBD_CDC
+#ifdef USBD_CDC_DATA_DOUBLE_BUFFER
+#define USBD_PMA_CDC_DATA_BUFFERS       2
+#else
+#define USBD_PMA_CDC_DATA_BUFFERS       1
+#endif
+#define USBD_PMA_CDC_BYTES              (USBD_PMA_ALIGN(USBD_PMA_MAX(USBD_CDC_COMM_PACKET_SIZE_BYTES, USBD_CDC_COMM_HS_PACKET_SIZE_BYTES)) + \
+                                        (2 * USBD_PMA_CDC_DATA_BUFFERS * USBD_PMA_ALIGN(USBD_PMA_MAX(USBD_CDC_DATA_PACKET_SIZE_BYTES, USBD_CDC_DATA_HS_PACKET_SIZE_BYTES))))
+#else
+#define USBD_PMA_CDC_BYTES              0
+#endif
+
+#ifdef USBD_UAC
+#ifdef USBD_UAC_STREAM_DOUBLE_BUFFER
+#define USBD_PMA_UAC_STREAM_BUFFERS     2
+#else
+#define USBD_PMA_UAC_STREAM_BUFFERS     1
+#endif
+#define USBD_PMA_UAC_BYTES              (USBD_PMA_ALIGN(USBD_PMA_MAX(USBD_UAC_CONTROL_PACKET_SIZE_BYTES, USBD_UAC_CONTROL_HS_PACKET_SIZE_BYTES)) + \
+                                        (USBD_PMA_UAC_STREAM_BUFFERS * USBD_PMA_ALIGN(USBD_PMA_MAX(USBD_UAC_STREAM_PLAY_PACKET_SIZE_BYTES, USBD_UAC_STREAM_PLAY_HS_PACKET_SIZE_BYTES))) + \
+                                        (USBD_PMA_UAC_STREAM_BUFFERS * USBD_PMA_ALIGN(USBD_PMA_MAX(USBD_UAC_STREAM_RECORD_PACKET_SIZE_BYTES, USBD_UAC_STREAM_RECORD_HS_PACKET_SIZE_BYTES))))
+#else
+#define USBD_PMA_UAC_BYTES              0
+#endif
+
+#if ((USBD_PMA_CONTROL_BYTES + USBD_PMA_CDC_BYTES + USBD_PMA_UAC_BYTES) > USBD_PMA_SIZE_BYTES)
+#error "USB library: the endpoints packet sizes exceed USBD_PMA_SIZE_BYTES"
+#endif
+
+/*** USBD PMA local structures ***/
+
+/*******************************************************************/
+typedef struct {
+    uint32_t offset;
+    uint32_t buffer_size_bytes;
+    uint8_t number_of_buffers;
+} USBD_PMA_buffer_t;
+
+/*******************************************************************/
+typedef struct {
+    USBD_PMA_buffer_t buffer[USBD_PMA_NUMBER_OF_ENDPOINTS][USB_ENDPOINT_DIRECTION_LAST];
+    uint32_t used_bytes;
+} USBD_PMA_context_t;
+
+/*** USBD PMA local global variables ***/
+
+static USBD_PMA_context_t usbd_pma_ctx = {
+    .used_bytes = 0
+};
+
+/*** USBD PMA local functions ***/
+
+/*******************************************************************/
+static USB_status_t _USBD_PMA_add_endpoint(const USB_physical_endpoint_t* physical_endpoint) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_PMA_buffer_t* buffer_ptr = NULL;
+    uint32_t buffer_size_bytes = 0;
+    uint8_t number_of_buffers = 0;
+    // Check endpoint.
+    if (physical_endpoint == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if ((physical_endpoint->number) >= USBD_PMA_NUMBER_OF_ENDPOINTS) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    if ((physical_endpoint->direction) >= USB_ENDPOINT_DIRECTION_LAST) {
+        status = USB_ERROR_ENDPOINT_DIRECTION;
+        goto errors;
+    }
+    // The largest packet size of both speeds is reserved since the speed is only known after the bus reset.
+    buffer_size_bytes = USBD_PMA_ALIGN(USBD_PMA_MAX((physical_endpoint->max_packet_size_bytes), (physical_endpoint->high_speed_max_packet_size_bytes)));
+    number_of_buffers = ((physical_endpoint->buffer_mode) == USB_ENDPOINT_BUFFER_MODE_DOUBLE) ? 2 : 1;
+    // Endpoints shared by several alternate settings or configurations get their largest footprint.
+    buffer_ptr = &(usbd_pma_ctx.buffer[physical_endpoint->number][physical_endpoint->direction]);
+    buffer_ptr->buffer_size_bytes = USBD_PMA_MAX((buffer_ptr->buffer_size_bytes), buffer_size_bytes);
+    buffer_ptr->number_of_buffers = USBD_PMA_MAX((buffer_ptr->number_of_buffers), number_of_buffers);
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_PMA_add_interface(const USB_interface_t* interface) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    const USB_interface_t* interface_ptr = NULL;
+    uint8_t alternate_setting = 0;
+    uint8_t idx = 0;
+    // Check parameter.
+    if (interface == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Alternate settings loop.
+    for (alternate_setting = 0; alternate_setting <= (interface->number_of_alternate_settings); alternate_setting++) {
+        interface_ptr = (alternate_setting == 0) ? interface : interface->alternate_setting_list[alternate_setting - 1];
+        // Endpoints loop.
+        for (idx = 0; idx < (interface_ptr->number_of_endpoints); idx++) {
+            status = _USBD_PMA_add_endpoint((interface_ptr->endpoint_list)[idx]->physical_endpoint);
+            if (status != USB_SUCCESS) goto errors;
+        }
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+static USB_status_t _USBD_PMA_add_configuration(const USB_configuration_t* configuration) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    const USB_interface_association_t* interface_association_ptr = NULL;
+    uint8_t association_idx = 0;
+    uint8_t idx = 0;
+    // Check parameter.
+    if (configuration == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Interfaces loop.
+    for (idx = 0; idx < (configuration->number_of_interfaces); idx++) {
+        status = _USBD_PMA_add_interface(configuration->interface_list[idx]);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    // Interface associations loop.
+    for (association_idx = 0; association_idx < (configuration->number_of_interfaces_associations); association_idx++) {
+        interface_association_ptr = configuration->interface_association_list[association_idx];
+        for (idx = 0; idx < (interface_association_ptr->number_of_interfaces); idx++) {
+            status = _USBD_PMA_add_interface(interface_association_ptr->interface_list[idx]);
+            if (status != USB_SUCCESS) goto errors;
+        }
+    }
+errors:
+    return status;
+}
+
+/*** USBD PMA functions ***/
+
+/*******************************************************************/
+USB_status_t USBD_PMA_allocate(const USB_device_t* device) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_PMA_buffer_t* buffer_ptr = NULL;
+    uint8_t configuration_idx = 0;
+    uint8_t number = 0;
+    uint8_t direction = 0;
+    // Check parameter.
+    if (device == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    // Reset layout.
+    for (number = 0; number < USBD_PMA_NUMBER_OF_ENDPOINTS; number++) {
+        for (direction = 0; direction < USB_ENDPOINT_DIRECTION_LAST; direction++) {
+            buffer_ptr = &(usbd_pma_ctx.buffer[number][direction]);
+            buffer_ptr->offset = 0;
+            buffer_ptr->buffer_size_bytes = 0;
+            buffer_ptr->number_of_buffers = 0;
+        }
+    }
+    usbd_pma_ctx.used_bytes = 0;
+    // Collect the endpoints of the control pipe and of all configurations.
+    status = _USBD_PMA_add_interface(&USBD_CONTROL_INTERFACE);
+    if (status != USB_SUCCESS) goto errors;
+    for (configuration_idx = 0; configuration_idx < (device->number_of_configurations); configuration_idx++) {
+        status = _USBD_PMA_add_configuration(device->configuration_list[configuration_idx]);
+        if (status != USB_SUCCESS) goto errors;
+    }
+    // Assign consecutive offsets by endpoint number.
+    for (number = 0; number < USBD_PMA_NUMBER_OF_ENDPOINTS; number++) {
+        for (direction = 0; direction < USB_ENDPOINT_DIRECTION_LAST; direction++) {
+            buffer_ptr = &(usbd_pma_ctx.buffer[number][direction]);
+            buffer_ptr->offset = usbd_pma_ctx.used_bytes;
+            usbd_pma_ctx.used_bytes += ((buffer_ptr->buffer_size_bytes) * (buffer_ptr->number_of_buffers));
+        }
+    }
+    // Check budget.
+    if ((usbd_pma_ctx.used_bytes) > USBD_PMA_SIZE_BYTES) {
+        status = USB_ERROR_PMA_SIZE;
+        goto errors;
+    }
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_PMA_get_buffer(USB_physical_endpoint_t* endpoint, uint8_t buffer_index, uint32_t* offset) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    USBD_PMA_buffer_t* buffer_ptr = NULL;
+    // Check parameters.
+    if ((endpoint == NULL) || (offset == NULL)) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    if ((endpoint->number) >= USBD_PMA_NUMBER_OF_ENDPOINTS) {
+        status = USB_ERROR_ENDPOINT_NUMBER;
+        goto errors;
+    }
+    if ((endpoint->direction) >= USB_ENDPOINT_DIRECTION_LAST) {
+        status = USB_ERROR_ENDPOINT_DIRECTION;
+        goto errors;
+    }
+    buffer_ptr = &(usbd_pma_ctx.buffer[endpoint->number][endpoint->direction]);
+    // Check allocation.
+    if (buffer_index >= (buffer_ptr->number_of_buffers)) {
+        status = USB_ERROR_PMA_BUFFER_NOT_ALLOCATED;
+        goto errors;
+    }
+    (*offset) = (buffer_ptr->offset) + (buffer_index * (buffer_ptr->buffer_size_bytes));
+errors:
+    return status;
+}
+
+/*******************************************************************/
+USB_status_t USBD_PMA_get_free_space(uint32_t* free_space_bytes) {
+    // Local variables.
+    USB_status_t status = USB_SUCCESS;
+    // Check parameter.
+    if (free_space_bytes == NULL) {
+        status = USB_ERROR_NULL_PARAMETER;
+        goto errors;
+    }
+    (*free_space_bytes) = ((usbd_pma_ctx.used_bytes) > USBD_PMA_SIZE_BYTES) ? 0 : (USBD_PMA_SIZE_BYTES - (usbd_pma_ctx.used_bytes));
+errors:
+    return status;
+}
+
+#endif /* USB_LIB_DISABLE */